@@ -0,0 +1,55 @@
+#pragma once
+#include "akane/model.h"
+#include "akane/texture.h"
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace akane
+{
+    /**
+     * Process-wide cache of meshes and textures loaded from files
+     *
+     * Assets are keyed by canonical path and validated against size and modification time of the
+     * file. A mesh file that is touched but keeps its content hash still resolves to the loaded
+     * mesh. Only weak references are kept, so that an asset is released once no scene uses it.
+     *
+     * All methods are thread-safe, and concurrent loads of the same file are done only once.
+     */
+    class AssetCache
+    {
+    public:
+        static AssetCache& Instance();
+
+        shared_ptr<const MeshDesc> LoadMesh(const std::string& filename);
+        shared_ptr<Texture3D> LoadTexture(const std::string& filename);
+
+    private:
+        AssetCache() = default;
+
+        template <typename T> struct Entry
+        {
+            // held while the asset is being loaded
+            std::mutex mutex;
+
+            uint64_t size                         = 0;
+            std::filesystem::file_time_type mtime = {};
+
+            std::weak_ptr<T> asset;
+        };
+
+        template <typename T>
+        using EntryTable = std::unordered_map<std::string, shared_ptr<Entry<T>>>;
+
+        // find or create the entry of a key
+        template <typename T>
+        shared_ptr<Entry<T>> FindEntry(EntryTable<T>& table, const std::string& key);
+
+        // guards tables below, but not entries in them
+        std::mutex mutex_;
+
+        EntryTable<const MeshDesc> meshes_;
+        EntryTable<Texture3D> textures_;
+    };
+} // namespace akane
@@ -1,97 +1,249 @@
 #pragma once
-#pragma once
-#include "akane/math/math.h"
-#include "akane/spectrum.h"
-#include <vector>
+#include "akane/bsdf/bsdf_type.h"
+#include "akane/bsdf/lambertian.h"
+#include "akane/bsdf/microfacet.h"
+#include "akane/bsdf/specular.h"
+#include <variant>
 
 namespace akane
 {
-    class BsdfType
+    // closed set of lobes, which are dispatched without virtual calls
+    using BsdfLobe = std::variant<LambertianReflection, SpecularReflection, SpecularTransmission,
+                                  MicrofacetReflection, MicrofacetTransmission>;
+
+    inline BsdfType GetLobeType(const BsdfLobe& lobe) noexcept
     {
-    public:
-        enum FlagType
-        {
-            None = 0,
-
-            // major category: BRDF or BTDF
-            Reflection   = 1,
-            Transmission = 2,
-
-            // sub-category
-            Diffuse  = 4,
-            Glossy   = 8,
-            Specular = 16,
-
-            // quick access
-            Any                  = Reflection | Transmission | Diffuse | Glossy | Specular,
-            DiffuseRefl          = Reflection | Diffuse,
-            GlossyRefl           = Reflection | Glossy,
-            SpecularRefl         = Reflection | Specular,
-            SpecularTransmission = Reflection | Transmission | Specular
-        };
+        return std::visit([](const auto& x) { return BsdfType{x.kType}; }, lobe);
+    }
 
-        constexpr BsdfType(FlagType flag) : value_(flag)
+    // evaluate f_r(wo, wi) of a single lobe, which is black if the lobe doesn't scatter light to
+    // the side of wi
+    inline Spectrum EvalLobe(const BsdfLobe& lobe, const Vec3& wo, const Vec3& wi) noexcept
+    {
+        auto type = GetLobeType(lobe);
+        if (SameHemisphere(wo, wi) ? !type.ContainReflection() : !type.ContainTransmission())
         {
+            return kBlackSpectrum;
         }
-        constexpr BsdfType(int flag) : BsdfType(static_cast<FlagType>(flag))
+
+        return std::visit([&](const auto& x) { return x.Eval(wo, wi); }, lobe);
+    }
+
+    /**
+     * Bidirectional scattering distribution function made of a few lobes stored inline, so that
+     * a bsdf is computed on the stack without any allocation
+     *
+     * Lobes are summed, and scaled down together if their albedos at wo add up to more than one
+     * so that the bsdf never creates energy. A lobe is sampled with probability proportional to
+     * its albedo at wo, and pdf of the bsdf is the mixture of lobe pdfs.
+     *
+     * Note surface normal vector is assumed to be (0, 0, 1), where volume above z-plane
+     * is outside the surface and below is inside
+     */
+    class Bsdf
+    {
+    public:
+        static constexpr int kMaxLobeCount = 4;
+
+        Bsdf() = default;
+
+        void Add(const BsdfLobe& lobe)
         {
+            AKANE_REQUIRE(lobe_count_ < kMaxLobeCount);
+            lobes_[lobe_count_++] = lobe;
+            type_                 = type_.Also(GetLobeType(lobe));
         }
 
-        constexpr BsdfType Also(BsdfType type) const noexcept
+        bool Empty() const noexcept
         {
-            return BsdfType{value_ | type.value_};
+            return lobe_count_ == 0;
         }
 
-        constexpr bool Contain(BsdfType flag) const noexcept
+        int LobeCount() const noexcept
         {
-            return (value_ & flag.value_) != 0;
+            return lobe_count_;
         }
 
-        constexpr bool ContainReflection() const noexcept
+        const BsdfLobe& GetLobe(int index) const noexcept
         {
-            return Contain(BsdfType::Reflection);
+            AKANE_ASSERT(index >= 0 && index < lobe_count_);
+            return lobes_[index];
         }
-        constexpr bool ContainTransmission() const noexcept
+
+        // replace albedo of the index-th lobe, e.g. to fill in a textured parameter
+        void SetLobeAlbedo(int index, const Spectrum& albedo) noexcept
         {
-            return Contain(BsdfType::Transmission);
+            AKANE_ASSERT(index >= 0 && index < lobe_count_);
+            std::visit([&](auto& x) { x.SetAlbedo(albedo); }, lobes_[index]);
         }
 
-    private:
-        FlagType value_ = None;
-    };
-
-    /**
-     * Interface for a bidirectional scattering distribution function
-     *
-     * Note surface normal vector is assumed to be (0, 0, 1), where volume above z-plane
-     * is outside the surface and below is inside
-     */
-    class Bsdf
-    {
-    public:
-        Bsdf() = default;
-        Bsdf(BsdfType type) : type_(type)
+        // specialize lobes to a single wavelength in spectral rendering, returning if any of them
+        // disperses light so that other wavelengths can't follow the sampled direction
+        bool SelectWavelength(float lambda) noexcept
         {
+            bool dispersive = false;
+            for (int i = 0; i < lobe_count_; ++i)
+            {
+                dispersive |=
+                    std::visit([&](auto& x) { return x.SelectWavelength(lambda); }, lobes_[i]);
+            }
+
+            return dispersive;
         }
 
-        ~Bsdf() = default;
-
         BsdfType GetType() const noexcept
         {
             return type_;
         }
 
+        // scale applied to all lobes at wo, so that f_r(wo, wi) is the scaled sum of EvalLobe
+        float EnergyScale(const Vec3& wo) const noexcept
+        {
+            return SelectLobes(wo).energy_scale;
+        }
+
         // evaluate f_r(wo, wi)
-        virtual Spectrum Eval(const Vec3& wo, const Vec3& wi) const noexcept = 0;
+        Spectrum Eval(const Vec3& wo, const Vec3& wi) const noexcept
+        {
+            Spectrum f = kBlackSpectrum;
+            for (int i = 0; i < lobe_count_; ++i)
+            {
+                f += EvalLobe(lobes_[i], wo, wi);
+            }
+
+            return f * EnergyScale(wo);
+        }
 
         // samples a wi and evaluate f_r(wo, wi)
-        virtual Spectrum SampleAndEval(const Point2f& u, const Vec3& wo, Vec3& wi_out,
-                                       float& pdf_out) const noexcept = 0;
+        Spectrum SampleAndEval(const Point2f& u, const Vec3& wo, Vec3& wi_out,
+                               float& pdf_out) const noexcept
+        {
+            AKANE_ASSERT(lobe_count_ > 0);
+
+            auto selection = SelectLobes(wo);
+
+            // choose a lobe, and reuse u[0] remapped into the range of that lobe
+            int index = 0;
+            float cdf = 0.f;
+            while (index + 1 < lobe_count_ && u[0] >= cdf + selection.probability[index])
+            {
+                cdf += selection.probability[index];
+                index += 1;
+            }
+
+            auto choice_pdf = selection.probability[index];
+            if (choice_pdf == 0)
+            {
+                pdf_out = 0;
+                return kBlackSpectrum;
+            }
+
+            auto u2 = Point2f{min((u[0] - cdf) / choice_pdf, kOneMinusEpsilon), u[1]};
+
+            Vec3 wi;
+            float pdf;
+            Spectrum f = std::visit(
+                [&](const auto& x) { return x.SampleAndEval(u2, wo, wi, pdf); }, lobes_[index]);
+
+            if (pdf == 0)
+            {
+                pdf_out = 0;
+                return kBlackSpectrum;
+            }
+
+            // other lobes have no chance to sample a delta direction
+            if (GetLobeType(lobes_[index]).Contain(BsdfType::Specular))
+            {
+                wi_out  = wi;
+                pdf_out = pdf * choice_pdf;
+                return f * selection.energy_scale;
+            }
+
+            bool is_reflection = SameHemisphere(wo, wi);
+
+            pdf *= choice_pdf;
+            for (int i = 0; i < lobe_count_; ++i)
+            {
+                if (i == index || !MatchCategory(lobes_[i], is_reflection))
+                {
+                    continue;
+                }
+
+                std::visit(
+                    [&](const auto& x) {
+                        f += x.Eval(wo, wi);
+                        pdf += x.Pdf(wo, wi) * selection.probability[i];
+                    },
+                    lobes_[i]);
+            }
+
+            wi_out  = wi;
+            pdf_out = pdf;
+            return f * selection.energy_scale;
+        }
 
-        virtual float Pdf(const Vec3& wo, const Vec3& wi) const noexcept = 0;
+        float Pdf(const Vec3& wo, const Vec3& wi) const noexcept
+        {
+            auto selection     = SelectLobes(wo);
+            bool is_reflection = SameHemisphere(wo, wi);
+
+            float pdf = 0;
+            for (int i = 0; i < lobe_count_; ++i)
+            {
+                if (MatchCategory(lobes_[i], is_reflection))
+                {
+                    pdf += std::visit([&](const auto& x) { return x.Pdf(wo, wi); }, lobes_[i]) *
+                           selection.probability[i];
+                }
+            }
+
+            return pdf;
+        }
 
-    protected:
-        BsdfType type_ = BsdfType::None;
-    };
+    private:
+        static constexpr float kOneMinusEpsilon = 0x1.fffffep-1f;
+
+        struct LobeSelection
+        {
+            float probability[kMaxLobeCount];
+            float energy_scale;
+        };
 
+        // depends on wo only, so that sampling and pdf queries agree with each other
+        LobeSelection SelectLobes(const Vec3& wo) const noexcept
+        {
+            LobeSelection result;
+
+            float total_weight = 0.f;
+            float total_albedo = 0.f;
+            for (int i = 0; i < lobe_count_; ++i)
+            {
+                auto albedo =
+                    std::visit([&](const auto& x) { return x.Albedo(wo); }, lobes_[i]);
+
+                result.probability[i] = albedo.Sum();
+                total_weight += albedo.Sum();
+                total_albedo += albedo.Max();
+            }
+
+            for (int i = 0; i < lobe_count_; ++i)
+            {
+                result.probability[i] = total_weight > 0 ? result.probability[i] / total_weight
+                                                         : 1.f / lobe_count_;
+            }
+
+            result.energy_scale = total_albedo > 1.f ? 1.f / total_albedo : 1.f;
+            return result;
+        }
+
+        static bool MatchCategory(const BsdfLobe& lobe, bool is_reflection) noexcept
+        {
+            auto type = GetLobeType(lobe);
+            return is_reflection ? type.ContainReflection() : type.ContainTransmission();
+        }
+
+        int lobe_count_ = 0;
+        BsdfType type_  = BsdfType::None;
+        BsdfLobe lobes_[kMaxLobeCount];
+    };
 } // namespace akane
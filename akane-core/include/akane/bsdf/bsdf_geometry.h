@@ -30,6 +30,22 @@ namespace akane
         }
     }
 
+    // x axis of the bsdf coordinate follows the tangent, which anisotropic bsdfs are aligned to
+    inline Transform CreateBsdfCoordTransform(Vec3 n, Vec3 tangent)
+    {
+        Vec3 nz = n.Normalized();
+        Vec3 nx = tangent - nz * nz.Dot(tangent);
+        if (nx.LengthSq() < 1e-12f)
+        {
+            return CreateBsdfCoordTransform(n);
+        }
+
+        nx      = nx.Normalized();
+        Vec3 ny = Cross(nz, nx);
+
+        return Transform(nx, ny, nz);
+    }
+
     inline bool SameHemisphere(const Vec3& wo, const Vec3& wi) noexcept
     {
         return wo.Z() * wi.Z() > 0;
@@ -0,0 +1,60 @@
+#pragma once
+#include "akane/math/math.h"
+
+namespace akane
+{
+    class BsdfType
+    {
+    public:
+        enum FlagType
+        {
+            None = 0,
+
+            // major category: BRDF or BTDF
+            Reflection   = 1,
+            Transmission = 2,
+
+            // sub-category
+            Diffuse  = 4,
+            Glossy   = 8,
+            Specular = 16,
+
+            // quick access
+            Any                  = Reflection | Transmission | Diffuse | Glossy | Specular,
+            DiffuseRefl          = Reflection | Diffuse,
+            GlossyRefl           = Reflection | Glossy,
+            SpecularRefl         = Reflection | Specular,
+            SpecularTransmission = Reflection | Transmission | Specular,
+            GlossyTransmission   = Transmission | Glossy
+        };
+
+        constexpr BsdfType(FlagType flag) : value_(flag)
+        {
+        }
+        constexpr BsdfType(int flag) : BsdfType(static_cast<FlagType>(flag))
+        {
+        }
+
+        constexpr BsdfType Also(BsdfType type) const noexcept
+        {
+            return BsdfType{value_ | type.value_};
+        }
+
+        constexpr bool Contain(BsdfType flag) const noexcept
+        {
+            return (value_ & flag.value_) != 0;
+        }
+
+        constexpr bool ContainReflection() const noexcept
+        {
+            return Contain(BsdfType::Reflection);
+        }
+        constexpr bool ContainTransmission() const noexcept
+        {
+            return Contain(BsdfType::Transmission);
+        }
+
+    private:
+        FlagType value_ = None;
+    };
+} // namespace akane
@@ -1,19 +1,21 @@
 #pragma once
-#include "akane/bsdf.h"
+#include "akane/bsdf/bsdf_type.h"
 #include "akane/bsdf/bsdf_geometry.h"
 #include "akane/spectrum.h"
 #include "akane/math/sampling.h"
 
 namespace akane
 {
-    class LambertianReflection : public Bsdf
+    class LambertianReflection
     {
     public:
-        LambertianReflection(Spectrum albedo) : Bsdf(BsdfType::DiffuseRefl), albedo_(albedo)
+        static constexpr BsdfType kType = BsdfType::DiffuseRefl;
+
+        LambertianReflection(Spectrum albedo = {}) : albedo_(albedo)
         {
         }
 
-        Spectrum Eval(const Vec3& wo, const Vec3& wi) const noexcept override
+        Spectrum Eval(const Vec3& wo, const Vec3& wi) const noexcept
         {
             return albedo_ / kPi;
         }
@@ -35,7 +37,7 @@ namespace akane
             return albedo_ / kPi;
         }
 
-        float Pdf(const Vec3& wi, const Vec3& wo) const noexcept
+        float Pdf(const Vec3& wo, const Vec3& wi) const noexcept
         {
             if (!SameHemisphere(wo, wi))
             {
@@ -45,6 +47,23 @@ namespace akane
             return PdfCosineWeightedHemisphere(abs(wi.Z()));
         }
 
+        // all of albedo is scattered regardless of wo
+        Spectrum Albedo(const Vec3& wo) const noexcept
+        {
+            return albedo_;
+        }
+
+        void SetAlbedo(const Spectrum& albedo) noexcept
+        {
+            albedo_ = albedo;
+        }
+
+        // dispersion-free, so every wavelength scatters the same way
+        bool SelectWavelength(float lambda) noexcept
+        {
+            return false;
+        }
+
     private:
         Spectrum albedo_;
     };
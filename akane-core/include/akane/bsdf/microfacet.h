@@ -0,0 +1,432 @@
+#pragma once
+#include "akane/bsdf/bsdf_type.h"
+#include "akane/spectral.h"
+#include "akane/bsdf/bsdf_geometry.h"
+#include "akane/math/sampling.h"
+#include <limits>
+
+namespace akane
+{
+    // Schlick Fresnel Approximation
+    struct Fresnel
+    {
+    public:
+        // abbe disperses etaT in spectral rendering, see DispersiveEta
+        Fresnel(float etaI, float etaT, float abbe = 0.f)
+            : eta_i_(etaI), eta_t_ref_(etaT), abbe_(abbe)
+        {
+            f0_ = ComputeF0(etaI, etaT);
+        }
+        Fresnel(Spectrum f0) : f0_(f0)
+        {
+        }
+
+        Spectrum EvalOneChannel(float cos_theta_i) const noexcept
+        {
+            auto pow5 = [](float x) { return x * x * x * x * x; };
+            return f0_[0] + (1 - f0_[0]) * pow5(1 - cos_theta_i);
+        }
+
+        Spectrum Eval(float cos_theta_i) const noexcept
+        {
+            auto pow5 = [](float x) { return x * x * x * x * x; };
+            return f0_ + (kWhiteSpectrum - f0_) * pow5(1 - cos_theta_i);
+        }
+
+        // cosine-weighted average over the hemisphere, i.e. 2 * integral of F(mu) * mu
+        Spectrum Average() const noexcept
+        {
+            return f0_ + (kWhiteSpectrum - f0_) / 21.f;
+        }
+
+        // reflect as light of the given wavelength, returning if the term depends on it
+        bool SelectWavelength(float lambda) noexcept
+        {
+            if (abbe_ <= 0)
+            {
+                return false;
+            }
+
+            f0_ = ComputeF0(eta_i_, DispersiveEta(eta_t_ref_, abbe_, lambda));
+            return true;
+        }
+
+    private:
+        static Spectrum ComputeF0(float etaI, float etaT) noexcept
+        {
+            auto r0 = (etaI - etaT) / (etaI + etaT);
+            return Spectrum{r0 * r0};
+        }
+
+        Spectrum f0_;
+
+        // dielectric interface that f0 is derived from, zero abbe if f0 is given directly
+        float eta_i_     = 1.f;
+        float eta_t_ref_ = 1.f; // etaT at kLambdaEta
+        float abbe_      = 0.f;
+    };
+
+    // GGX Microfacet Distribution, anisotropic with roughness along x and y axes of the bsdf
+    // coordinate
+    struct MicrofacetDistribution
+    {
+    public:
+        MicrofacetDistribution(float roughness) : MicrofacetDistribution(roughness, roughness)
+        {
+        }
+        MicrofacetDistribution(float roughness_x, float roughness_y)
+            : alpha_x_(max(roughness_x * roughness_x, 1e-4f)),
+              alpha_y_(max(roughness_y * roughness_y, 1e-4f))
+        {
+        }
+
+        // isotropic alpha of about the same spread, used to look up tabulated albedo
+        float Alpha() const noexcept
+        {
+            return sqrt(alpha_x_ * alpha_y_);
+        }
+
+        // GGX D term
+        float D(const Vec3& wh) const noexcept
+        {
+            auto x = wh.X() / alpha_x_;
+            auto y = wh.Y() / alpha_y_;
+            auto z = wh.Z();
+
+            auto root = x * x + y * y + z * z;
+            return 1.f / (kPi * alpha_x_ * alpha_y_ * root * root);
+        }
+
+        // Smith G1 term, i.e. fraction of microfacets facing w that are visible from w
+        float G1(const Vec3& w) const noexcept
+        {
+            return 1.f / (1.f + Lambda(w));
+        }
+
+        // height-correlated Smith G term
+        float G(const Vec3& wo, const Vec3& wi) const noexcept
+        {
+            return 1.f / (1.f + Lambda(wo) + Lambda(wi));
+        }
+
+        // sample microfacet normal visible from wo (Heitz 2018), on the same side of wo
+        Vec3 SampleWh(const Vec3& wo, const Point2f& u) const noexcept
+        {
+            auto flip = wo.Z() < 0;
+            auto v    = flip ? -wo : wo;
+
+            // transform to the hemisphere configuration of unit roughness
+            auto vh   = Vec3{alpha_x_ * v.X(), alpha_y_ * v.Y(), v.Z()}.Normalized();
+            auto len2 = vh.X() * vh.X() + vh.Y() * vh.Y();
+            auto t1   = len2 > 0 ? Vec3{-vh.Y(), vh.X(), 0.f} / sqrt(len2) : Vec3{1.f, 0.f, 0.f};
+            auto t2   = Cross(vh, t1);
+
+            // sample the projected area, whose lower half is foreshortened
+            auto r   = sqrt(u[0]);
+            auto phi = kTwoPi * u[1];
+            auto p1  = r * cos(phi);
+            auto p2  = r * sin(phi);
+            auto s   = .5f * (1.f + vh.Z());
+            p2       = (1.f - s) * sqrt(max(0.f, 1.f - p1 * p1)) + s * p2;
+
+            auto nh = p1 * t1 + p2 * t2 + sqrt(max(0.f, 1.f - p1 * p1 - p2 * p2)) * vh;
+            auto wh = Vec3{alpha_x_ * nh.X(), alpha_y_ * nh.Y(), max(1e-6f, nh.Z())}.Normalized();
+
+            return flip ? -wh : wh;
+        }
+
+        // density of SampleWh
+        float Pdf(const Vec3& wo, const Vec3& wh) const noexcept
+        {
+            auto cos_o = AbsCosTheta(wo);
+            if (cos_o == 0)
+            {
+                return 0.f;
+            }
+
+            return D(wh) * G1(wo) * abs(wo.Dot(wh)) / cos_o;
+        }
+
+    private:
+        float Lambda(const Vec3& w) const noexcept
+        {
+            auto cos2_theta = Cos2Theta(w);
+            if (cos2_theta == 0)
+            {
+                return std::numeric_limits<float>::infinity();
+            }
+
+            auto x = alpha_x_ * w.X();
+            auto y = alpha_y_ * w.Y();
+            return (-1.f + sqrt(1.f + (x * x + y * y) / cos2_theta)) * .5f;
+        }
+
+        float alpha_x_;
+        float alpha_y_;
+    };
+
+    // directional albedo of GGX reflection without Fresnel term, from a precomputed table
+    float MicrofacetDirectionalAlbedo(float cos_theta, float alpha) noexcept;
+
+    // cosine-weighted average of MicrofacetDirectionalAlbedo over the hemisphere
+    float MicrofacetAverageAlbedo(float alpha) noexcept;
+
+    // Cook Torrance, with energy lost in single scattering added back (Kulla and Conty 2017)
+    // NOTE both sides of the surface reflect
+    class MicrofacetReflection
+    {
+    public:
+        static constexpr BsdfType kType = BsdfType::GlossyRefl;
+
+        MicrofacetReflection(Spectrum albedo, Fresnel fresnel, MicrofacetDistribution microfacet)
+            : albedo_(albedo), fresnel_(fresnel), microfacet_(microfacet)
+        {
+            UpdateMultiScatter();
+        }
+
+        Spectrum Eval(const Vec3& wo, const Vec3& wi) const noexcept
+        {
+            if (!SameHemisphere(wo, wi))
+            {
+                return 0.f;
+            }
+
+            auto wh = (wo + wi).Normalized();
+            auto D  = microfacet_.D(wh);
+            auto F  = fresnel_.Eval(abs(wh.Dot(wi)));
+            auto G  = microfacet_.G(wo, wi);
+
+            auto f = (D * F * G) / (4 * AbsCosTheta(wo) * AbsCosTheta(wi));
+            return albedo_ * (f + EvalMultiScatter(wo, wi));
+        }
+
+        Spectrum SampleAndEval(const Point2f& u, const Vec3& wo, Vec3& wi_out,
+                               float& pdf_out) const noexcept
+        {
+            if (wo.Z() == 0)
+            {
+                pdf_out = 0.f;
+                return 0.f;
+            }
+
+            // wh is on the same side of wo, so that ReflectRay applies
+            auto wh = microfacet_.SampleWh(wo, u);
+            auto wi = ReflectRay(wo, wh);
+            if (!SameHemisphere(wo, wi))
+            {
+                pdf_out = 0.f;
+                return 0.f;
+            }
+
+            wi_out  = wi;
+            pdf_out = microfacet_.Pdf(wo, wh) / (4 * wh.Dot(wo));
+            return Eval(wo, wi);
+        }
+
+        float Pdf(const Vec3& wo, const Vec3& wi) const noexcept
+        {
+            if (!SameHemisphere(wo, wi))
+            {
+                return 0.f;
+            }
+
+            auto wh = (wo + wi).Normalized();
+            return microfacet_.Pdf(wo, wh) / (4 * abs(wh.Dot(wo)));
+        }
+
+        // fraction of energy reflected towards wo, approximated with the Fresnel term at wo
+        Spectrum Albedo(const Vec3& wo) const noexcept
+        {
+            auto cos_theta = AbsCosTheta(wo);
+            auto e         = MicrofacetDirectionalAlbedo(cos_theta, microfacet_.Alpha());
+
+            return albedo_ * (fresnel_.Eval(cos_theta) * e + multi_scatter_fresnel_ * (1 - e));
+        }
+
+        void SetAlbedo(const Spectrum& albedo) noexcept
+        {
+            albedo_ = albedo;
+        }
+
+        // reflect as light of the given wavelength, so that a dispersive dielectric splits energy
+        // with the same eta as its transmission lobe
+        bool SelectWavelength(float lambda) noexcept
+        {
+            if (!fresnel_.SelectWavelength(lambda))
+            {
+                return false;
+            }
+
+            UpdateMultiScatter();
+            return true;
+        }
+
+    private:
+        // multiple scattering with Fresnel term, averaged over the hemisphere
+        void UpdateMultiScatter() noexcept
+        {
+            auto e_avg = MicrofacetAverageAlbedo(microfacet_.Alpha());
+            auto f_avg = fresnel_.Average();
+
+            multi_scatter_fresnel_ = f_avg * f_avg * e_avg / (kWhiteSpectrum - f_avg * (1 - e_avg));
+            multi_scatter_norm_    = e_avg < 1.f ? 1.f / (kPi * (1 - e_avg)) : 0.f;
+        }
+
+        Spectrum EvalMultiScatter(const Vec3& wo, const Vec3& wi) const noexcept
+        {
+            auto e_o = MicrofacetDirectionalAlbedo(AbsCosTheta(wo), microfacet_.Alpha());
+            auto e_i = MicrofacetDirectionalAlbedo(AbsCosTheta(wi), microfacet_.Alpha());
+
+            return multi_scatter_fresnel_ * ((1 - e_o) * (1 - e_i) * multi_scatter_norm_);
+        }
+
+        Spectrum albedo_;
+
+        Fresnel fresnel_;
+        MicrofacetDistribution microfacet_;
+
+        Spectrum multi_scatter_fresnel_ = {};
+        float multi_scatter_norm_       = 0.f;
+    };
+    // rough dielectric interface, where only refraction is handled and reflection is left to a
+    // MicrofacetReflection lobe (Walter et al. 2007)
+    class MicrofacetTransmission
+    {
+    public:
+        static constexpr BsdfType kType = BsdfType::GlossyTransmission;
+
+        MicrofacetTransmission(Spectrum albedo, float eta_in, float eta_out,
+                               MicrofacetDistribution microfacet, float abbe = 0.f)
+            : albedo_(albedo), eta_in_(eta_in), eta_out_(eta_out), microfacet_(microfacet),
+              eta_ref_(eta_in), abbe_(abbe)
+        {
+        }
+
+        Spectrum Eval(const Vec3& wo, const Vec3& wi) const noexcept
+        {
+            Vec3 wh;
+            float eta;
+            if (!ComputeHalfVector(wo, wi, wh, eta))
+            {
+                return 0.f;
+            }
+
+            auto cos_o = wo.Dot(wh);
+            auto cos_i = wi.Dot(wh);
+            auto denom = cos_o + eta * cos_i;
+
+            // radiance is compressed by eta^2 when entering a denser medium, which cancels the
+            // eta^2 in jacobian of the half vector
+            auto D = microfacet_.D(wh);
+            auto G = microfacet_.G(wo, wi);
+            auto F = Schlick(min(abs(cos_o), abs(cos_i)), eta_out_ / eta_in_);
+
+            auto f = (1 - F) * D * G * abs(cos_o * cos_i) /
+                     (AbsCosTheta(wo) * AbsCosTheta(wi) * denom * denom);
+            return albedo_ * f;
+        }
+
+        Spectrum SampleAndEval(const Point2f& u, const Vec3& wo, Vec3& wi_out,
+                               float& pdf_out) const noexcept
+        {
+            if (wo.Z() == 0)
+            {
+                pdf_out = 0.f;
+                return 0.f;
+            }
+
+            auto wh       = microfacet_.SampleWh(wo, u);
+            auto entering = wo.Z() > 0;
+            auto eta      = entering ? eta_out_ / eta_in_ : eta_in_ / eta_out_;
+
+            Vec3 wi;
+            if (wo.Dot(wh) <= 0 || !RefractRay(wo, wh, eta, wi))
+            {
+                // total internal reflection is not handled by this lobe
+                pdf_out = 0.f;
+                return 0.f;
+            }
+
+            wi_out  = wi;
+            pdf_out = Pdf(wo, wi);
+            return Eval(wo, wi);
+        }
+
+        float Pdf(const Vec3& wo, const Vec3& wi) const noexcept
+        {
+            Vec3 wh;
+            float eta;
+            if (!ComputeHalfVector(wo, wi, wh, eta))
+            {
+                return 0.f;
+            }
+
+            auto cos_i = wi.Dot(wh);
+            auto denom = wo.Dot(wh) + eta * cos_i;
+
+            // jacobian from wh to wi
+            auto dwh_dwi = eta * eta * abs(cos_i) / (denom * denom);
+            return microfacet_.Pdf(wo, wh) * dwh_dwi;
+        }
+
+        Spectrum Albedo(const Vec3& wo) const noexcept
+        {
+            return albedo_ * (1 - Schlick(AbsCosTheta(wo), eta_out_ / eta_in_));
+        }
+
+        void SetAlbedo(const Spectrum& albedo) noexcept
+        {
+            albedo_ = albedo;
+        }
+
+        // refract as light of the given wavelength, returning if the direction depends on it
+        bool SelectWavelength(float lambda) noexcept
+        {
+            eta_in_ = DispersiveEta(eta_ref_, abbe_, lambda);
+            return abbe_ > 0;
+        }
+
+    private:
+        // generalized half vector towards the outside, where eta is eta_t / eta_i
+        bool ComputeHalfVector(const Vec3& wo, const Vec3& wi, Vec3& wh_out,
+                               float& eta_out) const noexcept
+        {
+            if (SameHemisphere(wo, wi) || wo.Z() == 0 || wi.Z() == 0)
+            {
+                return false;
+            }
+
+            auto eta = wo.Z() > 0 ? eta_in_ / eta_out_ : eta_out_ / eta_in_;
+            auto wh  = wo + wi * eta;
+            if (wh.LengthSq() == 0)
+            {
+                return false;
+            }
+
+            wh = wh.Normalized();
+            if (wh.Z() < 0)
+            {
+                wh = -wh;
+            }
+
+            // both directions must lie on the side of wh that they are refracted from
+            if (wo.Dot(wh) * wi.Dot(wh) >= 0)
+            {
+                return false;
+            }
+
+            wh_out  = wh;
+            eta_out = eta;
+            return true;
+        }
+
+        Spectrum albedo_;
+
+        float eta_in_;
+        float eta_out_;
+        MicrofacetDistribution microfacet_;
+
+        float eta_ref_; // eta_in at kLambdaEta
+        float abbe_;
+    };
+} // namespace akane
\ No newline at end of file
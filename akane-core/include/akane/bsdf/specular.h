@@ -1,56 +1,77 @@
 #pragma once
-#include "akane/bsdf.h"
+#include "akane/bsdf/bsdf_type.h"
+#include "akane/spectral.h"
 #include "akane/bsdf/bsdf_geometry.h"
 #include "akane/math/sampling.h"
 
 namespace akane
 {
-    class SpecularReflection : public Bsdf
+    class SpecularReflection
     {
     public:
-        SpecularReflection(Spectrum albedo) : Bsdf(BsdfType::SpecularRefl), albedo_(albedo)
+        static constexpr BsdfType kType = BsdfType::SpecularRefl;
+
+        SpecularReflection(Spectrum albedo) : albedo_(albedo)
         {
         }
 
-        Spectrum Eval(const Vec3& wo, const Vec3& wi) const noexcept override
+        Spectrum Eval(const Vec3& wo, const Vec3& wi) const noexcept
         {
             return Spectrum{0.f};
         }
 
         Spectrum SampleAndEval(const Point2f& u, const Vec3& wo, Vec3& wi_out, float& pdf_out) const
-            noexcept override
+            noexcept
         {
             wi_out  = ReflectRayQuick(wo);
             pdf_out = 1.f;
             return albedo_; // compensate for angle of incidence
         }
 
-        float Pdf(const Vec3& wi, const Vec3& wo) const noexcept override
+        float Pdf(const Vec3& wo, const Vec3& wi) const noexcept
         {
             return 0;
         }
 
+        // energy scattered from wo, which weights selection of the lobe
+        Spectrum Albedo(const Vec3& wo) const noexcept
+        {
+            return albedo_;
+        }
+
+        void SetAlbedo(const Spectrum& albedo) noexcept
+        {
+            albedo_ = albedo;
+        }
+
+        // dispersion-free, so every wavelength scatters the same way
+        bool SelectWavelength(float lambda) noexcept
+        {
+            return false;
+        }
+
     private:
         Spectrum albedo_;
     };
 
     // TODO: refine this
-    class SpecularTransmission : public Bsdf
+    class SpecularTransmission
     {
     public:
-        SpecularTransmission(Spectrum albedo, float eta_in, float eta_out)
-            : Bsdf(BsdfType::SpecularTransmission), albedo_(albedo), eta_in_(eta_in),
-              eta_out_(eta_out)
+        static constexpr BsdfType kType = BsdfType::SpecularTransmission;
+
+        SpecularTransmission(Spectrum albedo, float eta_in, float eta_out, float abbe = 0.f)
+            : albedo_(albedo), eta_in_(eta_in), eta_out_(eta_out), eta_ref_(eta_in), abbe_(abbe)
         {
         }
 
-        Spectrum Eval(const Vec3& wo, const Vec3& wi) const noexcept override
+        Spectrum Eval(const Vec3& wo, const Vec3& wi) const noexcept
         {
             return Spectrum{0.f};
         }
 
         Spectrum SampleAndEval(const Point2f& u, const Vec3& wo, Vec3& wi_out, float& pdf_out) const
-            noexcept override
+            noexcept
         {
             auto entering = wo.Z() > 0;
             auto eta      = entering ? eta_out_ / eta_in_ : eta_in_ / eta_out_;
@@ -72,14 +93,34 @@ namespace akane
             return albedo_ / AbsCosTheta(wi_out); // compensate for angle of incidence
         }
 
-        float Pdf(const Vec3& wi, const Vec3& wo) const noexcept override
+        float Pdf(const Vec3& wo, const Vec3& wi) const noexcept
         {
             return 0;
         }
 
+        Spectrum Albedo(const Vec3& wo) const noexcept
+        {
+            return albedo_;
+        }
+
+        void SetAlbedo(const Spectrum& albedo) noexcept
+        {
+            albedo_ = albedo;
+        }
+
+        // refract as light of the given wavelength, returning if the direction depends on it
+        bool SelectWavelength(float lambda) noexcept
+        {
+            eta_in_ = DispersiveEta(eta_ref_, abbe_, lambda);
+            return abbe_ > 0;
+        }
+
     private:
         float eta_in_;
         float eta_out_;
         Spectrum albedo_;
+
+        float eta_ref_; // eta_in at kLambdaEta
+        float abbe_;
     };
 } // namespace akane
\ No newline at end of file
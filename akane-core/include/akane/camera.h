@@ -21,6 +21,17 @@ namespace akane
         return Point2f{uu, vv};
     }
 
+    /**
+     * Connection from a point in the scene to the lens, for paths traced from lights
+     */
+    struct ImportanceSample
+    {
+        Point2f uv;      // where the point appears on the screen
+        Vec3 point;      // on the lens
+        float we  = 0.f; // importance emitted from the lens toward the point
+        float pdf = 0.f; // density of the lens point in solid angle as seen from the point
+    };
+
     /**
      * Interface for camera object
      */
@@ -30,6 +41,64 @@ namespace akane
         // spawn ray according to uv coordinate in the screen
         // usually, uv is in [-1, 1]
         virtual Ray SpawnRay(Point2f uv) const noexcept = 0;
+
+        // spawn ray at a time uniformly sampled in the shutter interval
+        Ray SpawnRay(Point2f uv, float u_time) const noexcept
+        {
+            auto ray = SpawnRay(uv);
+            ray.time = ShutterTime(u_time);
+
+            return ray;
+        }
+
+        // spawn ray with differentials toward uv + duv, where duv is usually the size of a pixel
+        // in the screen; cameras that don't support differentials spawn a ray without them
+        virtual Ray SpawnRayDifferential(Point2f uv, Vec2 duv) const noexcept
+        {
+            return SpawnRay(uv);
+        }
+
+        Ray SpawnRayDifferential(Point2f uv, Vec2 duv, float u_time) const noexcept
+        {
+            auto ray = SpawnRayDifferential(uv, duv);
+            ray.time = ShutterTime(u_time);
+
+            return ray;
+        }
+
+        // following are for tracing paths from lights toward the camera, which only cameras with
+        // a pinhole implement
+
+        // connect p to the lens, returning false if p isn't seen on the screen
+        virtual bool SampleWi(const Vec3& p, ImportanceSample& sample_out) const noexcept
+        {
+            return false;
+        }
+
+        // density in solid angle of SpawnRay choosing direction d for uv uniform on the screen
+        virtual float PdfWe(const Vec3& d) const noexcept
+        {
+            return 0.f;
+        }
+
+        // time at u of the shutter interval, for paths that don't start from the camera
+        float ShutterTime(float u) const noexcept
+        {
+            return shutter_open_ + u * (shutter_close_ - shutter_open_);
+        }
+
+        // shutter interval within the frame, where [0, 1] spans every keyframe of moving geometry
+        void SetShutter(float open, float close)
+        {
+            AKANE_REQUIRE(0.f <= open && open <= close && close <= 1.f);
+
+            shutter_open_  = open;
+            shutter_close_ = close;
+        }
+
+    private:
+        float shutter_open_  = 0.f;
+        float shutter_close_ = 1.f;
     };
 
     // fov: horizontal field of view, should in (0, 1],default is 90 degrees
@@ -3,6 +3,7 @@
 #include "akane/spectrum.h"
 #include <vector>
 #include <memory>
+#include <atomic>
 
 namespace akane
 {
@@ -49,7 +50,7 @@ namespace akane
 
             buffer_[offset]      = color[0];
             buffer_[offset + 1u] = color[1];
-            buffer_[offset + 2u] = color[1];
+            buffer_[offset + 2u] = color[2];
         }
         void IncrementPixel(int x, int y, Spectrum delta)
         {
@@ -83,4 +84,47 @@ namespace akane
         int height_;
         std::vector<float> buffer_;
     };
+
+    /**
+     * Film where paths traced from lights add radiance at any point of the screen, which is
+     * shared by every thread rendering the image
+     */
+    class SplatFilm
+    {
+    public:
+        SplatFilm(int width, int height)
+            : width_(width), height_(height), buffer_(static_cast<size_t>(width) * height * 3)
+        {
+            AKANE_ASSERT(width > 0 && height > 0);
+            Clear();
+        }
+
+        int Width() const noexcept
+        {
+            return width_;
+        }
+        int Height() const noexcept
+        {
+            return height_;
+        }
+
+        // add radiance to the pixel containing uv, thread-safe
+        void Splat(Point2f uv, Spectrum value) noexcept;
+
+        // add what's splatted to the canvas, not to be called along with Splat
+        void Resolve(Canvas& canvas, float scalar = 1.f) const;
+
+        void Clear() noexcept
+        {
+            for (auto& value : buffer_)
+            {
+                value.store(0.f, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        int width_;
+        int height_;
+        std::vector<std::atomic<float>> buffer_;
+    };
 } // namespace akane
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include "akane/common/basic.h"
+#include <vector>
+
+namespace akane
+{
+    /**
+     * Immutable array whose storage is shared among copies
+     *
+     * Elements either live in a std::vector owned by the array, or in external memory (e.g. a
+     * memory-mapped file) that is kept alive by the owner. At least one more element is always
+     * readable past the end, so the data could be handed to embree directly.
+     */
+    template <typename T> class SharedArray
+    {
+    public:
+        SharedArray() = default;
+
+        SharedArray(std::vector<T> data)
+        {
+            data.reserve(data.size() + 1);
+
+            auto storage = make_shared<std::vector<T>>(std::move(data));
+            data_        = storage->data();
+            size_        = storage->size();
+            owner_       = std::move(storage);
+        }
+
+        // view into external memory, which must stay valid until owner is released
+        SharedArray(shared_ptr<const void> owner, const T* data, size_t size)
+            : owner_(std::move(owner)), data_(data), size_(size)
+        {
+        }
+
+        const T* data() const noexcept
+        {
+            return data_;
+        }
+        size_t size() const noexcept
+        {
+            return size_;
+        }
+        bool empty() const noexcept
+        {
+            return size_ == 0;
+        }
+
+        const T* begin() const noexcept
+        {
+            return data_;
+        }
+        const T* end() const noexcept
+        {
+            return data_ + size_;
+        }
+
+        const T& operator[](size_t index) const noexcept
+        {
+            return data_[index];
+        }
+
+    private:
+        shared_ptr<const void> owner_ = nullptr;
+
+        const T* data_ = nullptr;
+        size_t size_   = 0;
+    };
+} // namespace akane
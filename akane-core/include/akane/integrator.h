@@ -9,16 +9,49 @@
 
 namespace akane
 {
+    class Camera;
+    class SplatFilm;
+
     struct RenderingContext
     {
         Workspace workspace;
+
+        // where integrators that connect paths to the camera splat them, both nullptr if it's not
+        // supported by the renderer
+        const Camera* camera  = nullptr;
+        SplatFilm* splat_film = nullptr;
     };
 
+    // if nothing blocks the segment from a to b, where hits close to b relative to the length of
+    // the segment count as reaching b
+    inline bool TestSegmentVisibility(RenderingContext& ctx, const Scene& scene, const Vec3& a,
+                                      const Vec3& b, float time)
+    {
+        constexpr float kRelativeTolerance = 1e-3f;
+
+        auto distance = (b - a).Length();
+
+        IntersectionInfo isect;
+        if (!scene.Intersect(RayFromTo(a, b, time), ctx.workspace, isect))
+        {
+            return true;
+        }
+
+        return isect.t >= distance * (1.f - kRelativeTolerance);
+    }
+
     class Integrator : public Object
     {
     public:
         // compute radiance along a camera ray
         virtual Spectrum Li(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
                             const Ray& camera_ray) const = 0;
+
+        // if Li splats contributions to other pixels through RenderingContext::splat_film, which
+        // renderers only allocate for integrators that ask for it
+        virtual bool UseSplatFilm() const
+        {
+            return false;
+        }
     };
 } // namespace akane
\ No newline at end of file
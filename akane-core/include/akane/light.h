@@ -9,6 +9,8 @@ namespace akane
 {
     class Scene;
     class Primitive;
+    class Medium;
+    class Sampler;
 
     // TODO: allow visibility test for global light
     class LightSample
@@ -19,17 +21,23 @@ namespace akane
         {
         }
 
+        // time is where the test happens in the shutter interval
         bool TestVisibility(const Scene& scene, Workspace& workspace, const Vec3& p,
-                            const Primitive* obj) const;
+                            const Primitive* obj, float time = 0.f) const;
 
-        Ray GenerateTestRay(const Vec3& p) const noexcept
+        // transmittance from p, which is in the medium, to the light source, where surfaces only
+        // bounding media are passed through and other surfaces block the light
+        Spectrum EvalTransmittance(const Scene& scene, Workspace& workspace, Sampler& sampler,
+                                   const Vec3& p, const Medium* medium, float time = 0.f) const;
+
+        Ray GenerateTestRay(const Vec3& p, float time = 0.f) const noexcept
         {
-            return RayFromTo(point_, p);
+            return RayFromTo(point_, p, time);
         }
 
-        Ray GenerateShadowRay(const Vec3& p) const noexcept
+        Ray GenerateShadowRay(const Vec3& p, float time = 0.f) const noexcept
         {
-            return RayFromTo(p, point_);
+            return RayFromTo(p, point_, time);
         }
 
         // point of light source
@@ -38,12 +46,39 @@ namespace akane
             return point_;
         }
 
-        // probability distribution of the particular point
+        // normal at the point, zero for a delta light source
+        Vec3 Normal() const noexcept
+        {
+            return normal_;
+        }
+
+        bool IsGlobal() const noexcept
+        {
+            return global_;
+        }
+
+        // probability distribution of the particular point, or of the direction toward the point
+        // in solid angle if this is a sample from global light
         float Pdf() const noexcept
         {
             return pdf_;
         }
 
+        // density of the sample in solid angle as seen from p, where points on area lights are
+        // sampled by area
+        float SolidAnglePdf(const Vec3& p) const noexcept
+        {
+            if (global_ || normal_ == Vec3{0.f})
+            {
+                return pdf_;
+            }
+
+            auto w         = p - point_;
+            auto dist_sq   = w.LengthSq();
+            auto cos_light = abs(Dot(normal_, w)) / sqrt(dist_sq);
+            return cos_light > 0 ? pdf_ * dist_sq / cos_light : 0.f;
+        }
+
     private:
         Vec3 point_;  // point at light source
         Vec3 normal_; // zero if light comes from a delta light source
@@ -63,6 +98,47 @@ namespace akane
         virtual LightSample SampleLi(const Point2f& u) const = 0;
 
         virtual float Power() const = 0;
+
+        // density in solid angle of SampleLi choosing direction wi, only global lights that are
+        // sampled by direction need to implement this
+        virtual float PdfLi(const Vec3& wi) const
+        {
+            return 0.f;
+        }
+
+        // following are for tracing paths from light sources, which only lights placed in the
+        // scene rather than the global light implement
+
+        // sample a ray leaving the light, where pdf_pos_out is density of the origin in area (one
+        // for a point light) and pdf_dir_out of the direction in solid angle. Returns radiance
+        // emitted along the ray, or intensity for a point light
+        virtual Spectrum SampleLe(const Point2f& u_pos, const Point2f& u_dir, Ray& ray_out,
+                                  Vec3& normal_out, float& pdf_pos_out, float& pdf_dir_out) const
+        {
+            pdf_pos_out = 0.f;
+            pdf_dir_out = 0.f;
+            return kBlackSpectrum;
+        }
+
+        // radiance, or intensity for a point light, emitted from p with normal n in direction d
+        virtual Spectrum Le(const Vec3& p, const Vec3& n, const Vec3& d) const
+        {
+            return kBlackSpectrum;
+        }
+
+        // densities of SampleLe generating the ray from p with normal n in direction d
+        virtual void PdfLe(const Vec3& p, const Vec3& n, const Vec3& d, float& pdf_pos_out,
+                           float& pdf_dir_out) const
+        {
+            pdf_pos_out = 0.f;
+            pdf_dir_out = 0.f;
+        }
+
+        // if the light emits from a single point, which could never be hit by a ray
+        virtual bool IsDeltaPosition() const
+        {
+            return false;
+        }
     };
 
     class AreaLight : public Light
@@ -10,9 +10,14 @@ namespace akane
     class Material : public Object
     {
     public:
-        // compute bsdf allocated at workspace given
-        virtual const Bsdf* ComputeBsdf(Workspace& workspace,
-                                        const IntersectionInfo& isect) const = 0;
+        // bake constant parameters into what ComputeBsdf reads, which is called on scene commit
+        // and must be called again after the material is edited
+        virtual void Compile()
+        {
+        }
+
+        // compute bsdf at the hit point, returns false if the surface doesn't scatter
+        virtual bool ComputeBsdf(const IntersectionInfo& isect, Bsdf& bsdf_out) const = 0;
 
         virtual Spectrum ComputePreviewColor(Vec2 uv) const
         {
@@ -0,0 +1,93 @@
+#pragma once
+#include "akane/math/math.h"
+#include <limits>
+
+namespace akane
+{
+    // axis-aligned bounding box
+    struct Bounds3
+    {
+        Vec3 lower = Vec3{std::numeric_limits<float>::infinity()};
+        Vec3 upper = Vec3{-std::numeric_limits<float>::infinity()};
+
+        constexpr Bounds3() noexcept = default;
+        constexpr Bounds3(Vec3 p) noexcept : lower(p), upper(p)
+        {
+        }
+        constexpr Bounds3(Vec3 lower, Vec3 upper) noexcept : lower(lower), upper(upper)
+        {
+        }
+
+        bool Empty() const noexcept
+        {
+            return lower[0] > upper[0] || lower[1] > upper[1] || lower[2] > upper[2];
+        }
+
+        Vec3 Diagonal() const noexcept
+        {
+            return upper - lower;
+        }
+
+        Vec3 Centroid() const noexcept
+        {
+            return (lower + upper) * .5f;
+        }
+
+        float SurfaceArea() const noexcept
+        {
+            if (Empty())
+            {
+                return 0.f;
+            }
+
+            auto d = Diagonal();
+            return 2.f * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+        }
+
+        // index of the axis with the largest extent
+        int MaxExtent() const noexcept
+        {
+            auto d = Diagonal();
+            if (d[0] > d[1] && d[0] > d[2])
+            {
+                return 0;
+            }
+            else
+            {
+                return d[1] > d[2] ? 1 : 2;
+            }
+        }
+
+        // relative position of p in the box where lower maps to 0 and upper maps to 1
+        Vec3 Offset(const Vec3& p) const noexcept
+        {
+            Vec3 result = p - lower;
+            for (int i = 0; i < 3; ++i)
+            {
+                if (upper[i] > lower[i])
+                {
+                    result[i] /= upper[i] - lower[i];
+                }
+            }
+
+            return result;
+        }
+    };
+
+    inline Bounds3 Union(const Bounds3& a, const Bounds3& b) noexcept
+    {
+        Bounds3 result;
+        for (int i = 0; i < 3; ++i)
+        {
+            result.lower[i] = min(a.lower[i], b.lower[i]);
+            result.upper[i] = max(a.upper[i], b.upper[i]);
+        }
+
+        return result;
+    }
+
+    inline Bounds3 Union(const Bounds3& a, const Vec3& p) noexcept
+    {
+        return Union(a, Bounds3{p});
+    }
+} // namespace akane
@@ -1,5 +1,7 @@
 #pragma once
+#include "akane/common/basic.h"
 #include "akane/math/math.h"
+#include <algorithm>
 #include <vector>
 
 namespace akane
@@ -13,26 +15,50 @@ namespace akane
             Reset(weight_begin, weight_end);
         }
 
+        int Count() const noexcept
+        {
+            return static_cast<int>(thresholds_.size());
+        }
+
+        // sum of weights before normalization
+        float Total() const noexcept
+        {
+            return total_;
+        }
+
         int Sample(float u, float& pdf_out) const
         {
-            if (u < thresholds_.front())
-            {
-                pdf_out = thresholds_.front();
-                return 0;
-            }
+            float u_remapped;
+            return Sample(u, pdf_out, u_remapped);
+        }
 
-            for (int i = 1; i < thresholds_.size(); ++i)
+        // u_remapped is where u falls in the chosen entry, uniformly distributed in [0, 1)
+        int Sample(float u, float& pdf_out, float& u_remapped) const
+        {
+            // NOTE entries of zero weight are never chosen as the first threshold greater than u
+            //      always belongs to an entry of non-zero weight
+            auto iter  = std::upper_bound(thresholds_.begin(), thresholds_.end(), u);
+            auto index = static_cast<int>(iter - thresholds_.begin());
+            if (index == Count())
             {
-                if (u >= thresholds_[i - 1] && u < thresholds_[i])
-                {
-                    pdf_out = thresholds_[i] - thresholds_[i - 1];
-                    return i;
-                }
+                // u is not less than 1 due to float error, take the last entry of non-zero weight
+                index = static_cast<int>(
+                    std::lower_bound(thresholds_.begin(), thresholds_.end(), thresholds_.back()) -
+                    thresholds_.begin());
             }
 
-            // error
-            pdf_out = 0;
-            return -1;
+            auto lower = index > 0 ? thresholds_[index - 1] : 0.f;
+            auto upper = thresholds_[index];
+
+            pdf_out    = upper - lower;
+            u_remapped = std::min((u - lower) / pdf_out, kOneMinusEpsilon);
+            return index;
+        }
+
+        float Pdf(int index) const noexcept
+        {
+            AKANE_ASSERT(index >= 0 && index < Count());
+            return index > 0 ? thresholds_[index] - thresholds_[index - 1] : thresholds_[0];
         }
 
         void Reset(const float* weight_begin, const float* weight_end)
@@ -47,6 +73,7 @@ namespace akane
                 thresholds_.push_back(acc);
             }
 
+            total_ = acc;
             if (acc != 0)
             {
                 for (auto& x : thresholds_)
@@ -54,14 +81,94 @@ namespace akane
                     x /= acc;
                 }
             }
+            else if (!thresholds_.empty())
+            {
+                // all entries are equally likely if there's no weight at all
+                for (size_t i = 0; i < thresholds_.size(); ++i)
+                {
+                    thresholds_[i] = static_cast<float>(i + 1) / thresholds_.size();
+                }
+            }
             else
             {
                 thresholds_.push_back(1.f);
             }
+
+            thresholds_.back() = 1.f;
         }
 
     private:
+        static constexpr float kOneMinusEpsilon = 0x1.fffffep-1f;
+
         std::vector<float> thresholds_{1.f};
+        float total_ = 0.f;
     };
 
-} // namespace akane
\ No newline at end of file
+    /**
+     * Piecewise-constant distribution over the unit square, with weights given on a grid of
+     * width x height cells in row-major order
+     *
+     * A row is chosen from the marginal distribution first, and then a column from the
+     * conditional distribution of that row.
+     */
+    class Distribution2D
+    {
+    public:
+        Distribution2D() = default;
+        Distribution2D(const float* weights, int width, int height)
+        {
+            Reset(weights, width, height);
+        }
+
+        // point in the unit square, and its density with respect to area of the square
+        Point2f Sample(const Point2f& u, float& pdf_out) const
+        {
+            float pdf_row, pdf_column;
+            float u_row, u_column;
+
+            auto row    = marginal_.Sample(u[1], pdf_row, u_row);
+            auto column = conditional_[row].Sample(u[0], pdf_column, u_column);
+
+            pdf_out = pdf_row * pdf_column * width_ * height_;
+            return Point2f{(column + u_column) / width_, (row + u_row) / height_};
+        }
+
+        float Pdf(const Point2f& p) const noexcept
+        {
+            auto column = std::clamp(static_cast<int>(p[0] * width_), 0, width_ - 1);
+            auto row    = std::clamp(static_cast<int>(p[1] * height_), 0, height_ - 1);
+
+            return marginal_.Pdf(row) * conditional_[row].Pdf(column) * width_ * height_;
+        }
+
+        void Reset(const float* weights, int width, int height)
+        {
+            AKANE_REQUIRE(width > 0 && height > 0);
+
+            width_  = width;
+            height_ = height;
+
+            conditional_.clear();
+            conditional_.reserve(height);
+
+            std::vector<float> row_weights;
+            row_weights.reserve(height);
+            for (int y = 0; y < height; ++y)
+            {
+                auto row = weights + static_cast<size_t>(y) * width;
+
+                conditional_.emplace_back(row, row + width);
+                row_weights.push_back(conditional_.back().Total());
+            }
+
+            marginal_.Reset(row_weights.data(), row_weights.data() + row_weights.size());
+        }
+
+    private:
+        int width_  = 1;
+        int height_ = 1;
+
+        std::vector<DiscrateDistribution> conditional_ = {DiscrateDistribution{}};
+        DiscrateDistribution marginal_;
+    };
+} // namespace akane
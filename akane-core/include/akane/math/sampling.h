@@ -75,4 +75,14 @@ namespace akane
         return z / kPi;
     }
 
+    // weight of a sample from strategy f against strategy g for multiple importance sampling,
+    // using power heuristic with exponent of 2
+    inline float PowerHeuristic(float pdf_f, float pdf_g) noexcept
+    {
+        auto f = pdf_f * pdf_f;
+        auto g = pdf_g * pdf_g;
+
+        return f > 0 ? f / (f + g) : 0.f;
+    }
+
 } // namespace akane
\ No newline at end of file
@@ -99,6 +99,12 @@ namespace akane
             return Vec3{xx, yy, zz};
         }
 
+        bool IsIdentity() const noexcept
+        {
+            return vx_ == Vec3{1, 0, 0} && vy_ == Vec3{0, 1, 0} && vz_ == Vec3{0, 0, 1} &&
+                   p_ == Vec3{0, 0, 0};
+        }
+
         void Print() const noexcept
         {
             fmt::print("{:.6f}, {:.6f}, {:.6f}", vx_[0], vy_[0], vz_[0]);
@@ -0,0 +1,121 @@
+#pragma once
+#include "akane/common/basic.h"
+#include "akane/math/math.h"
+#include "akane/ray.h"
+#include "akane/sampler.h"
+#include "akane/spectrum.h"
+#include <memory>
+
+namespace akane
+{
+    struct MediumDesc;
+
+    /**
+     * Henyey-Greenstein phase function, where g in (-1, 1) is the mean cosine of the scattering
+     * angle, i.e. positive g scatters forward
+     *
+     * Directions are those the light travels in, so that cos_theta = 1 means no deflection.
+     */
+    class HenyeyGreenstein
+    {
+    public:
+        explicit HenyeyGreenstein(float g = 0.f) : g_(clamp(g, -.99f, .99f))
+        {
+        }
+
+        float Eval(const Vec3& d_in, const Vec3& d_out) const noexcept
+        {
+            auto cos_theta = Dot(d_in, d_out);
+            auto denom     = 1.f + g_ * g_ - 2.f * g_ * cos_theta;
+
+            return (1.f - g_ * g_) / (4.f * kPi * denom * sqrt(denom));
+        }
+
+        // sampled exactly, so that the pdf equals the phase function
+        Vec3 Sample(const Vec3& d_in, const Point2f& u, float& pdf_out) const noexcept
+        {
+            float cos_theta;
+            if (abs(g_) < 1e-3f)
+            {
+                cos_theta = 1.f - 2.f * u[0];
+            }
+            else
+            {
+                auto root = (1.f - g_ * g_) / (1.f + g_ - 2.f * g_ * u[0]);
+                cos_theta = (1.f + g_ * g_ - root * root) / (2.f * g_);
+            }
+
+            auto sin_theta = sqrt(max(0.f, 1.f - cos_theta * cos_theta));
+            auto phi       = kTwoPi * u[1];
+
+            // any frame around d_in works for an isotropic medium
+            auto t1 = abs(d_in.X()) > .9f ? Vec3{0.f, 1.f, 0.f} : Vec3{1.f, 0.f, 0.f};
+            t1      = Cross(d_in, t1).Normalized();
+            auto t2 = Cross(d_in, t1);
+
+            auto d_out = sin_theta * cos(phi) * t1 + sin_theta * sin(phi) * t2 + cos_theta * d_in;
+
+            pdf_out = Eval(d_in, d_out);
+            return d_out;
+        }
+
+    private:
+        float g_;
+    };
+
+    /**
+     * Participating medium that absorbs and scatters light along rays travelling in it
+     *
+     * Distances are measured in units of the ray, whose direction is assumed to be normalized.
+     * Methods taking a sampler may return stochastic but unbiased estimates.
+     */
+    class Medium : public Object
+    {
+    public:
+        using SharedPtr = std::shared_ptr<Medium>;
+
+        explicit Medium(float g) : phase_(g)
+        {
+        }
+
+        // sample a free flight distance in (0, t_max), returns true if the ray is scattered at
+        // t_out before reaching t_max. weight_out is throughput of the sample, i.e.
+        // transmittance, multiplied by sigma_s if scattered, over probability of the sample
+        virtual bool SampleInteraction(const Ray& ray, float t_max, Sampler& sampler,
+                                       float& t_out, Spectrum& weight_out) const = 0;
+
+        // transmittance along the ray from its origin to t_max
+        virtual Spectrum Transmittance(const Ray& ray, float t_max, Sampler& sampler) const = 0;
+
+        const HenyeyGreenstein& GetPhase() const noexcept
+        {
+            return phase_;
+        }
+
+    private:
+        HenyeyGreenstein phase_;
+    };
+
+    // media on both sides of a surface bounding them, nullptr means vacuum
+    struct MediumInterface
+    {
+        const Medium* inside  = nullptr;
+        const Medium* outside = nullptr;
+    };
+
+    // medium that a ray leaving the hit point in direction d travels in, where the ray keeps the
+    // current medium unless the surface bounds media
+    inline const Medium* NextMedium(const IntersectionInfo& isect, const Vec3& d,
+                                    const Medium* current) noexcept
+    {
+        if (isect.medium_interface == nullptr)
+        {
+            return current;
+        }
+
+        return Dot(d, isect.ng) < 0 ? isect.medium_interface->inside
+                                    : isect.medium_interface->outside;
+    }
+
+    shared_ptr<Medium> CreateMedium(const MediumDesc& desc);
+} // namespace akane
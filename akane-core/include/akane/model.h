@@ -1,5 +1,9 @@
 #pragma once
 #include "akane/texture.h"
+#include "akane/math/transform.h"
+#include "akane/common/shared_array.h"
+#include <functional>
+#include <future>
 #include <memory>
 #include <vector>
 #include <string>
@@ -7,6 +11,51 @@
 
 namespace akane
 {
+    /**
+     * Texture whose decoding may still be pending
+     *
+     * Decoding is deferred to the first call to Get, which may happen on any thread. Concurrent
+     * calls wait for the same decode, and an exception thrown while decoding is rethrown by
+     * every call.
+     */
+    class TextureHandle
+    {
+    public:
+        TextureHandle() = default;
+
+        // wrap a texture that is already loaded
+        TextureHandle(shared_ptr<Texture3D> texture)
+        {
+            if (texture != nullptr)
+            {
+                std::promise<shared_ptr<Texture3D>> promise;
+                promise.set_value(std::move(texture));
+                future_ = promise.get_future().share();
+            }
+        }
+
+        static TextureHandle Defer(std::function<shared_ptr<Texture3D>()> loader)
+        {
+            TextureHandle result;
+            result.future_ = std::async(std::launch::deferred, std::move(loader)).share();
+            return result;
+        }
+
+        bool IsNull() const noexcept
+        {
+            return !future_.valid();
+        }
+
+        // the texture, or nullptr if there's none; blocks until it's decoded
+        shared_ptr<Texture3D> Get() const
+        {
+            return future_.valid() ? future_.get() : nullptr;
+        }
+
+    private:
+        std::shared_future<shared_ptr<Texture3D>> future_;
+    };
+
     struct MaterialDesc
     {
         std::string name;
@@ -18,22 +67,25 @@ namespace akane
 
         Vec3 emission = {};
 
-        shared_ptr<Texture3D> ambient_texture  = nullptr;
-        shared_ptr<Texture3D> diffuse_texture  = nullptr;
-        shared_ptr<Texture3D> specular_texture = nullptr;
+        // resolved by LoadSceneDesc, or on first access if the mesh is loaded alone
+        TextureHandle ambient_texture;
+        TextureHandle diffuse_texture;
+        TextureHandle specular_texture;
 
         // pbr
-        float eta       = 10.f;
-        float roughness = 0.f;
+        float eta        = 10.f;
+        float abbe       = 0.f; // dispersion of eta in spectral rendering, from "abbe" in mtl
+        float roughness  = 0.f;
+        float anisotropy = 0.f; // in [0, 1), stretches highlights along the u direction
     };
 
     struct GeometryDesc
     {
         std::string name;
 
-        std::vector<Point3i> triangle_indices;
-        std::vector<Point3i> normal_indices;
-        std::vector<Point3i> uv_indices;
+        SharedArray<Point3i> triangle_indices;
+        SharedArray<Point3i> normal_indices;
+        SharedArray<Point3i> uv_indices;
 
         shared_ptr<MaterialDesc> material;
     };
@@ -42,22 +94,59 @@ namespace akane
     {
         std::string name; // usu. obj file path
 
-        std::vector<Point3f> vertices;
-        std::vector<Point3f> normals;
-        std::vector<Point2f> uv;
+        uint64_t source_hash = 0; // content hash of the source file
+
+        // arrays may be views into a memory-mapped mesh cache
+        SharedArray<Point3f> vertices;
+        SharedArray<Point3f> normals;
+        SharedArray<Point2f> uv;
 
-        std::unordered_map<std::string, shared_ptr<Texture3D>> texture_lookup;
+        std::unordered_map<std::string, TextureHandle> texture_lookup;
 
         std::vector<shared_ptr<GeometryDesc>> geomtries;
     };
 
+    struct MediumDesc
+    {
+        std::string type; // "homogeneous" or "grid"
+
+        // homogeneous, in inverse units of the world space
+        Vec3 sigma_a = {};
+        Vec3 sigma_s = {};
+
+        // grid, where extinction is density times sigma_t
+        std::string density_file; // Mitsuba volume file
+        float sigma_t = 1.f;
+        Vec3 albedo   = {1.f, 1.f, 1.f};
+
+        float g = 0.f; // anisotropy of the phase function
+
+        // whether the mesh bounding the medium also scatters light with its own materials,
+        // otherwise it's an invisible boundary
+        bool surface_visible = false;
+    };
+
+    struct KeyframeDesc
+    {
+        float scale;
+        Vec3 position;
+        Vec3 rotation;
+    };
+
     struct PrimitiveDesc
     {
-        shared_ptr<MeshDesc> mesh;
+        shared_ptr<const MeshDesc> mesh; // shared by primitives of the same obj file
 
         float scale;
         Vec3 position;
         Vec3 rotation;
+
+        // following keyframes of a moving object, evenly distributed in the frame together with
+        // the transform above
+        std::vector<KeyframeDesc> motion;
+
+        // medium filling the interior of the mesh, which should be closed, if any
+        shared_ptr<MediumDesc> medium;
     };
 
     struct CameraDesc
@@ -68,6 +157,16 @@ namespace akane
 
         float fov = 0.5f; // horizontal field of view, should in(0, 1], default is 90 degrees
         float aspect_ratio = 1.f; // vertical over horizontal
+
+        // shutter interval in the frame for motion blur, should in [0, 1]
+        float shutter_open  = 0.f;
+        float shutter_close = 1.f;
+    };
+
+    struct EnvironmentDesc
+    {
+        std::string image_file; // lat-long HDR image, empty if there's no environment light
+        float scale = 1.f;      // multiplier of radiance in the image
     };
 
     struct SceneDesc
@@ -75,10 +174,16 @@ namespace akane
         std::string name;
 
         CameraDesc camera;
+        EnvironmentDesc environment;
         std::vector<PrimitiveDesc> objects;
+
+        shared_ptr<MediumDesc> medium; // medium the camera is in, if any
     };
 
     shared_ptr<MeshDesc> LoadMeshDesc(const std::string& filename);
     unique_ptr<SceneDesc> LoadSceneDesc(const std::string& filename);
 
+    // transform of every keyframe of the primitive, which contains at least one element
+    std::vector<Transform> ComputeKeyframeTransforms(const PrimitiveDesc& desc);
+
 } // namespace akane
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "akane/common/basic.h"
 #include "akane/ray.h"
+#include "akane/math/bounds.h"
 #include <memory>
 #include <vector>
 
@@ -15,6 +16,9 @@ namespace akane
         virtual bool Intersect(const Ray& ray, float t_min, float t_max,
                                IntersectionInfo& isect) const = 0;
 
+        // compute world space bounding box of the primitive
+        virtual Bounds3 Bound() const = 0;
+
         // compute surface area of the primitive
         virtual float Area() const = 0;
 
@@ -6,18 +6,39 @@ namespace akane
 {
     class AreaLight;
     class Material;
+    class Medium;
     class Primitive;
+    struct MediumInterface;
+
+    // derivatives of a ray with respect to x and y in screen space, i.e. the offset to rays
+    // through neighbouring pixels
+    struct RayDifferential
+    {
+        Vec3 dodx = {};
+        Vec3 dody = {};
+        Vec3 dddx = {};
+        Vec3 dddy = {};
+    };
 
     struct Ray
     {
         Vec3 o; // origin
         Vec3 d; // direction
+
+        float time = 0.f; // time in the camera shutter interval, normalized to [0, 1]
+
+        // differentials are only tracked for camera rays and their specular bounces
+        bool has_differentials = false;
+        RayDifferential differential;
+
+        // medium that the ray travels in, nullptr for vacuum
+        const Medium* medium = nullptr;
     };
 
     // create a ray from src point to dest point
-    inline Ray RayFromTo(Vec3 src, Vec3 dest) noexcept
+    inline Ray RayFromTo(Vec3 src, Vec3 dest, float time = 0.f) noexcept
     {
-        return Ray{src, (dest - src).Normalized()};
+        return Ray{src, (dest - src).Normalized(), time};
     }
 
     struct IntersectionInfo
@@ -37,6 +58,17 @@ namespace akane
         // uv coordianate at the hit point for texture mapping
         Vec2 uv = {0.f, 0.f};
 
+        // partial derivatives of the point with respect to uv, zero if unknown
+        Vec3 dpdu = {};
+        Vec3 dpdv = {};
+
+        // footprint of the ray at the hit point in world space and in uv, which are computed by
+        // ComputeDifferentials and left zero if the ray has no differentials
+        Vec3 dpdx  = {};
+        Vec3 dpdy  = {};
+        Vec2 duvdx = {};
+        Vec2 duvdy = {};
+
         // triangle index for embree scene
         unsigned index = 0;
 
@@ -48,5 +80,53 @@ namespace akane
 
         // area light instance at the hit surface, if any
         const AreaLight* area_light = nullptr;
+
+        // media bounded by the hit surface, nullptr if the surface doesn't bound any
+        const MediumInterface* medium_interface = nullptr;
     };
+
+    // transfer differentials of the ray onto tangent plane at the hit point, and project the
+    // footprint into uv
+    inline void ComputeDifferentials(const Ray& ray, IntersectionInfo& isect) noexcept
+    {
+        if (!ray.has_differentials)
+        {
+            return;
+        }
+
+        auto dn = Dot(ray.d, isect.ng);
+        if (abs(dn) < 1e-6f)
+        {
+            return;
+        }
+
+        const auto& rd = ray.differential;
+
+        auto transfer = [&](const Vec3& dodx, const Vec3& dddx) {
+            auto dp = dodx + isect.t * dddx;
+            return dp - Dot(dp, isect.ng) / dn * ray.d;
+        };
+
+        isect.dpdx = transfer(rd.dodx, rd.dddx);
+        isect.dpdy = transfer(rd.dody, rd.dddy);
+
+        // least squares of dpdx = dpdu * dudx + dpdv * dvdx
+        auto a   = Dot(isect.dpdu, isect.dpdu);
+        auto b   = Dot(isect.dpdu, isect.dpdv);
+        auto c   = Dot(isect.dpdv, isect.dpdv);
+        auto det = a * c - b * b;
+        if (!(abs(det) > 1e-8f * a * c))
+        {
+            return;
+        }
+
+        auto project = [&](const Vec3& dp) {
+            auto pu = Dot(isect.dpdu, dp);
+            auto pv = Dot(isect.dpdv, dp);
+            return Vec2{(c * pu - b * pv) / det, (a * pv - b * pu) / det};
+        };
+
+        isect.duvdx = project(isect.dpdx);
+        isect.duvdy = project(isect.dpdy);
+    }
 } // namespace akane
\ No newline at end of file
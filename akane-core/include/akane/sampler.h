@@ -31,6 +31,17 @@ namespace akane
         RandomEngine engine_;
     };
 
+    // seed of the sampler for a chunk of work in a stream, e.g. a pass of an iteration. Seeding by
+    // chunks of fixed size rather than by threads keeps results independent of scheduling
+    inline uint64_t MixSeed(uint64_t seed, uint64_t stream, uint64_t chunk) noexcept
+    {
+        // splitmix64 finalizer
+        uint64_t x = (seed << 32) ^ stream * 0x9e3779b97f4a7c15ull ^ (chunk << 16);
+        x          = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x          = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
     inline Sampler::Ptr CreateRandomSampler(uint64_t seed)
     {
         return std::make_unique<Sampler>(seed);
@@ -1,10 +1,16 @@
 #pragma once
 #include "akane/common/basic.h"
+#include "akane/math/bounds.h"
 #include "akane/math/distribution.h"
 #include "akane/ray.h"
 #include "akane/light.h"
+#include "akane/material.h"
+#include "akane/medium.h"
 #include "edslib/memory/arena.h"
+#include <algorithm>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace akane
@@ -20,12 +26,16 @@ namespace akane
 
         virtual void Commit()
         {
+            CompileMaterials();
             UpdataLightDistribution();
         }
 
         virtual bool Intersect(const Ray& ray, Workspace& workspace,
                                IntersectionInfo& isect) const = 0;
 
+        // bound of geometries as of the last commit
+        virtual Bounds3 Bound() const = 0;
+
         Light* GetGlobalLight() const noexcept
         {
             return global_light_;
@@ -48,16 +58,52 @@ namespace akane
             return lights_[index];
         }
 
+        // probability of SampleLight choosing the light, as of the last commit
+        float PdfLight(const Light* light) const
+        {
+            auto iter = light_index_.find(light);
+            return iter != light_index_.end() ? light_dist_.Pdf(iter->second) : 0.f;
+        }
+
+        // medium that camera rays start in, nullptr for vacuum
+        void SetCameraMedium(shared_ptr<Medium> medium)
+        {
+            camera_medium_ = medium.get();
+            RegisterMedium(std::move(medium));
+        }
+
+        const Medium* GetCameraMedium() const noexcept
+        {
+            return camera_medium_;
+        }
+
+        // integrators skip tracking of media, which is costly, if there's none
+        bool HasMedia() const noexcept
+        {
+            return !media_.empty();
+        }
+
     protected:
+        void CompileMaterials()
+        {
+            for (auto material : materials_)
+            {
+                material->Compile();
+            }
+        }
+
         void UpdataLightDistribution()
         {
             float total_power = 0.f;
             std::vector<float> power_weights;
+            light_index_.clear();
             for (auto light : lights_)
             {
                 auto power = light->Power();
                 total_power += power;
                 power_weights.push_back(power);
+
+                light_index_[light] = static_cast<int>(power_weights.size()) - 1;
             }
 
             total_light_power_ = total_power;
@@ -77,11 +123,54 @@ namespace akane
             }
         }
 
+        // lights are removed in a single pass, as a mesh may bring a light for each triangle
+        void UnregisterLights(const std::unordered_set<const Light*>& lights)
+        {
+            auto removed = std::remove_if(lights_.begin(), lights_.end(), [&](const Light* light) {
+                return lights.count(light) != 0;
+            });
+            AKANE_REQUIRE(static_cast<size_t>(lights_.end() - removed) == lights.size());
+
+            lights_.erase(removed, lights_.end());
+        }
+
+        // materials are compiled on every commit, a material shared by several primitives is
+        // registered only once
+        void RegisterMaterial(Material* material)
+        {
+            if (material != nullptr)
+            {
+                materials_.insert(material);
+            }
+        }
+
+        void UnregisterMaterial(Material* material)
+        {
+            auto erased = materials_.erase(material);
+            AKANE_REQUIRE(erased == 1);
+        }
+
+        // media are referenced by raw pointers in rays and intersections, which are kept alive here
+        void RegisterMedium(shared_ptr<const Medium> medium)
+        {
+            if (medium != nullptr &&
+                std::find(media_.begin(), media_.end(), medium) == media_.end())
+            {
+                media_.push_back(std::move(medium));
+            }
+        }
+
     private:
         Light* global_light_        = nullptr;
         std::vector<Light*> lights_ = {};
 
+        std::unordered_set<Material*> materials_ = {};
+
+        const Medium* camera_medium_                 = nullptr;
+        std::vector<shared_ptr<const Medium>> media_ = {};
+
         float total_light_power_;
         DiscrateDistribution light_dist_;
+        std::unordered_map<const Light*, int> light_index_;
     };
 } // namespace akane
\ No newline at end of file
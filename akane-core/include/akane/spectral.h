@@ -0,0 +1,277 @@
+#pragma once
+#include "akane/spectrum.h"
+#include "akane/sampler.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define AKANE_SPECTRAL_SSE
+#include <immintrin.h>
+#endif
+
+namespace akane
+{
+    // visible range in nanometers, which wavelengths are sampled from
+    constexpr float kLambdaMin = 360.f;
+    constexpr float kLambdaMax = 830.f;
+
+    // wavelength where eta of a dispersive material is specified, i.e. the helium d-line
+    constexpr float kLambdaEta = 587.6f;
+
+    // eta at lambda by Cauchy's equation, fitted to eta at kLambdaEta and the Abbe number, where
+    // an Abbe number of zero means no dispersion
+    inline float DispersiveEta(float eta, float abbe, float lambda) noexcept
+    {
+        // Fraunhofer F and C lines, whose difference in eta the Abbe number is defined with
+        constexpr float kLambdaF = 486.1f;
+        constexpr float kLambdaC = 656.3f;
+
+        if (abbe <= 0)
+        {
+            return eta;
+        }
+
+        auto b = (eta - 1.f) / (abbe * (1.f / (kLambdaF * kLambdaF) - 1.f / (kLambdaC * kLambdaC)));
+        return eta + b * (1.f / (lambda * lambda) - 1.f / (kLambdaEta * kLambdaEta));
+    }
+
+    /**
+     * Values of a spectral quantity at the four wavelengths carried by a path, which are packed
+     * in an SSE register where available so that arithmetic costs about as much as RGB
+     */
+    class SampledSpectrum
+    {
+    public:
+        static constexpr int kSize = 4;
+
+        SampledSpectrum() noexcept : SampledSpectrum(0.f)
+        {
+        }
+        SampledSpectrum(float value) noexcept
+        {
+#ifdef AKANE_SPECTRAL_SSE
+            v_ = _mm_set1_ps(value);
+#else
+            v_[0] = v_[1] = v_[2] = v_[3] = value;
+#endif
+        }
+        SampledSpectrum(float x, float y, float z, float w) noexcept
+        {
+#ifdef AKANE_SPECTRAL_SSE
+            v_ = _mm_setr_ps(x, y, z, w);
+#else
+            v_[0] = x;
+            v_[1] = y;
+            v_[2] = z;
+            v_[3] = w;
+#endif
+        }
+
+        float operator[](int index) const noexcept
+        {
+            AKANE_ASSERT(index >= 0 && index < kSize);
+#ifdef AKANE_SPECTRAL_SSE
+            alignas(16) float values[kSize];
+            _mm_store_ps(values, v_);
+            return values[index];
+#else
+            return v_[index];
+#endif
+        }
+
+        float Max() const noexcept
+        {
+#ifdef AKANE_SPECTRAL_SSE
+            auto m = _mm_max_ps(v_, _mm_shuffle_ps(v_, v_, _MM_SHUFFLE(1, 0, 3, 2)));
+            m      = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(m);
+#else
+            return max(max(v_[0], v_[1]), max(v_[2], v_[3]));
+#endif
+        }
+
+        float Sum() const noexcept
+        {
+#ifdef AKANE_SPECTRAL_SSE
+            auto s = _mm_add_ps(v_, _mm_shuffle_ps(v_, v_, _MM_SHUFFLE(1, 0, 3, 2)));
+            s      = _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(s);
+#else
+            return v_[0] + v_[1] + v_[2] + v_[3];
+#endif
+        }
+
+        // each value clamped to be no less than zero
+        SampledSpectrum ClampZero() const noexcept
+        {
+#ifdef AKANE_SPECTRAL_SSE
+            return SampledSpectrum{_mm_max_ps(v_, _mm_setzero_ps())};
+#else
+            return SampledSpectrum{max(v_[0], 0.f), max(v_[1], 0.f), max(v_[2], 0.f),
+                                   max(v_[3], 0.f)};
+#endif
+        }
+
+        SampledSpectrum& operator+=(const SampledSpectrum& rhs) noexcept
+        {
+            return *this = *this + rhs;
+        }
+        SampledSpectrum& operator-=(const SampledSpectrum& rhs) noexcept
+        {
+            return *this = *this - rhs;
+        }
+        SampledSpectrum& operator*=(const SampledSpectrum& rhs) noexcept
+        {
+            return *this = *this * rhs;
+        }
+        SampledSpectrum& operator/=(const SampledSpectrum& rhs) noexcept
+        {
+            return *this = *this / rhs;
+        }
+
+        friend SampledSpectrum operator+(const SampledSpectrum& lhs,
+                                         const SampledSpectrum& rhs) noexcept
+        {
+#ifdef AKANE_SPECTRAL_SSE
+            return SampledSpectrum{_mm_add_ps(lhs.v_, rhs.v_)};
+#else
+            return lhs.Map(rhs, [](float x, float y) { return x + y; });
+#endif
+        }
+        friend SampledSpectrum operator-(const SampledSpectrum& lhs,
+                                         const SampledSpectrum& rhs) noexcept
+        {
+#ifdef AKANE_SPECTRAL_SSE
+            return SampledSpectrum{_mm_sub_ps(lhs.v_, rhs.v_)};
+#else
+            return lhs.Map(rhs, [](float x, float y) { return x - y; });
+#endif
+        }
+        friend SampledSpectrum operator*(const SampledSpectrum& lhs,
+                                         const SampledSpectrum& rhs) noexcept
+        {
+#ifdef AKANE_SPECTRAL_SSE
+            return SampledSpectrum{_mm_mul_ps(lhs.v_, rhs.v_)};
+#else
+            return lhs.Map(rhs, [](float x, float y) { return x * y; });
+#endif
+        }
+        friend SampledSpectrum operator/(const SampledSpectrum& lhs,
+                                         const SampledSpectrum& rhs) noexcept
+        {
+#ifdef AKANE_SPECTRAL_SSE
+            return SampledSpectrum{_mm_div_ps(lhs.v_, rhs.v_)};
+#else
+            return lhs.Map(rhs, [](float x, float y) { return x / y; });
+#endif
+        }
+
+    private:
+#ifdef AKANE_SPECTRAL_SSE
+        explicit SampledSpectrum(__m128 v) noexcept : v_(v)
+        {
+        }
+
+        __m128 v_;
+#else
+        template <typename F> SampledSpectrum Map(const SampledSpectrum& rhs, F f) const noexcept
+        {
+            return SampledSpectrum{f(v_[0], rhs.v_[0]), f(v_[1], rhs.v_[1]), f(v_[2], rhs.v_[2]),
+                                   f(v_[3], rhs.v_[3])};
+        }
+
+        float v_[kSize];
+#endif
+    };
+
+    inline bool InvalidSpectrum(const SampledSpectrum& s)
+    {
+        for (int i = 0; i < SampledSpectrum::kSize; ++i)
+        {
+            if (s[i] < 0 || std::isinf(s[i]) || std::isnan(s[i]))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Wavelengths carried by a path with hero wavelength sampling (Wilkie et al. 2014), where a
+     * hero wavelength is importance sampled over the visible range and the others are rotated
+     * from it by a quarter of the range in primary sample space
+     *
+     * Colors given in linear sRGB are uplifted to smooth spectra, and radiance at the wavelengths
+     * is converted back through CIE matching functions, white balanced so that a constant
+     * spectrum of one is white.
+     */
+    class SampledWavelengths
+    {
+    public:
+        static constexpr int kChannelCount = SampledSpectrum::kSize;
+
+        static SampledWavelengths Sample(Sampler& sampler);
+
+        float Hero() const noexcept
+        {
+            return lambda_[0];
+        }
+
+        float Lambda(int index) const noexcept
+        {
+            return lambda_[index];
+        }
+
+        // density of the index-th wavelength, zero if the wavelength is terminated
+        float Pdf(int index) const noexcept
+        {
+            return pdf_[index];
+        }
+
+        // drop wavelengths other than the hero, e.g. after refraction by dispersive glass that
+        // sends each wavelength in a different direction
+        void TerminateSecondary() noexcept;
+
+        bool SecondaryTerminated() const noexcept
+        {
+            return pdf_[1] == 0;
+        }
+
+        // spectrum of an sRGB color, whether it's a reflectance or an emission
+        SampledSpectrum Lift(const Spectrum& rgb) const noexcept;
+
+        // estimate of the color of radiance sampled at the wavelengths
+        Spectrum ToRGB(const SampledSpectrum& radiance) const noexcept;
+
+    private:
+        float lambda_[kChannelCount];
+        float pdf_[kChannelCount];
+
+        // basis spectra that colors are uplifted onto, at each wavelength
+        SampledSpectrum basis_[3];
+    };
+
+    /**
+     * Counterpart of SampledWavelengths in RGB rendering, where every quantity is already a color
+     */
+    class RgbWavelengths
+    {
+    public:
+        static constexpr int kChannelCount = 3;
+
+        // no sample is drawn, so that RGB rendering sees the same random numbers
+        static RgbWavelengths Sample(Sampler& sampler) noexcept
+        {
+            return RgbWavelengths{};
+        }
+
+        Spectrum Lift(const Spectrum& rgb) const noexcept
+        {
+            return rgb;
+        }
+
+        Spectrum ToRGB(const Spectrum& radiance) const noexcept
+        {
+            return radiance;
+        }
+    };
+} // namespace akane
@@ -31,11 +31,35 @@ namespace akane
         }
     }
 
-    // TODO: anti-aliasing
+    // derivatives of uv with respect to screen space, which determine the area to be filtered
+    struct TextureFootprint
+    {
+        Vec2 duvdx = {};
+        Vec2 duvdy = {};
+    };
+
     template <typename TVec> class BasicTexture : public Object
     {
     public:
         virtual TVec Eval(float u, float v) const noexcept = 0;
+
+        // textures without prefiltered levels simply ignore the footprint
+        virtual TVec EvalFiltered(float u, float v,
+                                  const TextureFootprint& footprint) const noexcept
+        {
+            return Eval(u, v);
+        }
+
+        // lookups of a whole batch, e.g. from a shading stage, footprints may be nullptr
+        virtual void EvalBatch(size_t count, const Vec2* uv, const TextureFootprint* footprints,
+                               TVec* out) const noexcept
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                out[i] = footprints != nullptr ? EvalFiltered(uv[i][0], uv[i][1], footprints[i])
+                                               : Eval(uv[i][0], uv[i][1]);
+            }
+        }
     };
 
     using Texture2D = BasicTexture<Vec2>;
@@ -0,0 +1,84 @@
+#include "akane/asset_cache.h"
+#include "akane/texture/image.h"
+
+using namespace std;
+using namespace std::filesystem;
+
+namespace akane
+{
+    AssetCache& AssetCache::Instance()
+    {
+        static AssetCache instance;
+        return instance;
+    }
+
+    template <typename T>
+    shared_ptr<AssetCache::Entry<T>> AssetCache::FindEntry(EntryTable<T>& table, const string& key)
+    {
+        lock_guard<mutex> lock{mutex_};
+
+        auto& entry = table[key];
+        if (entry == nullptr)
+        {
+            entry = make_shared<Entry<T>>();
+        }
+
+        return entry;
+    }
+
+    shared_ptr<const MeshDesc> AssetCache::LoadMesh(const string& filename)
+    {
+        auto file  = weakly_canonical(path{filename});
+        auto entry = FindEntry(meshes_, file.string());
+
+        lock_guard<mutex> lock{entry->mutex};
+
+        auto size  = file_size(file);
+        auto mtime = last_write_time(file);
+
+        auto cached = entry->asset.lock();
+        if (cached != nullptr && entry->size == size && entry->mtime == mtime)
+        {
+            return cached;
+        }
+
+        // NOTE meshes are not shared across paths by content, as materials and textures are
+        // resolved relative to the obj file
+        shared_ptr<const MeshDesc> result = LoadMeshDesc(filename);
+        if (cached != nullptr && cached->source_hash == result->source_hash)
+        {
+            result = cached;
+        }
+
+        entry->size  = size;
+        entry->mtime = mtime;
+        entry->asset = result;
+        return result;
+    }
+
+    shared_ptr<Texture3D> AssetCache::LoadTexture(const string& filename)
+    {
+        auto file  = weakly_canonical(path{filename});
+        auto entry = FindEntry(textures_, file.string());
+
+        lock_guard<mutex> lock{entry->mutex};
+
+        auto size  = file_size(file);
+        auto mtime = last_write_time(file);
+
+        auto cached = entry->asset.lock();
+        if (cached != nullptr && entry->size == size && entry->mtime == mtime)
+        {
+            return cached;
+        }
+
+        // NOTE textures are not shared by content across paths, as hashing would read the whole
+        // source image on every load
+        shared_ptr<Texture3D> result = make_shared<ImageTexture>(file.string());
+
+        entry->size  = size;
+        entry->mtime = mtime;
+        entry->asset = result;
+        return result;
+    }
+} // namespace akane
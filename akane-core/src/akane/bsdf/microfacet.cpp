@@ -0,0 +1,128 @@
+#include "akane/bsdf/microfacet.h"
+#include <array>
+
+using namespace std;
+
+namespace akane
+{
+    namespace
+    {
+        constexpr int kAlbedoTableSize   = 32; // entries along both cos_theta and alpha
+        constexpr int kAlbedoSampleCount = 32; // strata along each dimension of a sample
+
+        // directional albedo of GGX reflection with F = 1, tabulated at cos_theta = i / (N - 1)
+        // and alpha = j / (N - 1), together with its cosine-weighted average over cos_theta
+        class MicrofacetAlbedoTable
+        {
+        public:
+            MicrofacetAlbedoTable()
+            {
+                for (int j = 0; j < kAlbedoTableSize; ++j)
+                {
+                    auto alpha = max(static_cast<float>(j) / (kAlbedoTableSize - 1), 1e-3f);
+                    auto dist  = MicrofacetDistribution{sqrt(alpha)};
+
+                    for (int i = 0; i < kAlbedoTableSize; ++i)
+                    {
+                        auto cos_theta = max(static_cast<float>(i) / (kAlbedoTableSize - 1), 1e-3f);
+                        directional_[j][i] = Integrate(dist, cos_theta);
+                    }
+
+                    // E_avg = 2 * integral of E(mu) * mu, with trapezoidal rule
+                    float acc = 0.f;
+                    for (int i = 0; i + 1 < kAlbedoTableSize; ++i)
+                    {
+                        auto mu0 = static_cast<float>(i) / (kAlbedoTableSize - 1);
+                        auto mu1 = static_cast<float>(i + 1) / (kAlbedoTableSize - 1);
+                        acc += (directional_[j][i] * mu0 + directional_[j][i + 1] * mu1) *
+                               (mu1 - mu0) * .5f;
+                    }
+
+                    average_[j] = min(2.f * acc, 1.f);
+                }
+            }
+
+            float LookupDirectional(float cos_theta, float alpha) const noexcept
+            {
+                float ti, tj;
+                int i = LocateEntry(cos_theta, ti);
+                int j = LocateEntry(alpha, tj);
+
+                auto e0 = Lerp(directional_[j][i], directional_[j][i + 1], ti);
+                auto e1 = Lerp(directional_[j + 1][i], directional_[j + 1][i + 1], ti);
+                return Lerp(e0, e1, tj);
+            }
+
+            float LookupAverage(float alpha) const noexcept
+            {
+                float tj;
+                int j = LocateEntry(alpha, tj);
+
+                return Lerp(average_[j], average_[j + 1], tj);
+            }
+
+        private:
+            // estimate with stratified samples of the visible normal, where the sample weight
+            // f * cos / pdf reduces to G / G1(wo)
+            static float Integrate(const MicrofacetDistribution& dist, float cos_theta)
+            {
+                auto wo = Vec3{sqrt(max(0.f, 1.f - cos_theta * cos_theta)), 0.f, cos_theta};
+
+                double acc = 0.;
+                for (int y = 0; y < kAlbedoSampleCount; ++y)
+                {
+                    for (int x = 0; x < kAlbedoSampleCount; ++x)
+                    {
+                        auto u  = Point2f{(x + .5f) / kAlbedoSampleCount,
+                                         (y + .5f) / kAlbedoSampleCount};
+                        auto wh = dist.SampleWh(wo, u);
+                        auto wi = ReflectRay(wo, wh);
+                        if (wi.Z() <= 0)
+                        {
+                            continue;
+                        }
+
+                        acc += dist.G(wo, wi) / dist.G1(wo);
+                    }
+                }
+
+                return min(static_cast<float>(acc / (kAlbedoSampleCount * kAlbedoSampleCount)),
+                           1.f);
+            }
+
+            static int LocateEntry(float x, float& t_out) noexcept
+            {
+                auto p = clamp(x, 0.f, 1.f) * (kAlbedoTableSize - 1);
+                auto i = min(static_cast<int>(p), kAlbedoTableSize - 2);
+
+                t_out = p - i;
+                return i;
+            }
+
+            static float Lerp(float a, float b, float t) noexcept
+            {
+                return a + (b - a) * t;
+            }
+
+            array<array<float, kAlbedoTableSize>, kAlbedoTableSize> directional_;
+            array<float, kAlbedoTableSize> average_;
+        };
+
+        const MicrofacetAlbedoTable& GetAlbedoTable()
+        {
+            // built once on first use, initialization of local statics is thread-safe
+            static const MicrofacetAlbedoTable table;
+            return table;
+        }
+    } // namespace
+
+    float MicrofacetDirectionalAlbedo(float cos_theta, float alpha) noexcept
+    {
+        return GetAlbedoTable().LookupDirectional(cos_theta, alpha);
+    }
+
+    float MicrofacetAverageAlbedo(float alpha) noexcept
+    {
+        return GetAlbedoTable().LookupAverage(alpha);
+    }
+} // namespace akane
@@ -7,6 +7,9 @@ namespace akane
     class PerspectiveCamera : public Camera
     {
     public:
+        using Camera::SpawnRay;
+        using Camera::SpawnRayDifferential;
+
         PerspectiveCamera(Transform projection) : projection_(projection)
         {
         }
@@ -26,12 +29,102 @@ namespace akane
             // (0, 1) -> (-1, -1)  = (0, 0)
             // (1, 1) -> (-1, 1)   = (0, 1)
 
+            return Ray{projection_.P(), ComputeDirection(uv)};
+        }
+
+        Ray SpawnRayDifferential(Point2f uv, Vec2 duv) const noexcept override
+        {
+            auto result = SpawnRay(uv);
+
+            // all rays start from the pinhole, so only directions differ
+            result.has_differentials = true;
+            result.differential.dddx = ComputeDirection({uv[0] + duv[0], uv[1]}) - result.d;
+            result.differential.dddy = ComputeDirection({uv[0], uv[1] + duv[1]}) - result.d;
+
+            return result;
+        }
+
+        bool SampleWi(const Vec3& p, ImportanceSample& sample_out) const noexcept override
+        {
+            auto w       = p - projection_.P();
+            auto dist_sq = w.LengthSq();
+            if (dist_sq == 0)
+            {
+                return false;
+            }
+
+            auto d = w / sqrt(dist_sq);
+            if (!Project(d, sample_out.uv))
+            {
+                return false;
+            }
+
+            // a pinhole is a lens of unit area, so that importance integrates to one over the
+            // screen in projected solid angle
+            sample_out.point = projection_.P();
+            sample_out.we    = We(d);
+            sample_out.pdf   = dist_sq / Dot(d, projection_.Z());
+            return true;
+        }
+
+        float PdfWe(const Vec3& d) const noexcept override
+        {
+            Point2f uv;
+            if (!Project(d, uv))
+            {
+                return 0.f;
+            }
+
+            auto cos_theta = Dot(d, projection_.Z());
+            return 1.f / (ScreenArea() * cos_theta * cos_theta * cos_theta);
+        }
+
+        // raster projection of direction d leaving the pinhole, the inverse of ComputeDirection,
+        // returning false if d doesn't pass through the screen
+        bool Project(const Vec3& d, Point2f& uv_out) const noexcept
+        {
+            auto zz = Dot(d, projection_.Z());
+            if (zz <= 0)
+            {
+                return false;
+            }
+
+            // axes of the projection are orthogonal and scaled by the extent of the screen
+            auto xx = Dot(d, projection_.X()) / (projection_.X().LengthSq() * zz);
+            auto yy = Dot(d, projection_.Y()) / (projection_.Y().LengthSq() * zz);
+
+            uv_out = Point2f{(yy + 1.f) * .5f, (1.f - xx) * .5f};
+            return uv_out[0] >= 0 && uv_out[0] < 1 && uv_out[1] >= 0 && uv_out[1] < 1;
+        }
+
+        // importance emitted along direction d, which is zero off the screen
+        float We(const Vec3& d) const noexcept
+        {
+            Point2f uv;
+            if (!Project(d, uv))
+            {
+                return 0.f;
+            }
+
+            auto cos_theta = Dot(d, projection_.Z());
+            auto cos_sq    = cos_theta * cos_theta;
+            return 1.f / (ScreenArea() * cos_sq * cos_sq);
+        }
+
+    private:
+        // area of the screen on the plane at unit distance
+        float ScreenArea() const noexcept
+        {
+            return 4.f * projection_.X().Length() * projection_.Y().Length();
+        }
+
+        Vec3 ComputeDirection(Point2f uv) const noexcept
+        {
             auto xx = 1.f - 2 * uv[1];
             auto yy = 2 * uv[0] - 1.f;
-            return Ray{projection_.P(), projection_.InverseLinear({xx, yy, 1.f}).Normalized()};
+            return projection_.InverseLinear({xx, yy, 1.f}).Normalized();
         }
 
-    private:
         Transform projection_; // world-to-camera projection
     };
 } // namespace akane
\ No newline at end of file
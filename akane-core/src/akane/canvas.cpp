@@ -1,4 +1,5 @@
 #include "akane/canvas.h"
+#include "akane/common/atomic.h"
 #include "akane/common/image.h"
 
 namespace akane
@@ -48,4 +49,37 @@ namespace akane
 
         SavePngImage(filename.c_str(), image_data.data(), width_, height_);
     }
+
+    void SplatFilm::Splat(Point2f uv, Spectrum value) noexcept
+    {
+        auto x = min(static_cast<int>(uv[0] * width_), width_ - 1);
+        auto y = min(static_cast<int>(uv[1] * height_), height_ - 1);
+        if (x < 0 || y < 0)
+        {
+            return;
+        }
+
+        size_t offset = 3 * (static_cast<size_t>(y) * width_ + x);
+        for (int i = 0; i < 3; ++i)
+        {
+            AtomicAdd(buffer_[offset + i], value[i]);
+        }
+    }
+
+    void SplatFilm::Resolve(Canvas& canvas, float scalar) const
+    {
+        AKANE_REQUIRE(width_ == canvas.Width() && height_ == canvas.Height());
+        for (int y = 0; y < height_; ++y)
+        {
+            for (int x = 0; x < width_; ++x)
+            {
+                size_t offset = 3 * (static_cast<size_t>(y) * width_ + x);
+
+                auto value = Spectrum{buffer_[offset].load(std::memory_order_relaxed),
+                                      buffer_[offset + 1u].load(std::memory_order_relaxed),
+                                      buffer_[offset + 2u].load(std::memory_order_relaxed)};
+                canvas.IncrementPixel(x, y, value * scalar);
+            }
+        }
+    }
 } // namespace akane
\ No newline at end of file
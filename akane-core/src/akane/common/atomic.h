@@ -0,0 +1,14 @@
+#pragma once
+#include <atomic>
+
+namespace akane
+{
+    // std::atomic<float> has no fetch_add before C++20
+    inline void AtomicAdd(std::atomic<float>& target, float value) noexcept
+    {
+        auto current = target.load(std::memory_order_relaxed);
+        while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed))
+        {
+        }
+    }
+} // namespace akane
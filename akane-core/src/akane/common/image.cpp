@@ -12,7 +12,8 @@ namespace akane
     {
         int width, height, channel;
         auto stb_buffer = stbi_load(filename, &width, &height, &channel, 3);
-        if (stb_buffer == nullptr || channel != 3)
+        // NOTE channel is the count in file, data is always converted into 3 channels
+        if (stb_buffer == nullptr)
         {
             return nullptr;
         }
@@ -22,6 +23,39 @@ namespace akane
         return std::shared_ptr<uint8_t[]>(stb_buffer, [](uint8_t* ptr) { stbi_image_free(ptr); });
     }
 
+    bool IsImage16(const char* filename)
+    {
+        return stbi_is_16_bit(filename) != 0;
+    }
+
+    std::shared_ptr<uint16_t[]> LoadImage16(const char* filename, int& width_out, int& height_out)
+    {
+        int width, height, channel;
+        auto stb_buffer = stbi_load_16(filename, &width, &height, &channel, 3);
+        if (stb_buffer == nullptr)
+        {
+            return nullptr;
+        }
+
+        width_out  = width;
+        height_out = height;
+        return std::shared_ptr<uint16_t[]>(stb_buffer, [](uint16_t* ptr) { stbi_image_free(ptr); });
+    }
+
+    std::shared_ptr<float[]> LoadImageFloat(const char* filename, int& width_out, int& height_out)
+    {
+        int width, height, channel;
+        auto stb_buffer = stbi_loadf(filename, &width, &height, &channel, 3);
+        if (stb_buffer == nullptr)
+        {
+            return nullptr;
+        }
+
+        width_out  = width;
+        height_out = height;
+        return std::shared_ptr<float[]>(stb_buffer, [](float* ptr) { stbi_image_free(ptr); });
+    }
+
     void SavePngImage(const char* filename, const uint8_t* data, int width, int height)
     {
         stbi_write_png(filename, width, height, 3, data, 0);
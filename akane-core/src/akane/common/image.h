@@ -5,5 +5,12 @@ namespace akane
 {
     shared_ptr<uint8_t[]> LoadImage(const char* filename, int& width_out, int& height_out);
 
+    // for images with 16 bits per channel, data is always converted into 3 channels
+    bool IsImage16(const char* filename);
+    shared_ptr<uint16_t[]> LoadImage16(const char* filename, int& width_out, int& height_out);
+
+    // linear radiance in 3 channels, LDR images are converted with the default gamma of stb
+    shared_ptr<float[]> LoadImageFloat(const char* filename, int& width_out, int& height_out);
+
     void SavePngImage(const char* filename, const uint8_t* data, int width, int height);
 } // namespace akane
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "akane/common/mapped_file.h"
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace akane
+{
+#ifdef _WIN32
+    MappedFile::SharedPtr MappedFile::Open(const std::string& filename)
+    {
+        auto file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+
+        auto result          = shared_ptr<MappedFile>(new MappedFile());
+        result->file_handle_ = file;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            return nullptr;
+        }
+
+        result->size_ = static_cast<size_t>(size.QuadPart);
+        if (result->size_ == 0)
+        {
+            return result;
+        }
+
+        auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            return nullptr;
+        }
+
+        result->mapping_handle_ = mapping;
+        result->data_ =
+            static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (result->data_ == nullptr)
+        {
+            return nullptr;
+        }
+
+        return result;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data_ != nullptr)
+        {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_handle_ != nullptr)
+        {
+            CloseHandle(mapping_handle_);
+        }
+        if (file_handle_ != nullptr)
+        {
+            CloseHandle(file_handle_);
+        }
+    }
+#else
+    MappedFile::SharedPtr MappedFile::Open(const std::string& filename)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            return nullptr;
+        }
+
+        // the mapping stays valid after the descriptor is closed
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        auto result   = shared_ptr<MappedFile>(new MappedFile());
+        result->size_ = static_cast<size_t>(file_stat.st_size);
+        if (result->size_ > 0)
+        {
+            auto p = mmap(nullptr, result->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                close(fd);
+                return nullptr;
+            }
+
+            result->data_ = static_cast<const uint8_t*>(p);
+        }
+
+        close(fd);
+        return result;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data_ != nullptr)
+        {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+    }
+#endif
+
+    std::string MakeTemporaryFilename(const std::string& filename)
+    {
+#ifdef _WIN32
+        auto pid = static_cast<uint64_t>(GetCurrentProcessId());
+#else
+        auto pid = static_cast<uint64_t>(getpid());
+#endif
+        // a counter and the thread tell apart writers within the process, and the random part
+        // guards against pid reuse after a crashed writer
+        static std::atomic<uint64_t> counter = 0;
+
+        auto thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        auto salt   = std::random_device{}();
+        return fmt::format("{}.{}-{:x}-{}-{:x}.tmp", filename, pid, thread, counter++, salt);
+    }
+
+    bool CommitTemporaryFile(const std::string& temp_filename, const std::string& filename,
+                             bool written)
+    {
+        std::error_code ec;
+        if (written)
+        {
+            std::filesystem::rename(temp_filename, filename, ec);
+            if (!ec)
+            {
+                return true;
+            }
+        }
+
+        std::filesystem::remove(temp_filename, ec);
+        return false;
+    }
+} // namespace akane
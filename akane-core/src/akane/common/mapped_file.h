@@ -0,0 +1,48 @@
+#pragma once
+#include "akane/common/basic.h"
+#include <string>
+
+namespace akane
+{
+    // read-only view of a whole file mapped into memory
+    class MappedFile : public Object
+    {
+    public:
+        using SharedPtr = shared_ptr<const MappedFile>;
+
+        // returns nullptr if the file couldn't be opened or mapped
+        static SharedPtr Open(const std::string& filename);
+
+        ~MappedFile();
+
+        const uint8_t* Data() const noexcept
+        {
+            return data_;
+        }
+        size_t Size() const noexcept
+        {
+            return size_;
+        }
+
+    private:
+        MappedFile() = default;
+
+        const uint8_t* data_ = nullptr;
+        size_t size_         = 0;
+
+#ifdef _WIN32
+        void* file_handle_    = nullptr;
+        void* mapping_handle_ = nullptr;
+#endif
+    };
+
+    // name of a temporary file next to filename that is unique among processes and threads,
+    // where a file is written before it's renamed to its final name so that a concurrent reader
+    // never sees partial data
+    std::string MakeTemporaryFilename(const std::string& filename);
+
+    // rename the temporary file to filename if it's completely written, otherwise or if renaming
+    // fails the temporary file is removed. Returns if filename is replaced
+    bool CommitTemporaryFile(const std::string& temp_filename, const std::string& filename,
+                             bool written);
+} // namespace akane
@@ -0,0 +1,159 @@
+#pragma once
+#include "akane/common/basic.h"
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace akane
+{
+    inline size_t GetWorkerCount() noexcept
+    {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    namespace detail
+    {
+        // set while the thread runs chunks of a ParallelFor, and is counted as busy
+        inline bool& ParallelWorkerFlag() noexcept
+        {
+            thread_local bool flag = false;
+            return flag;
+        }
+
+        // threads running chunks of any ParallelFor, so that nested loops only spawn workers
+        // for cores left idle by the outer ones
+        inline std::atomic<size_t>& BusyWorkerCount() noexcept
+        {
+            static std::atomic<size_t> count = 0;
+            return count;
+        }
+
+        // reserve up to max_count workers from the idle ones, plus the calling thread if it is
+        // not yet counted as busy, returning the number of workers reserved besides the caller
+        inline size_t ReserveWorkers(size_t max_count, bool count_caller) noexcept
+        {
+            auto& busy      = BusyWorkerCount();
+            auto total      = GetWorkerCount();
+            auto busy_count = busy.load();
+            size_t reserved;
+            size_t caller_count = count_caller ? 1 : 0;
+            do
+            {
+                auto needed = busy_count + caller_count;
+                reserved    = std::min(max_count, total > needed ? total - needed : 0);
+            } while (!busy.compare_exchange_weak(busy_count, busy_count + caller_count + reserved));
+
+            return reserved;
+        }
+
+        class ParallelWorkerScope
+        {
+        public:
+            // counted worker releases its slot of busy workers when the scope ends
+            explicit ParallelWorkerScope(bool counted) noexcept
+                : saved_(ParallelWorkerFlag()), counted_(counted)
+            {
+                ParallelWorkerFlag() = true;
+            }
+            ~ParallelWorkerScope()
+            {
+                ParallelWorkerFlag() = saved_;
+                if (counted_)
+                {
+                    BusyWorkerCount()--;
+                }
+            }
+
+        private:
+            bool saved_;
+            bool counted_;
+        };
+    } // namespace detail
+
+    /**
+     * Invoke func(begin, end) over [0, count) in chunks of grain_size, distributed among worker
+     * threads with the calling thread taking part
+     *
+     * Blocks until every chunk is processed. Exception thrown by func is rethrown afterwards.
+     * Threads running chunks are counted globally, so a ParallelFor nested in another only
+     * spawns workers for idle cores, e.g. a big mesh parsed next to a few small ones still uses
+     * the whole machine. Chunks are the same however many workers run them.
+     */
+    template <typename F> void ParallelFor(size_t count, size_t grain_size, const F& func)
+    {
+        AKANE_ASSERT(grain_size > 0);
+
+        auto chunk_count = (count + grain_size - 1) / grain_size;
+        if (chunk_count == 0)
+        {
+            return;
+        }
+
+        // workers spawned besides the calling thread, which is counted as busy if it isn't yet
+        bool count_caller = !detail::ParallelWorkerFlag();
+        auto spawn_count  = detail::ReserveWorkers(
+            std::min(GetWorkerCount(), chunk_count) - 1, count_caller);
+
+        // chunks are fetched dynamically so that uneven workloads are balanced
+        std::atomic<size_t> next_chunk = 0;
+        auto worker                    = [&] {
+            for (auto i = next_chunk++; i < chunk_count; i = next_chunk++)
+            {
+                auto begin = i * grain_size;
+                func(begin, std::min(begin + grain_size, count));
+            }
+        };
+
+        // a spawned worker frees its slot as soon as chunks run out
+        auto spawned_worker = [&] {
+            detail::ParallelWorkerScope scope{true};
+            worker();
+        };
+
+        if (spawn_count == 0)
+        {
+            detail::ParallelWorkerScope scope{count_caller};
+            worker();
+            return;
+        }
+
+        std::vector<std::future<void>> futures;
+        for (size_t i = 0; i < spawn_count; ++i)
+        {
+            futures.push_back(std::async(std::launch::async, spawned_worker));
+        }
+
+        std::exception_ptr error = nullptr;
+        try
+        {
+            detail::ParallelWorkerScope scope{count_caller};
+            worker();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        for (auto& future : futures)
+        {
+            try
+            {
+                future.get();
+            }
+            catch (...)
+            {
+                if (error == nullptr)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        if (error != nullptr)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+} // namespace akane
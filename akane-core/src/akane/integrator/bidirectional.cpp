@@ -0,0 +1,597 @@
+#include "akane/integrator/bidirectional.h"
+#include "akane/bsdf/bsdf_geometry.h"
+#include "akane/bsdf.h"
+#include "akane/camera.h"
+#include "akane/canvas.h"
+#include "akane/math/sampling.h"
+#include <optional>
+
+namespace akane
+{
+    namespace
+    {
+        struct PathVertex
+        {
+            Vec3 point;
+            Vec3 n;        // geometric normal, zero at the camera and point lights
+            Vec3 wo;       // toward the previous vertex of the subpath
+            Spectrum beta; // throughput of the subpath up to the vertex
+
+            // densities in area of generating the vertex from the previous vertex of its subpath,
+            // and from the next one if the path were traced in reverse
+            float pdf_fwd = 0.f;
+            float pdf_rev = 0.f;
+
+            // specular surface, a light vertex is never delta as connecting to it is always
+            // possible, even if it's a point light
+            bool delta = false;
+
+            const Light* light      = nullptr; // emitter at the vertex, if any
+            const Primitive* object = nullptr;
+
+            // empty if the vertex doesn't scatter light
+            Bsdf bsdf;
+            Transform world2local = Transform::Identity();
+        };
+
+        // ray leaving the last vertex of a camera subpath without hitting anything
+        struct EscapedRay
+        {
+            bool escaped = false;
+            Ray ray;
+            Spectrum beta;
+            float pdf = 0.f; // of the direction in solid angle, zero if sampled specularly
+        };
+
+        // restores the assigned variable on scope exit
+        template <typename T> class ScopedAssignment
+        {
+        public:
+            ScopedAssignment(T& target, T value) : target_(target), backup_(target)
+            {
+                target_ = value;
+            }
+            ~ScopedAssignment()
+            {
+                target_ = backup_;
+            }
+
+            ScopedAssignment(const ScopedAssignment&) = delete;
+            ScopedAssignment& operator=(const ScopedAssignment&) = delete;
+
+        private:
+            T& target_;
+            T backup_;
+        };
+
+        // convert density in solid angle at `from` into area at `to`
+        float ConvertDensity(float pdf, const PathVertex& from, const PathVertex& to) noexcept
+        {
+            auto w       = to.point - from.point;
+            auto dist_sq = w.LengthSq();
+            if (dist_sq == 0)
+            {
+                return 0.f;
+            }
+
+            if (to.n != Vec3{0.f})
+            {
+                pdf *= abs(Dot(to.n, w)) / sqrt(dist_sq);
+            }
+
+            return pdf / dist_sq;
+        }
+
+        // bsdf at a surface vertex for light arriving from wi and leaving toward wo
+        Spectrum EvalBsdf(const PathVertex& v, const Vec3& wo, const Vec3& wi) noexcept
+        {
+            return v.bsdf.Eval(v.world2local.ApplyLinear(wo), v.world2local.ApplyLinear(wi));
+        }
+
+        float AbsShadingCos(const PathVertex& v, const Vec3& w) noexcept
+        {
+            return v.n != Vec3{0.f} ? AbsCosTheta(v.world2local.ApplyLinear(w)) : 1.f;
+        }
+
+        // density of a surface vertex v, reached from prev, scattering toward next
+        float PdfScattering(const PathVertex& v, const PathVertex& prev,
+                            const PathVertex& next) noexcept
+        {
+            auto wo  = v.world2local.ApplyLinear((prev.point - v.point).Normalized());
+            auto wi  = v.world2local.ApplyLinear((next.point - v.point).Normalized());
+            auto pdf = v.bsdf.Pdf(wo, wi);
+
+            return ConvertDensity(pdf, v, next);
+        }
+
+        // density of a light subpath leaving the emitter at v toward next
+        float PdfEmission(const PathVertex& v, const PathVertex& next)
+        {
+            float pdf_pos, pdf_dir;
+            v.light->PdfLe(v.point, v.n, (next.point - v.point).Normalized(), pdf_pos, pdf_dir);
+
+            return ConvertDensity(pdf_dir, v, next);
+        }
+
+        // density of a light subpath starting at the emitter vertex v
+        float PdfEmitterOrigin(const Scene& scene, const PathVertex& v, const Vec3& d)
+        {
+            float pdf_pos, pdf_dir;
+            v.light->PdfLe(v.point, v.n, d, pdf_pos, pdf_dir);
+
+            return scene.PdfLight(v.light) * pdf_pos;
+        }
+
+        // extend the subpath from its last vertex along the ray, whose direction is sampled with
+        // density pdf in solid angle. bsdfs of a light subpath are evaluated with wo and wi
+        // swapped, as light flows the other way. Returns the new vertex count
+        int RandomWalk(RenderingContext& ctx, Sampler& sampler, const Scene& scene, Ray ray,
+                       Spectrum beta, float pdf, bool from_light, PathVertex* path, int count,
+                       int max_count, EscapedRay* escaped = nullptr)
+        {
+            while (count < max_count)
+            {
+                IntersectionInfo isect;
+                if (!scene.Intersect(ray, ctx.workspace, isect))
+                {
+                    if (escaped != nullptr)
+                    {
+                        *escaped = EscapedRay{true, ray, beta, pdf};
+                    }
+
+                    break;
+                }
+
+                auto& prev   = path[count - 1];
+                auto& vertex = path[count++];
+
+                vertex        = PathVertex{};
+                vertex.point  = isect.point;
+                vertex.n      = isect.ng.Normalized();
+                vertex.wo     = -ray.d;
+                vertex.beta   = beta;
+                vertex.light  = isect.area_light;
+                vertex.object = isect.object;
+
+                vertex.pdf_fwd = ConvertDensity(pdf, prev, vertex);
+
+                // footprint for texture filtering, which only the camera ray has
+                ComputeDifferentials(ray, isect);
+
+                if (isect.material == nullptr || !isect.material->ComputeBsdf(isect, vertex.bsdf))
+                {
+                    break;
+                }
+
+                vertex.world2local = CreateBsdfCoordTransform(isect.ns, isect.dpdu);
+                vertex.delta       = vertex.bsdf.GetType().Contain(BsdfType::Specular);
+                if (count >= max_count)
+                {
+                    break;
+                }
+
+                auto local_wo = vertex.world2local.ApplyLinear(vertex.wo);
+
+                Vec3 local_wi;
+                float pdf_fwd;
+                auto f = vertex.bsdf.SampleAndEval(sampler.Get2D(), local_wo, local_wi, pdf_fwd);
+                if (pdf_fwd == 0)
+                {
+                    break;
+                }
+
+                if (from_light && !vertex.delta)
+                {
+                    f = vertex.bsdf.Eval(local_wi, local_wo);
+                }
+
+                beta *= f * AbsCosTheta(local_wi) / pdf_fwd;
+                if (beta.Max() <= 0)
+                {
+                    break;
+                }
+
+                // strategies never connect at specular vertices, whose densities are left zero
+                auto pdf_rev = vertex.bsdf.Pdf(local_wi, local_wo);
+                if (vertex.delta)
+                {
+                    pdf_fwd = 0.f;
+                    pdf_rev = 0.f;
+                }
+
+                pdf          = pdf_fwd;
+                prev.pdf_rev = ConvertDensity(pdf_rev, vertex, prev);
+
+                ray = Ray{vertex.point, vertex.world2local.InverseLinear(local_wi), ray.time};
+            }
+
+            return count;
+        }
+
+        // camera_pdf is density of the camera ray in solid angle, which is only used to weight
+        // strategies connecting light subpaths to the camera and could be zero
+        int GenerateCameraSubpath(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                                  const Ray& camera_ray, float camera_pdf, PathVertex* path,
+                                  int max_count, EscapedRay& escaped)
+        {
+            path[0]       = PathVertex{};
+            path[0].point = camera_ray.o;
+            path[0].beta  = kWhiteSpectrum;
+
+            auto count = RandomWalk(ctx, sampler, scene, camera_ray, kWhiteSpectrum, camera_pdf,
+                                    false, path, 1, max_count, &escaped);
+
+            // the global light seen directly is never sampled, so it isn't weighted
+            if (count == 1)
+            {
+                escaped.pdf = 0.f;
+            }
+
+            return count;
+        }
+
+        int GenerateLightSubpath(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                                 float time, PathVertex* path, int max_count)
+        {
+            float choice_pdf;
+            auto light = scene.SampleLight(sampler.Get1D(), choice_pdf);
+            if (light == nullptr || choice_pdf == 0)
+            {
+                return 0;
+            }
+
+            Ray ray;
+            Vec3 n;
+            float pdf_pos, pdf_dir;
+            auto le = light->SampleLe(sampler.Get2D(), sampler.Get2D(), ray, n, pdf_pos, pdf_dir);
+            if (pdf_pos == 0 || pdf_dir == 0 || le.Max() <= 0)
+            {
+                return 0;
+            }
+
+            ray.time = time;
+
+            path[0]         = PathVertex{};
+            path[0].point   = ray.o;
+            path[0].n       = n;
+            path[0].beta    = le / (choice_pdf * pdf_pos);
+            path[0].pdf_fwd = choice_pdf * pdf_pos;
+            path[0].light   = light;
+
+            auto cos_theta = n != Vec3{0.f} ? abs(Dot(n, ray.d)) : 1.f;
+            auto beta      = path[0].beta * cos_theta / pdf_dir;
+
+            return RandomWalk(ctx, sampler, scene, ray, beta, pdf_dir, true, path, 1, max_count);
+        }
+
+        // weight of the strategy with s light vertices and t camera vertices with power
+        // heuristic, where sampled replaces the first light vertex if s = 1. Strategies with t = 1
+        // are only counted if camera isn't nullptr
+        float ComputeMisWeight(const Scene& scene, const Camera* camera, PathVertex* light_path,
+                               PathVertex* camera_path, const PathVertex& sampled, int s, int t)
+        {
+            if (s + t == 2)
+            {
+                return 1.f;
+            }
+
+            auto remap = [](float pdf) { return pdf != 0 ? pdf : 1.f; };
+
+            // densities of vertices around the connection are those of the connected path
+            auto& pt      = camera_path[t - 1];
+            auto pt_minus = t > 1 ? &camera_path[t - 2] : nullptr;
+            auto qs       = s > 0 ? &light_path[s - 1] : nullptr;
+            auto qs_minus = s > 1 ? &light_path[s - 2] : nullptr;
+
+            std::optional<ScopedAssignment<PathVertex>> a0;
+            if (s == 1)
+            {
+                a0.emplace(*qs, sampled);
+            }
+
+            ScopedAssignment<bool> a1{pt.delta, false};
+
+            float pt_pdf_rev;
+            if (s == 0)
+            {
+                pt_pdf_rev = PdfEmitterOrigin(scene, pt, (pt_minus->point - pt.point).Normalized());
+            }
+            else
+            {
+                pt_pdf_rev = s == 1 ? PdfEmission(*qs, pt) : PdfScattering(*qs, *qs_minus, pt);
+            }
+
+            ScopedAssignment<float> a2{pt.pdf_rev, pt_pdf_rev};
+
+            std::optional<ScopedAssignment<float>> a3;
+            if (pt_minus != nullptr)
+            {
+                a3.emplace(pt_minus->pdf_rev, s > 0 ? PdfScattering(pt, *qs, *pt_minus)
+                                                    : PdfEmission(pt, *pt_minus));
+            }
+
+            std::optional<ScopedAssignment<bool>> a4;
+            std::optional<ScopedAssignment<float>> a5;
+            std::optional<ScopedAssignment<float>> a6;
+            if (qs != nullptr)
+            {
+                // the camera vertex generates qs by spawning a ray toward it
+                auto qs_pdf_rev =
+                    pt_minus != nullptr
+                        ? PdfScattering(pt, *pt_minus, *qs)
+                        : ConvertDensity(camera->PdfWe((qs->point - pt.point).Normalized()), pt,
+                                         *qs);
+
+                a4.emplace(qs->delta, false);
+                a5.emplace(qs->pdf_rev, qs_pdf_rev);
+            }
+            if (qs_minus != nullptr)
+            {
+                a6.emplace(qs_minus->pdf_rev, PdfScattering(*qs, pt, *qs_minus));
+            }
+
+            // ratios of densities of other strategies over this one, where strategies that
+            // connect at a specular vertex are impossible
+            float sum_ratio = 0.f;
+
+            float ratio = 1.f;
+            for (int i = t - 1; i > (camera != nullptr ? 0 : 1); --i)
+            {
+                ratio *= remap(camera_path[i].pdf_rev) / remap(camera_path[i].pdf_fwd);
+                if (!camera_path[i].delta && !camera_path[i - 1].delta)
+                {
+                    sum_ratio += ratio * ratio;
+                }
+            }
+
+            ratio = 1.f;
+            for (int i = s - 1; i >= 0; --i)
+            {
+                ratio *= remap(light_path[i].pdf_rev) / remap(light_path[i].pdf_fwd);
+
+                auto delta_prev =
+                    i > 0 ? light_path[i - 1].delta : light_path[0].light->IsDeltaPosition();
+                if (!light_path[i].delta && !delta_prev)
+                {
+                    sum_ratio += ratio * ratio;
+                }
+            }
+
+            return 1.f / (1.f + sum_ratio);
+        }
+
+        // contribution of the path joining the first s light vertices and the first t camera
+        // vertices. Paths with t = 1 land on another pixel, which are splatted onto the film of
+        // ctx rather than returned
+        Spectrum ConnectSubpaths(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                                 PathVertex* light_path, PathVertex* camera_path, int s, int t,
+                                 float time, bool connect_camera)
+        {
+            auto& pt    = camera_path[t - 1];
+            auto camera = connect_camera ? ctx.camera : nullptr;
+
+            Spectrum result = kBlackSpectrum;
+            PathVertex sampled;
+            if (t == 1)
+            {
+                // the lens of a pinhole is where every camera ray starts, so the camera vertex
+                // serves as the sampled point on the lens
+                auto& qs = light_path[s - 1];
+                if (qs.delta)
+                {
+                    return kBlackSpectrum;
+                }
+
+                ImportanceSample sample;
+                if (!camera->SampleWi(qs.point, sample) || sample.pdf == 0)
+                {
+                    return kBlackSpectrum;
+                }
+
+                auto w = (pt.point - qs.point).Normalized();
+
+                result = qs.beta * EvalBsdf(qs, w, qs.wo) * AbsShadingCos(qs, w) * sample.we /
+                         sample.pdf;
+                if (result.Max() <= 0 ||
+                    !TestSegmentVisibility(ctx, scene, pt.point, qs.point, time))
+                {
+                    return kBlackSpectrum;
+                }
+
+                auto weight =
+                    ComputeMisWeight(scene, camera, light_path, camera_path, sampled, s, t);
+                ctx.splat_film->Splat(sample.uv, result * weight);
+
+                return kBlackSpectrum;
+            }
+            else if (s == 0)
+            {
+                // the camera subpath hits an emitter by itself
+                if (pt.light == nullptr)
+                {
+                    return kBlackSpectrum;
+                }
+
+                result = pt.beta * pt.light->Le(pt.point, pt.n, pt.wo);
+            }
+            else if (s == 1)
+            {
+                // a point on a light is sampled for the camera vertex, instead of using the
+                // first vertex of the light subpath
+                if (pt.delta)
+                {
+                    return kBlackSpectrum;
+                }
+
+                float choice_pdf;
+                auto light = scene.SampleLight(sampler.Get1D(), choice_pdf);
+                if (light == nullptr || choice_pdf == 0)
+                {
+                    return kBlackSpectrum;
+                }
+
+                auto sample = light->SampleLi(sampler.Get2D());
+                if (sample.IsGlobal() || sample.Pdf() == 0)
+                {
+                    return kBlackSpectrum;
+                }
+
+                sampled       = PathVertex{};
+                sampled.point = sample.Point();
+                sampled.n     = sample.Normal();
+                sampled.light = light;
+
+                auto w       = pt.point - sampled.point;
+                auto dist_sq = w.LengthSq();
+                if (dist_sq == 0)
+                {
+                    return kBlackSpectrum;
+                }
+
+                w = w / sqrt(dist_sq);
+
+                auto le         = light->Le(sampled.point, sampled.n, w);
+                sampled.beta    = le / (choice_pdf * sample.Pdf());
+                sampled.pdf_fwd = PdfEmitterOrigin(scene, sampled, w);
+
+                auto cos_light = sampled.n != Vec3{0.f} ? abs(Dot(sampled.n, w)) : 1.f;
+                auto g         = AbsShadingCos(pt, w) * cos_light / dist_sq;
+
+                result = pt.beta * EvalBsdf(pt, pt.wo, -w) * g * sampled.beta;
+                if (result.Max() > 0 &&
+                    !sample.TestVisibility(scene, ctx.workspace, pt.point, pt.object, time))
+                {
+                    return kBlackSpectrum;
+                }
+            }
+            else
+            {
+                auto& qs = light_path[s - 1];
+                if (qs.delta || pt.delta)
+                {
+                    return kBlackSpectrum;
+                }
+
+                auto w       = pt.point - qs.point;
+                auto dist_sq = w.LengthSq();
+                if (dist_sq == 0)
+                {
+                    return kBlackSpectrum;
+                }
+
+                w = w / sqrt(dist_sq);
+
+                auto g = AbsShadingCos(qs, w) * AbsShadingCos(pt, w) / dist_sq;
+                result = qs.beta * EvalBsdf(qs, w, qs.wo) * g * EvalBsdf(pt, pt.wo, -w) * pt.beta;
+                if (result.Max() > 0 &&
+                    !TestSegmentVisibility(ctx, scene, pt.point, qs.point, time))
+                {
+                    return kBlackSpectrum;
+                }
+            }
+
+            if (result.Max() <= 0)
+            {
+                return kBlackSpectrum;
+            }
+
+            return result * ComputeMisWeight(scene, camera, light_path, camera_path, sampled, s, t);
+        }
+
+        // global light sampled at a camera vertex, weighted against escaping rays
+        Spectrum SampleGlobalLight(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                                   const PathVertex& v, float time)
+        {
+            auto global_light = scene.GetGlobalLight();
+
+            auto sample = global_light->SampleLi(sampler.Get2D());
+            if (sample.Pdf() <= 0 ||
+                !sample.TestVisibility(scene, ctx.workspace, v.point, v.object, time))
+            {
+                return kBlackSpectrum;
+            }
+
+            auto shadow_ray = sample.GenerateShadowRay(v.point, time);
+            auto wi         = shadow_ray.d;
+
+            auto f = EvalBsdf(v, v.wo, wi) * AbsShadingCos(v, wi);
+            auto bsdf_pdf =
+                v.bsdf.Pdf(v.world2local.ApplyLinear(v.wo), v.world2local.ApplyLinear(wi));
+            auto weight = PowerHeuristic(sample.Pdf(), bsdf_pdf);
+
+            return v.beta * f * global_light->Eval(shadow_ray) / sample.Pdf() * weight;
+        }
+    } // namespace
+
+    Spectrum BidirectionalPathTracingIntegrator::Li(RenderingContext& ctx, Sampler& sampler,
+                                                    const Scene& scene,
+                                                    const Ray& camera_ray) const
+    {
+        // temporary primitives referenced by vertices must live through the whole sample
+        ctx.workspace.Clear();
+
+        PathVertex camera_path[kMaxBounce + 2];
+        PathVertex light_path[kMaxBounce + 1];
+
+        // light subpaths are connected to the camera only if there's a film to splat onto and the
+        // camera supports it
+        auto camera_pdf = 0.f;
+        if (ctx.camera != nullptr && ctx.splat_film != nullptr)
+        {
+            camera_pdf = ctx.camera->PdfWe(camera_ray.d);
+        }
+
+        auto connect_camera = camera_pdf > 0;
+
+        EscapedRay escaped;
+        auto camera_count = GenerateCameraSubpath(ctx, sampler, scene, camera_ray, camera_pdf,
+                                                  camera_path, max_bounce_ + 2, escaped);
+        auto light_count =
+            GenerateLightSubpath(ctx, sampler, scene, camera_ray.time, light_path, max_bounce_ + 1);
+
+        // s = 1 samples a light vertex of its own, so it's evaluated even if the light subpath
+        // failed, as MIS weights of other strategies count it
+        auto max_light_count = max(light_count, 1);
+
+        Spectrum result = kBlackSpectrum;
+        for (int t = connect_camera ? 1 : 2; t <= camera_count; ++t)
+        {
+            // a light vertex seen directly by the camera is left to the camera subpath
+            for (int s = t == 1 ? 2 : 0; s <= max_light_count; ++s)
+            {
+                if (s + t - 2 > max_bounce_)
+                {
+                    break;
+                }
+
+                result += ConnectSubpaths(ctx, sampler, scene, light_path, camera_path, s, t,
+                                          camera_ray.time, connect_camera);
+            }
+        }
+
+        // global light, which light subpaths never start from
+        if (auto global_light = scene.GetGlobalLight(); global_light != nullptr)
+        {
+            for (int i = 1; i < camera_count; ++i)
+            {
+                if (!camera_path[i].delta && !camera_path[i].bsdf.Empty())
+                {
+                    result += SampleGlobalLight(ctx, sampler, scene, camera_path[i],
+                                                camera_ray.time);
+                }
+            }
+
+            if (escaped.escaped)
+            {
+                auto weight = escaped.pdf == 0 ? 1.f
+                                               : PowerHeuristic(escaped.pdf,
+                                                                global_light->PdfLi(escaped.ray.d));
+
+                result += escaped.beta * global_light->Eval(escaped.ray) * weight;
+            }
+        }
+
+        AKANE_CHECK(!InvalidSpectrum(result));
+        return result;
+    }
+} // namespace akane
@@ -0,0 +1,40 @@
+#pragma once
+#include "akane/integrator.h"
+#include "akane/light.h"
+#include "akane/material.h"
+
+namespace akane
+{
+    /**
+     * Bidirectional path tracer, which connects every prefix of a camera subpath with every prefix
+     * of a light subpath and combines the strategies with multiple importance sampling
+     *
+     * Light subpaths are traced from lights placed in the scene. The global light is sampled at
+     * camera vertices and weighted against escaping rays as PathTracingIntegrator does. Light
+     * subpaths are connected to the camera itself only if the rendering context has a camera and
+     * a film to splat onto, and participating media are ignored.
+     */
+    class BidirectionalPathTracingIntegrator : public Integrator
+    {
+    public:
+        // bounces of a whole path, where vertices of both subpaths are stored on the stack
+        static constexpr int kMaxBounce = 14;
+
+        explicit BidirectionalPathTracingIntegrator(int max_bounce = 6) : max_bounce_(max_bounce)
+        {
+            AKANE_REQUIRE(max_bounce > 0 && max_bounce <= kMaxBounce);
+        }
+
+        Spectrum Li(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                    const Ray& camera_ray) const override;
+
+        // light subpaths connected to the camera land on other pixels
+        bool UseSplatFilm() const override
+        {
+            return true;
+        }
+
+    private:
+        int max_bounce_;
+    };
+} // namespace akane
@@ -0,0 +1,174 @@
+#include "akane/integrator/light_tracing.h"
+#include "akane/bsdf/bsdf_geometry.h"
+#include "akane/bsdf.h"
+#include "akane/common/parallel.h"
+
+namespace akane
+{
+    namespace
+    {
+        constexpr size_t kPathGrainSize = 4096;
+
+        // splat radiance leaving p toward the camera, where eval computes it for the direction
+        // from p to the lens
+        template <typename F>
+        void ConnectToCamera(RenderingContext& ctx, const Scene& scene, const Camera& camera,
+                             SplatFilm& film, const Vec3& p, float time, F eval)
+        {
+            ImportanceSample sample;
+            if (!camera.SampleWi(p, sample) || sample.pdf == 0)
+            {
+                return;
+            }
+
+            Spectrum radiance = eval((sample.point - p).Normalized());
+            if (radiance.Max() <= 0 || !TestSegmentVisibility(ctx, scene, sample.point, p, time))
+            {
+                return;
+            }
+
+            film.Splat(sample.uv, radiance * sample.we / sample.pdf);
+        }
+
+        void TraceLightPath(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                            const Camera& camera, SplatFilm& film, int max_bounce, float time)
+        {
+            ctx.workspace.Clear();
+
+            float choice_pdf;
+            auto light = scene.SampleLight(sampler.Get1D(), choice_pdf);
+            if (light == nullptr || choice_pdf == 0)
+            {
+                return;
+            }
+
+            Ray ray;
+            Vec3 n;
+            float pdf_pos, pdf_dir;
+            auto le = light->SampleLe(sampler.Get2D(), sampler.Get2D(), ray, n, pdf_pos, pdf_dir);
+            if (pdf_pos == 0 || pdf_dir == 0 || le.Max() <= 0)
+            {
+                return;
+            }
+
+            ray.time = time;
+
+            // emitter seen directly, which never happens for a point light
+            if (n != Vec3{0.f})
+            {
+                ConnectToCamera(ctx, scene, camera, film, ray.o, time, [&](const Vec3& d) {
+                    return light->Le(ray.o, n, d) * abs(Dot(n, d)) / (choice_pdf * pdf_pos);
+                });
+            }
+
+            auto cos_theta = n != Vec3{0.f} ? abs(Dot(n, ray.d)) : 1.f;
+            auto beta      = le * cos_theta / (choice_pdf * pdf_pos * pdf_dir);
+            for (int bounce = 0; bounce < max_bounce; ++bounce)
+            {
+                ctx.workspace.Clear();
+
+                IntersectionInfo isect;
+                if (!scene.Intersect(ray, ctx.workspace, isect) || isect.material == nullptr)
+                {
+                    break;
+                }
+
+                Bsdf bsdf;
+                if (!isect.material->ComputeBsdf(isect, bsdf))
+                {
+                    break;
+                }
+
+                auto world2local = CreateBsdfCoordTransform(isect.ns, isect.dpdu);
+                auto wo          = world2local.ApplyLinear(-ray.d);
+                auto specular    = bsdf.GetType().Contain(BsdfType::Specular);
+
+                // light flows from wo toward the camera here
+                if (!specular)
+                {
+                    auto eval = [&](const Vec3& d) {
+                        auto wi = world2local.ApplyLinear(d);
+                        return beta * bsdf.Eval(wi, wo) * AbsCosTheta(wi);
+                    };
+
+                    ConnectToCamera(ctx, scene, camera, film, isect.point, time, eval);
+                }
+
+                Vec3 wi;
+                float pdf;
+                auto f = bsdf.SampleAndEval(sampler.Get2D(), wo, wi, pdf);
+                if (pdf == 0)
+                {
+                    break;
+                }
+
+                // light flows from wo to wi here
+                if (!specular)
+                {
+                    f = bsdf.Eval(wi, wo);
+                }
+
+                // russian roulette keeping the throughput of surviving paths close to the emitted
+                auto next_beta = beta * f * AbsCosTheta(wi) / pdf;
+                auto q         = max(0.f, 1.f - next_beta.Max() / beta.Max());
+                if (sampler.Get1D() < q)
+                {
+                    break;
+                }
+
+                beta = next_beta / (1.f - q);
+                ray  = Ray{isect.point, world2local.InverseLinear(wi), ray.time};
+            }
+        }
+    } // namespace
+
+    RenderResult LightTracingIntegrator::Execute(
+        const Scene& scene, const Camera& camera, Point2i resolution, int sample_per_pixel,
+        unsigned seed, std::function<bool()>* activity_query,
+        std::function<void(int, const RenderResult&)>* checkpoint_handler) const
+    {
+        auto path_count = static_cast<size_t>(resolution[0]) * resolution[1];
+
+        SplatFilm film{resolution[0], resolution[1]};
+
+        RenderResult result{};
+        result.canvas = make_shared<Canvas>(resolution[0], resolution[1]);
+
+        // importance integrates to one over the screen, so an iteration tracing as many paths as
+        // there are pixels adds the radiance a pixel sees in expectation
+        auto resolve_canvas = [&] {
+            result.canvas->Clear();
+            film.Resolve(*result.canvas);
+        };
+
+        for (int iteration = 0; iteration < sample_per_pixel; ++iteration)
+        {
+            if (activity_query != nullptr && !(*activity_query)())
+            {
+                break;
+            }
+
+            // a sampler per chunk of kPathGrainSize paths, so that the image is the same on any
+            // number of cores
+            ParallelFor(path_count, kPathGrainSize, [&](size_t begin, size_t end) {
+                RenderingContext ctx;
+                Sampler sampler{MixSeed(seed, iteration, begin)};
+                for (auto i = begin; i < end; ++i)
+                {
+                    TraceLightPath(ctx, sampler, scene, camera, film, max_bounce_,
+                                   camera.ShutterTime(sampler.Get1D()));
+                }
+            });
+
+            result.ssp = iteration + 1;
+            if (checkpoint_handler != nullptr)
+            {
+                resolve_canvas();
+                (*checkpoint_handler)(result.ssp * 100 / sample_per_pixel, result);
+            }
+        }
+
+        resolve_canvas();
+        return result;
+    }
+} // namespace akane
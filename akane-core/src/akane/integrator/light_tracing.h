@@ -0,0 +1,34 @@
+#pragma once
+#include "akane/render.h"
+
+namespace akane
+{
+    /**
+     * Light tracing, which follows paths from lights placed in the scene and connects every
+     * non-specular vertex to the camera, splatting the contribution where it lands on the screen
+     *
+     * Caustics from point and spot lights, which path tracing can hardly sample, converge quickly
+     * this way, while surfaces seen through specular bounces stay black. Only cameras with a
+     * pinhole can be connected to, the global light is never traced from and participating media
+     * are ignored.
+     */
+    class LightTracingIntegrator
+    {
+    public:
+        explicit LightTracingIntegrator(int max_bounce = 6) : max_bounce_(max_bounce)
+        {
+            AKANE_REQUIRE(max_bounce > 0);
+        }
+
+        // render with paths spread over every worker thread, where a sample per pixel traces as
+        // many light paths as there are pixels
+        RenderResult Execute(const Scene& scene, const Camera& camera, Point2i resolution,
+                             int sample_per_pixel, unsigned seed,
+                             std::function<bool()>* activity_query = nullptr,
+                             std::function<void(int, const RenderResult&)>* checkpoint_handler =
+                                 nullptr) const;
+
+    private:
+        int max_bounce_;
+    };
+} // namespace akane
@@ -0,0 +1,401 @@
+#include "akane/integrator/path_guiding.h"
+#include "akane/common/atomic.h"
+#include "akane/common/parallel.h"
+
+namespace akane
+{
+    namespace
+    {
+        // records a spatial leaf takes before splitting in the first pass, which grows by sqrt(2)
+        // per pass as samples per pixel double
+        constexpr float kSpatialSplitThreshold = 12000.f;
+        constexpr int kMaxSpatialDepth         = 48;
+
+        // fraction of energy a directional quadrant holds before subdivided
+        constexpr float kDirectionalSplitThreshold = .01f;
+        constexpr int kMaxDirectionalDepth         = 20;
+
+        constexpr float kOneMinusEpsilon = 0x1.fffffep-1f;
+
+        // cylindrical equal-area mapping, where x is cos(theta) and y is phi
+        Point2f DirectionToSquare(const Vec3& d) noexcept
+        {
+            auto cos_theta = clamp(d.Z(), -1.f, 1.f);
+            auto phi       = std::atan2(d.Y(), d.X());
+            if (phi < 0)
+            {
+                phi += kTwoPi;
+            }
+
+            return Point2f{clamp((cos_theta + 1.f) * .5f, 0.f, kOneMinusEpsilon),
+                           clamp(phi * kInvTwoPi, 0.f, kOneMinusEpsilon)};
+        }
+
+        Vec3 SquareToDirection(Point2f p) noexcept
+        {
+            auto cos_theta = 2.f * p[0] - 1.f;
+            auto sin_theta = sqrt(max(0.f, 1.f - cos_theta * cos_theta));
+            auto phi       = kTwoPi * p[1];
+
+            return Vec3{sin_theta * cos(phi), sin_theta * sin(phi), cos_theta};
+        }
+
+        // quadrant containing p, which is then mapped into the unit square of the quadrant
+        int SelectQuadrant(Point2f& p) noexcept
+        {
+            auto x = p[0] >= .5f ? 1 : 0;
+            auto y = p[1] >= .5f ? 1 : 0;
+
+            p = Point2f{p[0] * 2.f - x, p[1] * 2.f - y};
+            return y * 2 + x;
+        }
+    } // namespace
+
+    void DirectionalQuadtree::Record(Point2f p, float value) noexcept
+    {
+        uint32_t index = 0;
+        while (true)
+        {
+            auto& node = nodes_[index];
+            auto c     = SelectQuadrant(p);
+
+            AtomicAdd(node.sum[c], value);
+            if (node.child[c] == 0)
+            {
+                return;
+            }
+
+            index = node.child[c];
+        }
+    }
+
+    Point2f DirectionalQuadtree::Sample(Point2f u, float& pdf_out) const noexcept
+    {
+        pdf_out = 1.f;
+
+        Point2f origin = {0.f, 0.f};
+        float size     = 1.f;
+
+        uint32_t index = 0;
+        while (true)
+        {
+            const auto& node = nodes_[index];
+
+            float sum[4], total = 0.f;
+            for (int i = 0; i < 4; ++i)
+            {
+                sum[i] = node.sum[i].load(std::memory_order_relaxed);
+                total += sum[i];
+            }
+
+            if (!(total > 0))
+            {
+                break;
+            }
+
+            // choose the column, then the quadrant in the column, reusing u for the rest
+            auto left = (sum[0] + sum[2]) / total;
+
+            int x, y;
+            if (u[0] < left)
+            {
+                x    = 0;
+                u[0] = u[0] / left;
+            }
+            else
+            {
+                x    = 1;
+                u[0] = (u[0] - left) / (1.f - left);
+            }
+
+            auto column = sum[x] + sum[x + 2];
+            auto lower  = sum[x] / column;
+            if (u[1] < lower)
+            {
+                y    = 0;
+                u[1] = u[1] / lower;
+            }
+            else
+            {
+                y    = 1;
+                u[1] = (u[1] - lower) / (1.f - lower);
+            }
+
+            u = Point2f{min(u[0], kOneMinusEpsilon), min(u[1], kOneMinusEpsilon)};
+
+            auto c = y * 2 + x;
+            pdf_out *= 4.f * sum[c] / total;
+
+            size *= .5f;
+            origin = Point2f{origin[0] + size * x, origin[1] + size * y};
+            if (node.child[c] == 0)
+            {
+                break;
+            }
+
+            index = node.child[c];
+        }
+
+        return Point2f{origin[0] + size * u[0], origin[1] + size * u[1]};
+    }
+
+    float DirectionalQuadtree::Pdf(Point2f p) const noexcept
+    {
+        float pdf = 1.f;
+
+        uint32_t index = 0;
+        while (true)
+        {
+            const auto& node = nodes_[index];
+
+            float total = 0.f;
+            for (const auto& sum : node.sum)
+            {
+                total += sum.load(std::memory_order_relaxed);
+            }
+
+            if (!(total > 0))
+            {
+                return pdf;
+            }
+
+            auto c = SelectQuadrant(p);
+            pdf *= 4.f * node.sum[c].load(std::memory_order_relaxed) / total;
+            if (node.child[c] == 0)
+            {
+                return pdf;
+            }
+
+            index = node.child[c];
+        }
+    }
+
+    DirectionalQuadtree DirectionalQuadtree::Refined(float threshold, int max_depth) const
+    {
+        // quadrants subdivided beyond the old tree split their energy evenly
+        struct Item
+        {
+            int64_t old_index; // -1 if the node isn't in the old tree
+            float energy;
+            uint32_t new_index;
+            int depth;
+        };
+
+        DirectionalQuadtree result;
+
+        auto total = Total();
+
+        std::vector<Item> stack = {Item{0, total, 0, 1}};
+        while (!stack.empty())
+        {
+            auto item = stack.back();
+            stack.pop_back();
+
+            for (int c = 0; c < 4; ++c)
+            {
+                float energy      = item.energy * .25f;
+                int64_t old_child = -1;
+                if (item.old_index >= 0)
+                {
+                    const auto& old = nodes_[item.old_index];
+
+                    energy = old.sum[c].load(std::memory_order_relaxed);
+                    if (old.child[c] != 0)
+                    {
+                        old_child = old.child[c];
+                    }
+                }
+
+                result.nodes_[item.new_index].sum[c].store(energy, std::memory_order_relaxed);
+                if (total > 0 && energy > threshold * total && item.depth < max_depth)
+                {
+                    auto child = static_cast<uint32_t>(result.nodes_.size());
+                    result.nodes_.emplace_back();
+                    result.nodes_[item.new_index].child[c] = child;
+
+                    stack.push_back(Item{old_child, energy, child, item.depth + 1});
+                }
+            }
+        }
+
+        return result;
+    }
+
+    void DirectionalQuadtree::ClearEnergy() noexcept
+    {
+        for (auto& node : nodes_)
+        {
+            for (auto& sum : node.sum)
+            {
+                sum.store(0.f, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    PathGuide::PathGuide(const Bounds3& bound) : nodes_(1), leaves_(1)
+    {
+        AKANE_REQUIRE(!bound.Empty());
+
+        // a cube, so that cells stay cubic when split along axes in turn
+        auto diagonal = bound.Diagonal();
+        auto extent   = max(diagonal[0], max(diagonal[1], diagonal[2]));
+        bound_        = Bounds3{bound.lower, bound.lower + Vec3{extent}};
+    }
+
+    Vec3 PathGuide::Sample(const Vec3& p, const Point2f& u, float& pdf_out) const noexcept
+    {
+        auto d = SquareToDirection(FindLeaf(p).sampling.Sample(u, pdf_out));
+
+        pdf_out /= kAreaUnitSphere;
+        return d;
+    }
+
+    float PathGuide::Pdf(const Vec3& p, const Vec3& d) const noexcept
+    {
+        return FindLeaf(p).sampling.Pdf(DirectionToSquare(d)) / kAreaUnitSphere;
+    }
+
+    void PathGuide::Record(const Vec3& p, const Vec3& d, float radiance, float pdf) noexcept
+    {
+        auto value = radiance / pdf;
+        if (!(pdf > 0) || !(value > 0) || std::isinf(value))
+        {
+            return;
+        }
+
+        auto& leaf = FindLeaf(p);
+        leaf.building.Record(DirectionToSquare(d), value);
+        leaf.record_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void PathGuide::Refine()
+    {
+        auto threshold =
+            static_cast<uint32_t>(kSpatialSplitThreshold * sqrt(pow(2.f, pass_count_)));
+        ++pass_count_;
+
+        // leaves are collected before splitting, as splitting appends nodes
+        std::vector<std::pair<uint32_t, int>> leaf_nodes;
+        std::vector<std::pair<uint32_t, int>> stack = {{0, 0}};
+        while (!stack.empty())
+        {
+            auto [index, depth] = stack.back();
+            stack.pop_back();
+
+            const auto& node = nodes_[index];
+            if (node.child[0] == 0)
+            {
+                leaf_nodes.emplace_back(index, depth);
+            }
+            else
+            {
+                stack.emplace_back(node.child[0], depth + 1);
+                stack.emplace_back(node.child[1], depth + 1);
+            }
+        }
+
+        for (auto [index, depth] : leaf_nodes)
+        {
+            SplitLeaf(index, threshold, depth);
+        }
+
+        // radiance recorded in this pass is sampled in the next one
+        for (auto& leaf : leaves_)
+        {
+            leaf.sampling = leaf.building.Refined(kDirectionalSplitThreshold, kMaxDirectionalDepth);
+            leaf.building = leaf.sampling;
+            leaf.building.ClearEnergy();
+            leaf.record_count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    const PathGuide::Leaf& PathGuide::FindLeaf(const Vec3& p) const noexcept
+    {
+        auto lower = bound_.lower;
+        auto size  = bound_.Diagonal();
+
+        uint32_t index = 0;
+        while (nodes_[index].child[0] != 0)
+        {
+            const auto& node = nodes_[index];
+
+            auto a = node.axis;
+            size[a] *= .5f;
+            if (p[a] < lower[a] + size[a])
+            {
+                index = node.child[0];
+            }
+            else
+            {
+                lower[a] += size[a];
+                index = node.child[1];
+            }
+        }
+
+        return leaves_[nodes_[index].leaf];
+    }
+
+    void PathGuide::SplitLeaf(uint32_t node, uint32_t threshold, int depth)
+    {
+        auto leaf_index = nodes_[node].leaf;
+
+        auto count = leaves_[leaf_index].record_count.load(std::memory_order_relaxed);
+        if (count <= threshold || depth >= kMaxSpatialDepth)
+        {
+            return;
+        }
+
+        // both halves start from the quadtrees of the leaf, each taking half of the records
+        leaves_[leaf_index].record_count.store(count / 2, std::memory_order_relaxed);
+        leaves_.push_back(leaves_[leaf_index]);
+
+        auto first  = static_cast<uint32_t>(nodes_.size());
+        auto second = first + 1;
+
+        SpatialNode child;
+        child.leaf = leaf_index;
+        nodes_.push_back(child);
+        child.leaf = static_cast<uint32_t>(leaves_.size() - 1);
+        nodes_.push_back(child);
+
+        nodes_[node].axis     = depth % 3;
+        nodes_[node].child[0] = first;
+        nodes_[node].child[1] = second;
+
+        SplitLeaf(first, threshold, depth + 1);
+        SplitLeaf(second, threshold, depth + 1);
+    }
+
+    void TrainPathGuide(const Integrator& integrator, PathGuide& guide, const Scene& scene,
+                        const Camera& camera, Point2i resolution, int pass_count, unsigned seed)
+    {
+        auto duv = Vec2{1.f / resolution[0], 1.f / resolution[1]};
+
+        guide.SetTraining(true);
+        for (int pass = 0; pass < pass_count; ++pass)
+        {
+            auto spp = 1 << pass;
+            ParallelFor(resolution[1], 1, [&](size_t begin, size_t end) {
+                RenderingContext ctx;
+                Sampler sampler{MixSeed(seed, pass, begin)};
+                for (auto y = static_cast<int>(begin); y < static_cast<int>(end); ++y)
+                {
+                    for (int x = 0; x < resolution[0]; ++x)
+                    {
+                        for (int i = 0; i < spp; ++i)
+                        {
+                            auto uv  = ComputeScreenSpaceUV({x, y}, resolution, sampler.Get2D());
+                            auto ray = camera.SpawnRayDifferential(uv, duv, sampler.Get1D());
+
+                            integrator.Li(ctx, sampler, scene, ray);
+                        }
+                    }
+                }
+            });
+
+            guide.Refine();
+        }
+
+        guide.SetTraining(false);
+    }
+} // namespace akane
@@ -0,0 +1,173 @@
+#pragma once
+#include "akane/integrator.h"
+#include "akane/camera.h"
+#include "akane/math/bounds.h"
+#include <atomic>
+#include <vector>
+
+namespace akane
+{
+    /**
+     * Quadtree over the unit square, which is mapped to the sphere of directions by cylindrical
+     * equal-area mapping, where each node keeps the energy recorded in its four quadrants
+     *
+     * Energy is added with atomics, so that paths record concurrently while the structure stays
+     * fixed. The structure only changes in Refined, which is done between passes.
+     */
+    class DirectionalQuadtree
+    {
+    public:
+        DirectionalQuadtree() : nodes_(1)
+        {
+        }
+
+        float Total() const noexcept
+        {
+            const auto& root = nodes_[0];
+
+            float result = 0.f;
+            for (const auto& sum : root.sum)
+            {
+                result += sum.load(std::memory_order_relaxed);
+            }
+
+            return result;
+        }
+
+        // add energy to quadrants containing p at every level
+        void Record(Point2f p, float value) noexcept;
+
+        // sample a point with density proportional to the energy, where pdf_out is in the unit
+        // square. The distribution is uniform if no energy is recorded
+        Point2f Sample(Point2f u, float& pdf_out) const noexcept;
+
+        float Pdf(Point2f p) const noexcept;
+
+        // copy of the tree, where quadrants holding more than threshold of the total energy are
+        // subdivided and the others are collapsed into leaves
+        DirectionalQuadtree Refined(float threshold, int max_depth) const;
+
+        void ClearEnergy() noexcept;
+
+    private:
+        struct Node
+        {
+            // quadrants are ordered as (0, 0), (1, 0), (0, 1) and (1, 1) in the square
+            std::atomic<float> sum[4] = {0.f, 0.f, 0.f, 0.f};
+            uint32_t child[4]         = {0, 0, 0, 0}; // zero for a leaf quadrant
+
+            Node() = default;
+            Node(const Node& other) noexcept
+            {
+                *this = other;
+            }
+
+            Node& operator=(const Node& other) noexcept
+            {
+                for (int i = 0; i < 4; ++i)
+                {
+                    sum[i].store(other.sum[i].load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+                    child[i] = other.child[i];
+                }
+
+                return *this;
+            }
+        };
+
+        std::vector<Node> nodes_;
+    };
+
+    /**
+     * Incident radiance learned online in the style of practical path guiding (Muller et al.
+     * 2017), with a binary tree over the scene bound whose leaves hold directional quadtrees
+     *
+     * Training runs in passes, where paths record radiance into the building quadtrees from every
+     * thread, and Refine splits crowded leaves and turns what was recorded into the distributions
+     * sampled in the next pass.
+     */
+    class PathGuide
+    {
+    public:
+        // fraction of directions sampled from the bsdf rather than the guide, which keeps
+        // glossy lobes and poorly learned regions covered
+        static constexpr float kBsdfSamplingFraction = .5f;
+
+        static float MixPdf(float bsdf_pdf, float guide_pdf) noexcept
+        {
+            return kBsdfSamplingFraction * bsdf_pdf + (1.f - kBsdfSamplingFraction) * guide_pdf;
+        }
+
+        explicit PathGuide(const Bounds3& bound);
+
+        // if there's a learned distribution to sample from
+        bool Ready() const noexcept
+        {
+            return pass_count_ > 0;
+        }
+
+        bool IsTraining() const noexcept
+        {
+            return training_;
+        }
+        void SetTraining(bool training) noexcept
+        {
+            training_ = training;
+        }
+
+        // sample a direction in world space arriving at p, where pdf_out is in solid angle
+        Vec3 Sample(const Vec3& p, const Point2f& u, float& pdf_out) const noexcept;
+
+        float Pdf(const Vec3& p, const Vec3& d) const noexcept;
+
+        // record radiance arriving at p from direction d, estimated by a sample with density pdf
+        // in solid angle. Thread-safe
+        void Record(const Vec3& p, const Vec3& d, float radiance, float pdf) noexcept;
+
+        // end a training pass, not to be called along with other methods
+        void Refine();
+
+    private:
+        struct SpatialNode
+        {
+            uint32_t child[2] = {0, 0}; // both zero for a leaf
+            int axis          = 0;
+            uint32_t leaf     = 0;
+        };
+
+        struct Leaf
+        {
+            DirectionalQuadtree sampling;
+            DirectionalQuadtree building;
+
+            std::atomic<uint32_t> record_count = 0;
+
+            Leaf() = default;
+            Leaf(const Leaf& other)
+                : sampling(other.sampling), building(other.building),
+                  record_count(other.record_count.load(std::memory_order_relaxed))
+            {
+            }
+        };
+
+        const Leaf& FindLeaf(const Vec3& p) const noexcept;
+        Leaf& FindLeaf(const Vec3& p) noexcept
+        {
+            return const_cast<Leaf&>(static_cast<const PathGuide&>(*this).FindLeaf(p));
+        }
+
+        void SplitLeaf(uint32_t node, uint32_t threshold, int depth);
+
+        Bounds3 bound_;
+        std::vector<SpatialNode> nodes_;
+        std::vector<Leaf> leaves_;
+
+        int pass_count_ = 0;
+        bool training_  = true;
+    };
+
+    // train the guide held by the integrator with passes of 1, 2, 4, ... samples per pixel, whose
+    // images are discarded
+    void TrainPathGuide(const Integrator& integrator, PathGuide& guide, const Scene& scene,
+                        const Camera& camera, Point2i resolution, int pass_count, unsigned seed);
+} // namespace akane
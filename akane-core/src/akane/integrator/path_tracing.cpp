@@ -1,26 +1,178 @@
 #include "akane/integrator/path_tracing.h"
+#include "akane/integrator/path_guiding.h"
+#include "akane/bsdf.h"
+#include "akane/math/sampling.h"
+#include "akane/spectral.h"
 
 namespace akane
 {
-    Spectrum SampleAllDirectLight(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
-                                  const IntersectionInfo& isect, const Vec3& wo, const Bsdf& bsdf,
-                                  const Transform& world2local)
+    // radiance along a path is carried at sampled wavelengths in spectral rendering, where colors
+    // of the scene are lifted to spectra as they're multiplied in
+#ifdef AKANE_SPECTRAL_RENDERING
+    using PathSpectrum    = SampledSpectrum;
+    using PathWavelengths = SampledWavelengths;
+#else
+    using PathSpectrum    = Spectrum;
+    using PathWavelengths = RgbWavelengths;
+#endif
+
+    // scattering at a surface point, where directions are in world space
+    struct SurfaceScattering
     {
-        Spectrum total_ld = 0.f;
+        const IntersectionInfo& isect;
+        const Bsdf& bsdf;
+        const Transform& world2local;
+        Vec3 wo;              // in bsdf space
+        const Medium* medium; // that the incident ray travels in
+
+        const PathGuide* guide = nullptr; // if directions are sampled from the guide as well
+
+        Vec3 Point() const noexcept
+        {
+            return isect.point;
+        }
+        const Primitive* Object() const noexcept
+        {
+            return isect.object;
+        }
+        const Medium* MediumToward(const Vec3& wi) const noexcept
+        {
+            return NextMedium(isect, wi, medium);
+        }
+
+        Spectrum Eval(const Vec3& wi) const noexcept
+        {
+            auto local_wi = world2local.ApplyLinear(wi);
+            return bsdf.Eval(wo, local_wi) * abs(local_wi.Dot(kBsdfNormal));
+        }
+        float Pdf(const Vec3& wi) const noexcept
+        {
+            auto pdf = bsdf.Pdf(wo, world2local.ApplyLinear(wi));
+            return guide != nullptr ? PathGuide::MixPdf(pdf, guide->Pdf(isect.point, wi)) : pdf;
+        }
+    };
+
+    // surface vertex of a path whose incident radiance is recorded into the guide
+    struct GuideVertex
+    {
+        static constexpr int kChannelCount = PathWavelengths::kChannelCount;
+
+        Vec3 point;
+        Vec3 wi; // in world space
+        float pdf;
+
+        float throughput[kChannelCount]; // of the path up to the ray leaving the vertex
+        float radiance[kChannelCount];   // arriving along wi, accumulated as the path goes on
+
+        GuideVertex() = default;
+        GuideVertex(const Vec3& point, const Vec3& wi, const PathSpectrum& throughput, float pdf)
+            : point(point), wi(wi), pdf(pdf)
+        {
+            for (int i = 0; i < kChannelCount; ++i)
+            {
+                this->throughput[i] = throughput[i];
+                this->radiance[i]   = 0.f;
+            }
+        }
+
+        void AddRadiance(const PathSpectrum& l) noexcept
+        {
+            for (int i = 0; i < kChannelCount; ++i)
+            {
+                if (throughput[i] > 0)
+                {
+                    radiance[i] += l[i] / throughput[i];
+                }
+            }
+        }
+
+        float AverageRadiance() const noexcept
+        {
+            float sum = 0.f;
+            for (int i = 0; i < kChannelCount; ++i)
+            {
+                sum += radiance[i];
+            }
+
+            return sum / kChannelCount;
+        }
+    };
+
+    // scattering in a medium, where the phase function is sampled exactly
+    struct MediumScattering
+    {
+        Vec3 point;
+        Vec3 d_in;
+        const Medium* medium;
+
+        Vec3 Point() const noexcept
+        {
+            return point;
+        }
+        const Primitive* Object() const noexcept
+        {
+            return nullptr;
+        }
+        const Medium* MediumToward(const Vec3& wi) const noexcept
+        {
+            return medium;
+        }
+
+        Spectrum Eval(const Vec3& wi) const noexcept
+        {
+            return Spectrum{medium->GetPhase().Eval(d_in, wi)};
+        }
+        float Pdf(const Vec3& wi) const noexcept
+        {
+            return medium->GetPhase().Eval(d_in, wi);
+        }
+    };
+
+    // fraction of light from the sample reaching the scattering point, which is binary unless
+    // the scene contains media
+    template <typename Scattering>
+    Spectrum EvalLightVisibility(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                                 const LightSample& sample, const Scattering& scattering,
+                                 float time)
+    {
+        if (!scene.HasMedia())
+        {
+            return sample.TestVisibility(scene, ctx.workspace, scattering.Point(),
+                                         scattering.Object(), time)
+                       ? kWhiteSpectrum
+                       : kBlackSpectrum;
+        }
+
+        auto wi = sample.GenerateShadowRay(scattering.Point(), time).d;
+        return sample.EvalTransmittance(scene, ctx.workspace, sampler, scattering.Point(),
+                                        scattering.MediumToward(wi), time);
+    }
+
+    template <typename Scattering>
+    PathSpectrum SampleAllDirectLight(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                                      const PathWavelengths& lambda, const Scattering& scattering,
+                                      float time)
+    {
+        PathSpectrum total_ld = 0.f;
         for (auto light : scene.GetLightVec())
         {
             auto sample = light->SampleLi(sampler.Get2D());
+            auto pdf    = sample.SolidAnglePdf(scattering.Point());
+            if (pdf <= 0)
+            {
+                continue;
+            }
 
-            if (sample.TestVisibility(scene, ctx.workspace, isect.point, isect.object))
+            auto tr = EvalLightVisibility(ctx, sampler, scene, sample, scattering, time);
+            if (tr.Max() > 0)
             {
-                auto shadow_ray = sample.GenerateShadowRay(isect.point);
-                auto wi         = world2local.ApplyLinear(shadow_ray.d);
+                auto shadow_ray = sample.GenerateShadowRay(scattering.Point(), time);
 
                 // direct radiance from light source
-                auto f  = bsdf.Eval(wo, wi) * abs(wi.Dot(kBsdfNormal));
-                auto ld = light->Eval(shadow_ray) / sample.Pdf();
+                auto f  = scattering.Eval(shadow_ray.d);
+                auto ld = light->Eval(shadow_ray) / pdf;
 
-                total_ld += f * ld;
+                total_ld += lambda.Lift(f) * lambda.Lift(tr) * lambda.Lift(ld);
             }
         }
 
@@ -28,9 +180,10 @@ namespace akane
     }
 
     // TODO: this function is buggy (return nan)
-    Spectrum SampleRandomDirectLight(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
-                                     const IntersectionInfo& isect, const Vec3& wo,
-                                     const Bsdf& bsdf, const Transform& world2local)
+    template <typename Scattering>
+    PathSpectrum SampleRandomDirectLight(RenderingContext& ctx, Sampler& sampler,
+                                         const Scene& scene, const PathWavelengths& lambda,
+                                         const Scattering& scattering, float time)
     {
         float light_choice_pdf;
         auto light = scene.SampleLight(sampler.Get1D(), light_choice_pdf);
@@ -38,68 +191,213 @@ namespace akane
         if (light_choice_pdf != 0)
         {
             auto sample = light->SampleLi(sampler.Get2D());
+            auto pdf    = sample.SolidAnglePdf(scattering.Point());
+            if (pdf <= 0)
+            {
+                return PathSpectrum{0.f};
+            }
 
-            if (sample.TestVisibility(scene, ctx.workspace, isect.point, isect.object))
+            auto tr = EvalLightVisibility(ctx, sampler, scene, sample, scattering, time);
+            if (tr.Max() > 0)
             {
-                auto shadow_ray = sample.GenerateShadowRay(isect.point);
-                auto wi         = world2local.ApplyLinear(shadow_ray.d);
+                auto shadow_ray = sample.GenerateShadowRay(scattering.Point(), time);
 
                 // direct radiance from light source
-                auto f  = bsdf.Eval(wo, wi) * abs(wi.Dot(kBsdfNormal));
-                auto ld = light->Eval(shadow_ray) / (sample.Pdf() * light_choice_pdf);
+                auto f  = scattering.Eval(shadow_ray.d);
+                auto ld = light->Eval(shadow_ray) / (pdf * light_choice_pdf);
 
-                return f * ld;
+                return lambda.Lift(f) * lambda.Lift(tr) * lambda.Lift(ld);
             }
         }
 
-        return kBlackSpectrum;
+        return PathSpectrum{0.f};
     }
 
-    Spectrum SampleGlobalLight(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
-                               const IntersectionInfo& isect, const Vec3& wo, const Bsdf& bsdf,
-                               const Transform& world2local)
+    template <typename Scattering>
+    PathSpectrum SampleGlobalLight(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                                   const PathWavelengths& lambda, const Scattering& scattering,
+                                   float time)
     {
         Light* global_light = scene.GetGlobalLight();
 
         if (global_light != nullptr)
         {
             auto sample = global_light->SampleLi(sampler.Get2D());
+            if (sample.Pdf() <= 0)
+            {
+                return PathSpectrum{0.f};
+            }
 
-            if (sample.TestVisibility(scene, ctx.workspace, isect.point, isect.object))
+            auto tr = EvalLightVisibility(ctx, sampler, scene, sample, scattering, time);
+            if (tr.Max() > 0)
             {
-                auto shadow_ray = sample.GenerateShadowRay(isect.point);
-                auto wi         = world2local.ApplyLinear(shadow_ray.d);
+                auto shadow_ray = sample.GenerateShadowRay(scattering.Point(), time);
 
-                // direct radiance from light source
-                auto f  = bsdf.Eval(wo, wi) * abs(wi.Dot(kBsdfNormal));
-                auto ld = global_light->Eval(shadow_ray);
+                // direct radiance from light source, weighted against escaping scattered samples
+                auto f      = scattering.Eval(shadow_ray.d);
+                auto ld     = global_light->Eval(shadow_ray) / sample.Pdf();
+                auto weight = PowerHeuristic(sample.Pdf(), scattering.Pdf(shadow_ray.d));
+
+                return lambda.Lift(f) * lambda.Lift(tr) * lambda.Lift(ld) * weight;
+            }
+        }
 
-                return f * ld;
+        return PathSpectrum{0.f};
+    }
+
+    // returns false if the path is terminated, otherwise the throughput is compensated
+    template <typename T> bool SurviveRussianRoulette(Sampler& sampler, T& contrib)
+    {
+        auto p = contrib.Max();
+        if (p < 1)
+        {
+            if (sampler.Get1D() > p)
+            {
+                return false;
             }
+
+            contrib /= p;
+        }
+
+        return true;
+    }
+
+    // differentials of the ray scattered into wi by specular reflection or transmission, assuming
+    // that the normal doesn't vary over the footprint
+    RayDifferential ComputeSpecularDifferential(const Ray& ray, const IntersectionInfo& isect,
+                                                const Vec3& wi)
+    {
+        auto n  = isect.ns.Normalized();
+        auto wo = -ray.d;
+
+        auto cos_o   = Dot(wo, n);
+        auto dwodx   = -ray.differential.dddx;
+        auto dwody   = -ray.differential.dddy;
+        auto dcosodx = Dot(dwodx, n);
+        auto dcosody = Dot(dwody, n);
+
+        RayDifferential result;
+        result.dodx = isect.dpdx;
+        result.dody = isect.dpdy;
+
+        if (cos_o * Dot(wi, n) > 0)
+        {
+            // wi = -wo + 2 * cos_o * n
+            result.dddx = -dwodx + 2 * dcosodx * n;
+            result.dddy = -dwody + 2 * dcosody * n;
+        }
+        else
+        {
+            // wi = -eta * wo + mu * n, where eta is the ratio of tangential components
+            auto wo_tangent = (wo - cos_o * n).Length();
+            auto wi_tangent = (wi - Dot(wi, n) * n).Length();
+            auto eta        = wo_tangent > 1e-6f ? wi_tangent / wo_tangent : 1.f;
+
+            auto dmu    = eta + eta * eta * cos_o / Dot(wi, n);
+            result.dddx = -eta * dwodx + dmu * dcosodx * n;
+            result.dddy = -eta * dwody + dmu * dcosody * n;
         }
 
-        return kBlackSpectrum;
+        return result;
     }
 
     Spectrum PathTracingIntegrator::Li(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
                                        const Ray& camera_ray) const
     {
-        Ray ray          = camera_ray;
-        Spectrum result  = 0.f;
-        Spectrum contrib = 1.f;
+        // guards against paths trapped by degenerate medium boundaries
+        constexpr int kMaxBoundaryCrossings = 64;
+
+        auto lambda = PathWavelengths::Sample(sampler);
+
+        Ray ray              = camera_ray;
+        PathSpectrum result  = 0.f;
+        PathSpectrum contrib = 1.f;
+
+        ray.medium = scene.GetCameraMedium();
 
         bool from_camera_or_specular = true;
-        for (int bounce = 0; bounce < max_bounce_; ++bounce)
+        float scatter_pdf            = 0.f; // of the bsdf or phase sample generating the ray
+
+        int bounce             = 0;
+        int boundary_crossings = 0;
+
+        // radiance found later along the path is also credited to recorded vertices
+        constexpr int kMaxGuideVertices = 32;
+
+        GuideVertex guide_vertices[kMaxGuideVertices];
+        int guide_vertex_count = 0;
+
+        auto recording    = guide_ != nullptr && guide_->IsTraining();
+        auto add_radiance = [&](const PathSpectrum& l) {
+            result += l;
+            for (int i = 0; i < guide_vertex_count; ++i)
+            {
+                guide_vertices[i].AddRadiance(l);
+            }
+        };
+        while (bounce < max_bounce_)
         {
             ctx.workspace.Clear();
 
             IntersectionInfo isect;
-            if (!scene.Intersect(ray, ctx.workspace, isect))
+            auto hit = scene.Intersect(ray, ctx.workspace, isect);
+
+            // free flight in the medium, which may scatter the ray before reaching the surface
+            if (ray.medium != nullptr)
             {
-                // blend global lighting
+                float t;
+                Spectrum weight;
+                auto scattered = ray.medium->SampleInteraction(
+                    ray, hit ? isect.t : kTravelDistanceMax, sampler, t, weight);
+
+                contrib *= lambda.Lift(weight);
+                if (contrib.Max() <= 0)
+                {
+                    break;
+                }
+
+                if (scattered)
+                {
+                    auto scattering = MediumScattering{ray.o + t * ray.d, ray.d, ray.medium};
+
+                    auto time       = ray.time;
+
+                    add_radiance(
+                        contrib * SampleGlobalLight(ctx, sampler, scene, lambda, scattering, time));
+                    add_radiance(contrib * SampleAllDirectLight(ctx, sampler, scene, lambda,
+                                                                scattering, time));
+
+                    // phase function over its pdf is one
+                    float pdf_wi;
+                    auto wi = ray.medium->GetPhase().Sample(ray.d, sampler.Get2D(), pdf_wi);
+
+                    from_camera_or_specular = false;
+                    scatter_pdf             = pdf_wi;
+
+                    auto next_ray   = Ray{scattering.point, wi, ray.time};
+                    next_ray.medium = ray.medium;
+                    ray             = next_ray;
+
+                    if (bounce >= min_bounce_ && !SurviveRussianRoulette(sampler, contrib))
+                    {
+                        break;
+                    }
+
+                    ++bounce;
+                    continue;
+                }
+            }
+
+            if (!hit)
+            {
+                // blend global lighting, which is also explicitly sampled at non-specular bounces
                 if (auto global_light = scene.GetGlobalLight(); global_light != nullptr)
                 {
-                    result += contrib * global_light->Eval(ray);
+                    auto weight = from_camera_or_specular
+                                      ? 1.f
+                                      : PowerHeuristic(scatter_pdf, global_light->PdfLi(ray.d));
+
+                    add_radiance(contrib * lambda.Lift(global_light->Eval(ray)) * weight);
                 }
 
                 break;
@@ -111,68 +409,153 @@ namespace akane
             if (isect.area_light && from_camera_or_specular)
             {
                 // TODO: verify this
-                result += contrib * isect.area_light->Eval(ray);
+                add_radiance(contrib * lambda.Lift(isect.area_light->Eval(ray)));
                 break; // assuming light is dominant by direct illumination
             }
 
+            // invisible boundary of media, which the ray passes straight through without counting
+            // a bounce
+            if (isect.material == nullptr && isect.medium_interface != nullptr)
+            {
+                if (++boundary_crossings > kMaxBoundaryCrossings)
+                {
+                    break;
+                }
+
+                auto next_ray   = Ray{isect.point, ray.d, ray.time};
+                next_ray.medium = NextMedium(isect, ray.d, ray.medium);
+                if (ray.has_differentials)
+                {
+                    ComputeDifferentials(ray, isect);
+                    next_ray.has_differentials = true;
+                    next_ray.differential      = ComputeSpecularDifferential(ray, isect, ray.d);
+                }
+
+                ray = next_ray;
+                continue;
+            }
+
             if (isect.material == nullptr)
             {
                 break;
             }
 
-            auto bsdf        = isect.material->ComputeBsdf(ctx.workspace, isect);
-            auto world2local = CreateBsdfCoordTransform(isect.ns);
-            auto bsdf_wo     = world2local.ApplyLinear(-ray.d);
+            // footprint for texture filtering
+            ComputeDifferentials(ray, isect);
 
             // TODO: verify this
-            if (bsdf == nullptr)
+            Bsdf bsdf;
+            if (!isect.material->ComputeBsdf(isect, bsdf))
             {
                 break;
             }
 
-            bool is_specular_bsdf   = bsdf->GetType().Contain(BsdfType::Specular);
+#ifdef AKANE_SPECTRAL_RENDERING
+            // only the hero wavelength follows a direction sampled from a dispersive bsdf
+            if (bsdf.SelectWavelength(lambda.Hero()))
+            {
+                lambda.TerminateSecondary();
+            }
+#endif
+
+            auto world2local = CreateBsdfCoordTransform(isect.ns, isect.dpdu);
+            auto bsdf_wo     = world2local.ApplyLinear(-ray.d);
+
+            bool is_specular_bsdf   = bsdf.GetType().Contain(BsdfType::Specular);
             from_camera_or_specular = is_specular_bsdf;
 
+            // specular lobes can't be represented by the guide
+            const PathGuide* guide = nullptr;
+            if (guide_ != nullptr && guide_->Ready() && !is_specular_bsdf)
+            {
+                guide = guide_.get();
+            }
+
             // estimate direct light
             if (!is_specular_bsdf)
             {
-                result += contrib * SampleGlobalLight(ctx, sampler, scene, isect, bsdf_wo, *bsdf,
-                                                      world2local);
+                auto scattering =
+                    SurfaceScattering{isect, bsdf, world2local, bsdf_wo, ray.medium, guide};
 
-                result += contrib * SampleAllDirectLight(ctx, sampler, scene, isect, bsdf_wo, *bsdf,
-                                                         world2local);
+                add_radiance(contrib * SampleGlobalLight(ctx, sampler, scene, lambda, scattering,
+                                                         ray.time));
+                add_radiance(contrib * SampleAllDirectLight(ctx, sampler, scene, lambda,
+                                                            scattering, ray.time));
             }
 
-            // sample bsdf
+            // sample bsdf, or the guide with a fixed probability
             Vec3 bsdf_wi;
             float pdf_wi;
-            auto f = bsdf->SampleAndEval(sampler.Get2D(), bsdf_wo, bsdf_wi, pdf_wi);
+            Spectrum f;
+            if (guide == nullptr)
+            {
+                f = bsdf.SampleAndEval(sampler.Get2D(), bsdf_wo, bsdf_wi, pdf_wi);
+            }
+            else
+            {
+                float sample_pdf;
+                if (sampler.Get1D() < PathGuide::kBsdfSamplingFraction)
+                {
+                    bsdf.SampleAndEval(sampler.Get2D(), bsdf_wo, bsdf_wi, sample_pdf);
+                }
+                else
+                {
+                    auto wi = guide->Sample(isect.point, sampler.Get2D(), sample_pdf);
+                    bsdf_wi = world2local.ApplyLinear(wi);
+                }
+
+                if (sample_pdf == 0)
+                {
+                    break;
+                }
+
+                auto guide_pdf = guide->Pdf(isect.point, world2local.InverseLinear(bsdf_wi));
+
+                f      = bsdf.Eval(bsdf_wo, bsdf_wi);
+                pdf_wi = PathGuide::MixPdf(bsdf.Pdf(bsdf_wo, bsdf_wi), guide_pdf);
+            }
+
             if (pdf_wi == 0)
             {
                 break;
             }
 
-            contrib *= f * AbsCosTheta(bsdf_wi) / pdf_wi;
-            ray = Ray{isect.point, world2local.ApplyLinear(bsdf_wi)};
+            contrib *= lambda.Lift(f) * (AbsCosTheta(bsdf_wi) / pdf_wi);
+            scatter_pdf = pdf_wi;
 
-            // russian roulette
-            if (bounce >= min_bounce_)
+            // differentials are only propagated through specular bounces, where the footprint
+            // stays coherent
+            auto next_ray   = Ray{isect.point, world2local.InverseLinear(bsdf_wi), ray.time};
+            next_ray.medium = NextMedium(isect, next_ray.d, ray.medium);
+            if (ray.has_differentials && is_specular_bsdf)
             {
-                auto p = contrib.Max();
+                next_ray.has_differentials = true;
+                next_ray.differential      = ComputeSpecularDifferential(ray, isect, next_ray.d);
+            }
 
-                if (p < 1)
-                {
-                    if (sampler.Get1D() > p)
-                    {
-                        break;
-                    }
+            ray = next_ray;
 
-                    contrib /= p;
-                }
+            if (recording && !is_specular_bsdf && guide_vertex_count < kMaxGuideVertices)
+            {
+                guide_vertices[guide_vertex_count++] =
+                    GuideVertex{isect.point, ray.d, contrib, pdf_wi};
+            }
+
+            if (bounce >= min_bounce_ && !SurviveRussianRoulette(sampler, contrib))
+            {
+                break;
             }
+
+            ++bounce;
+        }
+
+        for (int i = 0; i < guide_vertex_count; ++i)
+        {
+            const auto& v = guide_vertices[i];
+            guide_->Record(v.point, v.wi, v.AverageRadiance(), v.pdf);
         }
 
         AKANE_CHECK(!InvalidSpectrum(result));
-        return result;
+        return lambda.ToRGB(result);
     }
-} // namespace akane
\ No newline at end of file
+} // namespace akane
@@ -7,6 +7,8 @@
 
 namespace akane
 {
+    class PathGuide;
+
     class PathTracingIntegrator : public Integrator
     {
     public:
@@ -16,11 +18,21 @@ namespace akane
             AKANE_REQUIRE(min_bounce > 0 && max_bounce >= min_bounce);
         }
 
+        // once the guide has learned something, directions at non-specular surfaces are sampled
+        // from a mixture of the guide and the bsdf. Radiance is recorded into the guide while
+        // it's training
+        void SetPathGuide(shared_ptr<PathGuide> guide)
+        {
+            guide_ = std::move(guide);
+        }
+
         Spectrum Li(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
                     const Ray& camera_ray) const override;
 
     private:
         int min_bounce_ = 1;
         int max_bounce_ = 1;
+
+        shared_ptr<PathGuide> guide_ = nullptr;
     };
 } // namespace akane
\ No newline at end of file
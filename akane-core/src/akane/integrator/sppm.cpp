@@ -0,0 +1,594 @@
+#include "akane/integrator/sppm.h"
+#include "akane/bsdf/bsdf_geometry.h"
+#include "akane/bsdf.h"
+#include "akane/common/atomic.h"
+#include "akane/common/parallel.h"
+#include "akane/math/bounds.h"
+#include <numeric>
+
+namespace akane
+{
+    namespace
+    {
+        // fraction of photons gathered in an iteration that is kept as the radius shrinks
+        constexpr float kRadiusReduction = 2.f / 3.f;
+
+        constexpr size_t kPixelGrainSize  = 4096;
+        constexpr size_t kPhotonGrainSize = 4096;
+
+        // stream of samplers for a pass of an iteration, i.e. camera paths or photons
+        uint64_t PassStream(int iteration, int pass) noexcept
+        {
+            return (static_cast<uint64_t>(iteration) << 1) | pass;
+        }
+
+        // first non-specular surface along the camera path of a pixel
+        // kept compact as there is one per pixel, where only axes of the bsdf frame are stored
+        // and non-specular lobes live in a pool of the row, which is refilled in each iteration
+        struct VisiblePoint
+        {
+            bool valid = false;
+
+            Vec3 point;
+            Vec3 wo;       // in the local frame of bsdf
+            Spectrum beta; // throughput of the camera path, scaled by energy scale of bsdf at wo
+
+            Vec3 frame_x;
+            Vec3 frame_z;
+
+            int lobe_offset = 0;
+            int lobe_count  = 0;
+
+            Transform World2Local() const noexcept
+            {
+                return Transform{frame_x, Cross(frame_z, frame_x), frame_z};
+            }
+
+            Spectrum Eval(const BsdfLobe* lobes, const Vec3& wi) const noexcept
+            {
+                Spectrum f = kBlackSpectrum;
+                for (int i = 0; i < lobe_count; ++i)
+                {
+                    f += EvalLobe(lobes[lobe_offset + i], wo, wi);
+                }
+
+                return f;
+            }
+        };
+
+        struct SppmPixel
+        {
+            float radius       = 0.f;
+            float photon_count = 0.f; // grows by a fraction of photons gathered in each iteration
+
+            Spectrum tau = kBlackSpectrum; // flux gathered over iterations within the radius
+            Spectrum ld  = kBlackSpectrum; // radiance summed over iterations, excluding photons
+
+            VisiblePoint vp;
+
+            // photons gathered in the current iteration, which photon passes add to concurrently
+            std::atomic<float> phi[3] = {0.f, 0.f, 0.f};
+            std::atomic<int> m        = 0;
+        };
+
+        /**
+         * Uniform grid over visible points hashed into a fixed table, where each entry heads a
+         * list of pixels whose gather sphere overlaps a cell mapped to the entry
+         *
+         * Pixels are pushed onto lists with compare-and-swap from every thread without locks.
+         * Nodes are allocated up front by the caller, as cells that a pixel overlaps are known.
+         */
+        class VisiblePointGrid
+        {
+        public:
+            struct Node
+            {
+                int pixel;
+                Point3i cell; // tells apart cells colliding in the table
+                Node* next;
+            };
+
+            explicit VisiblePointGrid(size_t table_size)
+                : table_size_(table_size), heads_(new std::atomic<Node*>[table_size])
+            {
+            }
+
+            // cells are cubes with the given size over the bound
+            void Reset(const Bounds3& bound, float cell_size)
+            {
+                bound_         = bound;
+                inv_cell_size_ = 1.f / cell_size;
+
+                auto diagonal = bound.Diagonal();
+                for (int a = 0; a < 3; ++a)
+                {
+                    resolution_[a] = max(1, static_cast<int>(ceil(diagonal[a] * inv_cell_size_)));
+                }
+
+                for (size_t i = 0; i < table_size_; ++i)
+                {
+                    heads_[i].store(nullptr, std::memory_order_relaxed);
+                }
+            }
+
+            int CountCells(const Vec3& p, float radius) const noexcept
+            {
+                Point3i lower, upper;
+                ComputeCellRange(p, radius, lower, upper);
+
+                return (upper[0] - lower[0] + 1) * (upper[1] - lower[1] + 1) *
+                       (upper[2] - lower[2] + 1);
+            }
+
+            // add the pixel to every cell its sphere overlaps, where nodes has CountCells entries
+            void Insert(const Vec3& p, float radius, int pixel, Node* nodes) noexcept
+            {
+                Point3i lower, upper;
+                ComputeCellRange(p, radius, lower, upper);
+
+                for (int z = lower[2]; z <= upper[2]; ++z)
+                {
+                    for (int y = lower[1]; y <= upper[1]; ++y)
+                    {
+                        for (int x = lower[0]; x <= upper[0]; ++x)
+                        {
+                            auto& head = heads_[Hash(x, y, z)];
+                            auto node  = nodes++;
+
+                            node->pixel = pixel;
+                            node->cell  = Point3i{x, y, z};
+                            node->next  = head.load(std::memory_order_relaxed);
+                            while (!head.compare_exchange_weak(node->next, node,
+                                                               std::memory_order_release,
+                                                               std::memory_order_relaxed))
+                            {
+                            }
+                        }
+                    }
+                }
+            }
+
+            // invoke f(pixel) for pixels listed in the cell containing p, which may be farther
+            // than their radius
+            template <typename F> void ForEachPixel(const Vec3& p, F&& f) const
+            {
+                Point3i cell;
+                for (int a = 0; a < 3; ++a)
+                {
+                    if (!(p[a] >= bound_.lower[a] && p[a] <= bound_.upper[a]))
+                    {
+                        return;
+                    }
+
+                    cell[a] = ToCell(p[a], a);
+                }
+
+                auto node = heads_[Hash(cell[0], cell[1], cell[2])].load(std::memory_order_acquire);
+                for (; node != nullptr; node = node->next)
+                {
+                    if (node->cell == cell)
+                    {
+                        f(node->pixel);
+                    }
+                }
+            }
+
+        private:
+            int ToCell(float x, int axis) const noexcept
+            {
+                auto cell = static_cast<int>((x - bound_.lower[axis]) * inv_cell_size_);
+                return clamp(cell, 0, resolution_[axis] - 1);
+            }
+
+            void ComputeCellRange(const Vec3& p, float radius, Point3i& lower,
+                                  Point3i& upper) const noexcept
+            {
+                for (int a = 0; a < 3; ++a)
+                {
+                    lower[a] = ToCell(p[a] - radius, a);
+                    upper[a] = ToCell(p[a] + radius, a);
+                }
+            }
+
+            size_t Hash(int x, int y, int z) const noexcept
+            {
+                auto h = (static_cast<uint32_t>(x) * 73856093u) ^
+                         (static_cast<uint32_t>(y) * 19349663u) ^
+                         (static_cast<uint32_t>(z) * 83492791u);
+                return h % table_size_;
+            }
+
+            size_t table_size_;
+            std::unique_ptr<std::atomic<Node*>[]> heads_;
+
+            Bounds3 bound_;
+            float inv_cell_size_ = 1.f;
+            Point3i resolution_  = {1, 1, 1};
+        };
+
+        // direct lighting from one light chosen in the scene and from the global light
+        Spectrum EstimateDirectLight(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                                     const IntersectionInfo& isect, const Bsdf& bsdf,
+                                     const Transform& world2local, const Vec3& wo, float time)
+        {
+            auto eval = [&](const Light* light, const LightSample& sample, float pdf) {
+                if (pdf <= 0 ||
+                    !sample.TestVisibility(scene, ctx.workspace, isect.point, isect.object, time))
+                {
+                    return kBlackSpectrum;
+                }
+
+                auto shadow_ray = sample.GenerateShadowRay(isect.point, time);
+                auto wi         = world2local.ApplyLinear(shadow_ray.d);
+
+                return bsdf.Eval(wo, wi) * AbsCosTheta(wi) * light->Eval(shadow_ray) / pdf;
+            };
+
+            Spectrum result = kBlackSpectrum;
+
+            float choice_pdf;
+            if (auto light = scene.SampleLight(sampler.Get1D(), choice_pdf); light != nullptr)
+            {
+                auto sample = light->SampleLi(sampler.Get2D());
+                result += eval(light, sample, sample.SolidAnglePdf(isect.point) * choice_pdf);
+            }
+
+            if (auto global_light = scene.GetGlobalLight(); global_light != nullptr)
+            {
+                auto sample = global_light->SampleLi(sampler.Get2D());
+                result += eval(global_light, sample, sample.Pdf());
+            }
+
+            return result;
+        }
+
+        // follow the camera path through specular bounces, where emission seen along the way and
+        // direct lighting at the visible point are added to the pixel right away
+        void TraceVisiblePoint(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                               Ray ray, int max_bounce, SppmPixel& pixel,
+                               std::vector<BsdfLobe>& lobes)
+        {
+            pixel.vp.valid = false;
+
+            Spectrum beta = kWhiteSpectrum;
+            for (int bounce = 0; bounce < max_bounce; ++bounce)
+            {
+                ctx.workspace.Clear();
+
+                IntersectionInfo isect;
+                if (!scene.Intersect(ray, ctx.workspace, isect))
+                {
+                    if (auto global_light = scene.GetGlobalLight(); global_light != nullptr)
+                    {
+                        pixel.ld += beta * global_light->Eval(ray);
+                    }
+
+                    return;
+                }
+
+                if (isect.area_light != nullptr)
+                {
+                    pixel.ld += beta * isect.area_light->Eval(ray);
+                    return;
+                }
+
+                if (isect.material == nullptr)
+                {
+                    return;
+                }
+
+                ComputeDifferentials(ray, isect);
+
+                Bsdf bsdf;
+                if (!isect.material->ComputeBsdf(isect, bsdf))
+                {
+                    return;
+                }
+
+                auto world2local = CreateBsdfCoordTransform(isect.ns, isect.dpdu);
+                auto wo          = world2local.ApplyLinear(-ray.d);
+
+                if (!bsdf.GetType().Contain(BsdfType::Specular))
+                {
+                    pixel.ld += beta * EstimateDirectLight(ctx, sampler, scene, isect, bsdf,
+                                                           world2local, wo, ray.time);
+                    // specular lobes never see a photon coming from a direction of their own
+                    auto lobe_offset = lobes.size();
+                    for (int i = 0; i < bsdf.LobeCount(); ++i)
+                    {
+                        if (!GetLobeType(bsdf.GetLobe(i)).Contain(BsdfType::Specular))
+                        {
+                            lobes.push_back(bsdf.GetLobe(i));
+                        }
+                    }
+
+                    pixel.vp = VisiblePoint{true,
+                                            isect.point,
+                                            wo,
+                                            beta * bsdf.EnergyScale(wo),
+                                            world2local.X(),
+                                            world2local.Z(),
+                                            static_cast<int>(lobe_offset),
+                                            static_cast<int>(lobes.size() - lobe_offset)};
+                    return;
+                }
+
+                Vec3 wi;
+                float pdf;
+                auto f = bsdf.SampleAndEval(sampler.Get2D(), wo, wi, pdf);
+                if (pdf == 0)
+                {
+                    return;
+                }
+
+                beta *= f * AbsCosTheta(wi) / pdf;
+                if (beta.Max() <= 0)
+                {
+                    return;
+                }
+
+                ray = Ray{isect.point, world2local.InverseLinear(wi), ray.time};
+            }
+        }
+
+        // trace a photon from a light placed in the scene, which is gathered by visible points
+        // around every vertex but the first, whose contribution is direct lighting
+        void TracePhoton(RenderingContext& ctx, Sampler& sampler, const Scene& scene,
+                         const VisiblePointGrid& grid, std::vector<SppmPixel>& pixels,
+                         const std::vector<std::vector<BsdfLobe>>& row_lobes, int width,
+                         int max_bounce, float time)
+        {
+            float choice_pdf;
+            auto light = scene.SampleLight(sampler.Get1D(), choice_pdf);
+            if (light == nullptr || choice_pdf == 0)
+            {
+                return;
+            }
+
+            Ray ray;
+            Vec3 n;
+            float pdf_pos, pdf_dir;
+            auto le = light->SampleLe(sampler.Get2D(), sampler.Get2D(), ray, n, pdf_pos, pdf_dir);
+            if (pdf_pos == 0 || pdf_dir == 0 || le.Max() <= 0)
+            {
+                return;
+            }
+
+            ray.time = time;
+
+            auto cos_theta = n != Vec3{0.f} ? abs(Dot(n, ray.d)) : 1.f;
+            auto beta      = le * cos_theta / (choice_pdf * pdf_pos * pdf_dir);
+            for (int bounce = 0; bounce < max_bounce; ++bounce)
+            {
+                ctx.workspace.Clear();
+
+                IntersectionInfo isect;
+                if (!scene.Intersect(ray, ctx.workspace, isect))
+                {
+                    break;
+                }
+
+                if (bounce > 0)
+                {
+                    grid.ForEachPixel(isect.point, [&](int index) {
+                        auto& pixel = pixels[index];
+                        if ((pixel.vp.point - isect.point).LengthSq() >
+                            pixel.radius * pixel.radius)
+                        {
+                            return;
+                        }
+
+                        auto wi  = pixel.vp.World2Local().ApplyLinear(-ray.d);
+                        auto phi = beta * pixel.vp.Eval(row_lobes[index / width].data(), wi);
+                        for (int a = 0; a < 3; ++a)
+                        {
+                            AtomicAdd(pixel.phi[a], phi[a]);
+                        }
+
+                        pixel.m.fetch_add(1, std::memory_order_relaxed);
+                    });
+                }
+
+                if (isect.material == nullptr)
+                {
+                    break;
+                }
+
+                Bsdf bsdf;
+                if (!isect.material->ComputeBsdf(isect, bsdf))
+                {
+                    break;
+                }
+
+                auto world2local = CreateBsdfCoordTransform(isect.ns, isect.dpdu);
+                auto wo          = world2local.ApplyLinear(-ray.d);
+
+                Vec3 wi;
+                float pdf;
+                auto f = bsdf.SampleAndEval(sampler.Get2D(), wo, wi, pdf);
+                if (pdf == 0)
+                {
+                    break;
+                }
+
+                // light flows from wo to wi here
+                if (!bsdf.GetType().Contain(BsdfType::Specular))
+                {
+                    f = bsdf.Eval(wi, wo);
+                }
+
+                // russian roulette keeping the flux of surviving photons close to the emitted one
+                auto next_beta = beta * f * AbsCosTheta(wi) / pdf;
+                auto q         = max(0.f, 1.f - next_beta.Max() / beta.Max());
+                if (sampler.Get1D() < q)
+                {
+                    break;
+                }
+
+                beta = next_beta / (1.f - q);
+                ray  = Ray{isect.point, world2local.InverseLinear(wi), ray.time};
+            }
+        }
+
+        // fold photons gathered in this iteration into the pixel and shrink its radius
+        void UpdatePixel(SppmPixel& pixel) noexcept
+        {
+            auto m = pixel.m.exchange(0, std::memory_order_relaxed);
+            if (m == 0)
+            {
+                return;
+            }
+
+            Spectrum phi;
+            for (int a = 0; a < 3; ++a)
+            {
+                phi[a] = pixel.phi[a].exchange(0.f, std::memory_order_relaxed);
+            }
+
+            auto photon_count = pixel.photon_count + kRadiusReduction * m;
+            auto radius       = pixel.radius * sqrt(photon_count / (pixel.photon_count + m));
+
+            pixel.tau = (pixel.tau + pixel.vp.beta * phi) * (radius * radius) /
+                        (pixel.radius * pixel.radius);
+            pixel.photon_count = photon_count;
+            pixel.radius       = radius;
+        }
+    } // namespace
+
+    RenderResult SppmIntegrator::Execute(
+        const Scene& scene, const Camera& camera, Point2i resolution, int iteration_count,
+        unsigned seed, std::function<bool()>* activity_query,
+        std::function<void(int, const RenderResult&)>* checkpoint_handler) const
+    {
+        auto width       = resolution[0];
+        auto pixel_count = static_cast<size_t>(resolution[0]) * resolution[1];
+
+        std::vector<SppmPixel> pixels(pixel_count);
+        for (auto& pixel : pixels)
+        {
+            pixel.radius = initial_radius_;
+        }
+
+        VisiblePointGrid grid{pixel_count};
+        std::vector<size_t> node_offsets(pixel_count + 1, 0);
+        std::vector<VisiblePointGrid::Node> nodes;
+        std::vector<std::vector<BsdfLobe>> row_lobes(resolution[1]);
+
+        auto duv = Vec2{1.f / resolution[0], 1.f / resolution[1]};
+
+        RenderResult result{};
+        result.canvas = make_shared<Canvas>(resolution[0], resolution[1]);
+
+        // estimate of a pixel is ld / N + tau / (N * photons * pi * r^2) after N iterations,
+        // which is scaled by N as the canvas is divided by ssp
+        auto resolve_canvas = [&] {
+            auto photon_scale = 1.f / (photon_per_iteration_ * kPi);
+            for (size_t i = 0; i < pixel_count; ++i)
+            {
+                const auto& pixel = pixels[i];
+
+                auto radiance =
+                    pixel.ld + pixel.tau * photon_scale / (pixel.radius * pixel.radius);
+                result.canvas->SetPixel(static_cast<int>(i % width), static_cast<int>(i / width),
+                                        radiance);
+            }
+        };
+
+        for (int iteration = 0; iteration < iteration_count; ++iteration)
+        {
+            if (activity_query != nullptr && !(*activity_query)())
+            {
+                break;
+            }
+
+            // camera pass
+            ParallelFor(resolution[1], 1, [&](size_t begin, size_t end) {
+                RenderingContext ctx;
+                Sampler sampler{MixSeed(seed, PassStream(iteration, 0), begin)};
+                for (auto y = static_cast<int>(begin); y < static_cast<int>(end); ++y)
+                {
+                    row_lobes[y].clear();
+                    for (int x = 0; x < width; ++x)
+                    {
+                        auto uv  = ComputeScreenSpaceUV({x, y}, resolution, sampler.Get2D());
+                        auto ray = camera.SpawnRayDifferential(uv, duv, sampler.Get1D());
+
+                        TraceVisiblePoint(ctx, sampler, scene, ray, max_bounce_,
+                                          pixels[static_cast<size_t>(y) * width + x],
+                                          row_lobes[y]);
+                    }
+                }
+            });
+
+            // grid with cells as large as the largest radius, so that a sphere overlaps a few
+            Bounds3 bound;
+            float max_radius = 0.f;
+            for (const auto& pixel : pixels)
+            {
+                if (pixel.vp.valid)
+                {
+                    bound = Union(bound, Bounds3{pixel.vp.point - Vec3{pixel.radius},
+                                                 pixel.vp.point + Vec3{pixel.radius}});
+                    max_radius = max(max_radius, pixel.radius);
+                }
+            }
+
+            if (!bound.Empty())
+            {
+                grid.Reset(bound, max_radius);
+
+                ParallelFor(pixel_count, kPixelGrainSize, [&](size_t begin, size_t end) {
+                    for (auto i = begin; i < end; ++i)
+                    {
+                        const auto& vp      = pixels[i].vp;
+                        node_offsets[i + 1] = vp.valid ? grid.CountCells(vp.point, pixels[i].radius)
+                                                       : 0;
+                    }
+                });
+
+                std::partial_sum(node_offsets.begin(), node_offsets.end(), node_offsets.begin());
+                nodes.resize(node_offsets.back());
+
+                ParallelFor(pixel_count, kPixelGrainSize, [&](size_t begin, size_t end) {
+                    for (auto i = begin; i < end; ++i)
+                    {
+                        const auto& vp = pixels[i].vp;
+                        if (vp.valid)
+                        {
+                            grid.Insert(vp.point, pixels[i].radius, static_cast<int>(i),
+                                        nodes.data() + node_offsets[i]);
+                        }
+                    }
+                });
+
+                // photon pass
+                ParallelFor(photon_per_iteration_, kPhotonGrainSize, [&](size_t begin, size_t end) {
+                    RenderingContext ctx;
+                    Sampler sampler{MixSeed(seed, PassStream(iteration, 1), begin)};
+                    for (auto i = begin; i < end; ++i)
+                    {
+                        TracePhoton(ctx, sampler, scene, grid, pixels, row_lobes, width,
+                                    max_bounce_, camera.ShutterTime(sampler.Get1D()));
+                    }
+                });
+
+                ParallelFor(pixel_count, kPixelGrainSize, [&](size_t begin, size_t end) {
+                    for (auto i = begin; i < end; ++i)
+                    {
+                        UpdatePixel(pixels[i]);
+                    }
+                });
+            }
+
+            result.ssp = iteration + 1;
+            if (checkpoint_handler != nullptr)
+            {
+                resolve_canvas();
+                (*checkpoint_handler)(result.ssp * 100 / iteration_count, result);
+            }
+        }
+
+        resolve_canvas();
+        return result;
+    }
+} // namespace akane
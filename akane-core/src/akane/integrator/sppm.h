@@ -0,0 +1,41 @@
+#pragma once
+#include "akane/render.h"
+
+namespace akane
+{
+    /**
+     * Stochastic progressive photon mapping, which renders the whole image in iterations rather
+     * than computing radiance along single camera rays
+     *
+     * Every iteration follows a camera path for each pixel through specular bounces up to a
+     * visible point, then photons traced from lights placed in the scene are gathered at visible
+     * points within the radius of their pixels, which shrinks as photons accumulate. Caustics
+     * seen directly or through glass converge this way, which path tracing hardly samples.
+     *
+     * The global light only contributes direct lighting at visible points, as photons are never
+     * emitted from it, and participating media are ignored.
+     */
+    class SppmIntegrator
+    {
+    public:
+        SppmIntegrator(int photon_per_iteration, float initial_radius, int max_bounce = 6)
+            : photon_per_iteration_(photon_per_iteration), initial_radius_(initial_radius),
+              max_bounce_(max_bounce)
+        {
+            AKANE_REQUIRE(photon_per_iteration > 0 && initial_radius > 0 && max_bounce > 0);
+        }
+
+        // render with photon and camera passes spread over every worker thread, where the
+        // result counts iterations as samples per pixel
+        RenderResult Execute(const Scene& scene, const Camera& camera, Point2i resolution,
+                             int iteration_count, unsigned seed,
+                             std::function<bool()>* activity_query = nullptr,
+                             std::function<void(int, const RenderResult&)>* checkpoint_handler =
+                                 nullptr) const;
+
+    private:
+        int photon_per_iteration_;
+        float initial_radius_;
+        int max_bounce_;
+    };
+} // namespace akane
@@ -1,20 +1,21 @@
 #include "akane/light.h"
+#include "akane/medium.h"
 #include "akane/primitive.h"
 #include "akane/scene.h"
 
 namespace akane
 {
     bool LightSample::TestVisibility(const Scene& scene, Workspace& workspace, const Vec3& p,
-                                     const Primitive* obj) const
+                                     const Primitive* obj, float time) const
     {
         if (global_)
         {
             IntersectionInfo isect;
-            return !scene.Intersect(GenerateShadowRay(p), workspace, isect);
+            return !scene.Intersect(GenerateShadowRay(p, time), workspace, isect);
         }
         else
         {
-            auto test_ray = GenerateTestRay(p);
+            auto test_ray = GenerateTestRay(p, time);
             if (normal_ != Vec3{0.f} && Dot(normal_, test_ray.d) < 0)
             {
                 // from back side of the light source
@@ -31,4 +32,65 @@ namespace akane
             return SamePrimitive(obj, isect.object) && (isect.point - p).LengthSq() < 0.001f;
         }
     }
+
+    Spectrum LightSample::EvalTransmittance(const Scene& scene, Workspace& workspace,
+                                            Sampler& sampler, const Vec3& p, const Medium* medium,
+                                            float time) const
+    {
+        // guards against rays trapped by degenerate boundaries
+        constexpr int kMaxBoundaryCrossings = 32;
+
+        if (!global_ && normal_ != Vec3{0.f} && Dot(normal_, p - point_) < 0)
+        {
+            // from back side of the light source
+            return kBlackSpectrum;
+        }
+
+        // rays toward global light are as long as escaping ones, so that both agree on
+        // transmittance of an unbounded medium
+        auto ray       = GenerateShadowRay(p, time);
+        auto remaining = global_ ? kTravelDistanceMax : (point_ - p).Length();
+        ray.medium     = medium;
+
+        Spectrum result = kWhiteSpectrum;
+        for (int i = 0; i < kMaxBoundaryCrossings; ++i)
+        {
+            IntersectionInfo isect;
+            auto hit = scene.Intersect(ray, workspace, isect);
+
+            // the light source itself is hit within the same tolerance as TestVisibility
+            auto tolerance = max(0.03f, 1e-3f * remaining);
+            if (global_ ? !hit : (hit && isect.t >= remaining - tolerance))
+            {
+                if (ray.medium != nullptr)
+                {
+                    result *= ray.medium->Transmittance(ray, remaining, sampler);
+                }
+
+                return result;
+            }
+
+            if (!hit || isect.material != nullptr || isect.medium_interface == nullptr)
+            {
+                return kBlackSpectrum;
+            }
+
+            if (ray.medium != nullptr)
+            {
+                result *= ray.medium->Transmittance(ray, isect.t, sampler);
+                if (result.Max() == 0)
+                {
+                    return kBlackSpectrum;
+                }
+            }
+
+            auto next_medium = NextMedium(isect, ray.d, ray.medium);
+
+            remaining -= isect.t;
+            ray        = Ray{isect.point, ray.d, time};
+            ray.medium = next_medium;
+        }
+
+        return kBlackSpectrum;
+    }
 } // namespace akane
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include "akane/light.h"
+#include "akane/bsdf/bsdf_geometry.h"
+#include "akane/math/sampling.h"
 
 namespace akane
 {
@@ -31,6 +33,32 @@ namespace akane
             return radiance_.Length() * kPi * GetObject()->Area();
         }
 
+        // emits to the side the sampled normal faces, with cosine-weighted directions
+        Spectrum SampleLe(const Point2f& u_pos, const Point2f& u_dir, Ray& ray_out,
+                          Vec3& normal_out, float& pdf_pos_out, float& pdf_dir_out) const override
+        {
+            Vec3 point;
+            GetObject()->SamplePoint(u_pos, point, normal_out, pdf_pos_out);
+
+            auto local = SampleCosineWeightedHemisphere(u_dir);
+            ray_out    = Ray{point, CreateBsdfCoordTransform(normal_out).InverseLinear(local)};
+
+            pdf_dir_out = PdfCosineWeightedHemisphere(local.Z());
+            return radiance_;
+        }
+
+        Spectrum Le(const Vec3& p, const Vec3& n, const Vec3& d) const override
+        {
+            return Dot(n, d) > 0 ? radiance_ : kBlackSpectrum;
+        }
+
+        void PdfLe(const Vec3& p, const Vec3& n, const Vec3& d, float& pdf_pos_out,
+                   float& pdf_dir_out) const override
+        {
+            pdf_pos_out = 1.f / GetObject()->Area();
+            pdf_dir_out = PdfCosineWeightedHemisphere(max(0.f, Dot(n, d)));
+        }
+
     private:
         Vec3 radiance_;
     };
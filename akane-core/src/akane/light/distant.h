@@ -32,9 +32,12 @@ namespace akane
                 delta_center = -delta_center;
             }
 
-            auto pdf = PdfUniformHemisphere() / (world_radius_ * world_radius_);
+            return LightSample{p_border, delta_center.Normalized(), PdfUniformHemisphere(), true};
+        }
 
-            return LightSample{p_border, delta_center.Normalized(), pdf, true};
+        float PdfLi(const Vec3& wi) const override
+        {
+            return Dot(direction_, wi) < 0 ? PdfUniformHemisphere() : 0.f;
         }
 
         float Power() const override
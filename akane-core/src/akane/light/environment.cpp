@@ -0,0 +1,99 @@
+#include "akane/light/environment.h"
+#include "akane/common/image.h"
+
+using namespace std;
+
+namespace akane
+{
+    namespace
+    {
+        // uv of the image for a normalized direction
+        Point2f DirectionToUV(const Vec3& d) noexcept
+        {
+            auto phi   = atan2(d.Y(), d.X());
+            auto theta = acos(clamp(d.Z(), -1.f, 1.f));
+
+            auto u = phi * kInvTwoPi;
+            return Point2f{u < 0 ? u + 1.f : u, theta * kInvPi};
+        }
+
+        Vec3 UVToDirection(const Point2f& uv, float& sin_theta_out) noexcept
+        {
+            auto phi   = uv[0] * kTwoPi;
+            auto theta = uv[1] * kPi;
+
+            sin_theta_out = sin(theta);
+            return Vec3{sin_theta_out * cos(phi), sin_theta_out * sin(phi), cos(theta)};
+        }
+
+        // uv covers 2pi * pi, and a point at polar angle theta is stretched by 1 / sin(theta)
+        float UVPdfToSolidAngle(float pdf, float sin_theta) noexcept
+        {
+            return sin_theta > 0 ? pdf / (2.f * kPi * kPi * sin_theta) : 0.f;
+        }
+    } // namespace
+
+    EnvironmentLight::EnvironmentLight(const string& filename, float scale, Vec3 world_center,
+                                       float world_radius)
+        : world_center_(world_center), world_radius_(world_radius)
+    {
+        auto data = LoadImageFloat(filename.c_str(), width_, height_);
+        if (data == nullptr)
+        {
+            Throw("failed to load environment map {}", filename);
+        }
+
+        radiance_.resize(static_cast<size_t>(width_) * height_);
+        for (size_t i = 0; i < radiance_.size(); ++i)
+        {
+            radiance_[i] = scale * Spectrum{data[3 * i], data[3 * i + 1], data[3 * i + 2]};
+        }
+
+        // texels near the poles cover less solid angle
+        vector<float> weights(radiance_.size());
+        Spectrum total    = 0.f;
+        float total_solid = 0.f;
+        for (int y = 0; y < height_; ++y)
+        {
+            auto sin_theta = sin((y + .5f) / height_ * kPi);
+            for (int x = 0; x < width_; ++x)
+            {
+                const auto& radiance = radiance_[static_cast<size_t>(y) * width_ + x];
+
+                weights[static_cast<size_t>(y) * width_ + x] = radiance.Length() * sin_theta;
+
+                total += radiance * sin_theta;
+                total_solid += sin_theta;
+            }
+        }
+
+        distribution_.Reset(weights.data(), width_, height_);
+        average_ = total / total_solid;
+    }
+
+    Spectrum EnvironmentLight::Eval(const Ray& ray) const
+    {
+        return Lookup(DirectionToUV(ray.d.Normalized()));
+    }
+
+    LightSample EnvironmentLight::SampleLi(const Point2f& u) const
+    {
+        float pdf_uv;
+        auto uv = distribution_.Sample(u, pdf_uv);
+
+        float sin_theta;
+        auto d = UVToDirection(uv, sin_theta);
+
+        return LightSample{world_center_ + world_radius_ * d, {},
+                           UVPdfToSolidAngle(pdf_uv, sin_theta), true};
+    }
+
+    float EnvironmentLight::PdfLi(const Vec3& wi) const
+    {
+        auto uv = DirectionToUV(wi.Normalized());
+
+        // NOTE computed in the same way as sampling
+        auto sin_theta = sin(uv[1] * kPi);
+        return UVPdfToSolidAngle(distribution_.Pdf(uv), sin_theta);
+    }
+} // namespace akane
@@ -0,0 +1,54 @@
+#pragma once
+#include "akane/light.h"
+#include "akane/math/distribution.h"
+#include <string>
+#include <vector>
+
+namespace akane
+{
+    /**
+     * Global light from a lat-long (equirectangular) HDR image surrounding the world
+     *
+     * The top row of the image is toward +z, and the left column toward +x with azimuth growing
+     * to the right. Directions are sampled in proportion to radiance of texels weighted by the
+     * solid angle they cover, so that bright regions like the sun are found with few samples.
+     */
+    class EnvironmentLight : public Light
+    {
+    public:
+        EnvironmentLight(const std::string& filename, float scale, Vec3 world_center,
+                         float world_radius);
+
+        Spectrum Eval(const Ray& ray) const override;
+
+        LightSample SampleLi(const Point2f& u) const override;
+
+        float PdfLi(const Vec3& wi) const override;
+
+        float Power() const override
+        {
+            return average_.Length() * kPi * world_radius_ * world_radius_;
+        }
+
+    private:
+        const Spectrum& Lookup(const Point2f& uv) const noexcept
+        {
+            auto x = min(static_cast<int>(uv[0] * width_), width_ - 1);
+            auto y = min(static_cast<int>(uv[1] * height_), height_ - 1);
+            return radiance_[static_cast<size_t>(y) * width_ + x];
+        }
+
+        int width_;
+        int height_;
+        std::vector<Spectrum> radiance_;
+
+        // over uv of the image, whose density is converted into solid angle by the mapping
+        Distribution2D distribution_;
+
+        // radiance averaged over the sphere of directions
+        Spectrum average_;
+
+        Vec3 world_center_;
+        float world_radius_;
+    };
+} // namespace akane
@@ -1,5 +1,6 @@
 #pragma once
 #include "akane/light.h"
+#include "akane/math/sampling.h"
 
 namespace akane
 {
@@ -27,6 +28,33 @@ namespace akane
             return radiance_.Length() * kAreaUnitSphere;
         }
 
+        Spectrum SampleLe(const Point2f& u_pos, const Point2f& u_dir, Ray& ray_out,
+                          Vec3& normal_out, float& pdf_pos_out, float& pdf_dir_out) const override
+        {
+            ray_out     = Ray{point_, SampleUniformSphere(u_dir)};
+            normal_out  = Vec3{0.f};
+            pdf_pos_out = 1.f;
+            pdf_dir_out = PdfUniformSphere();
+            return radiance_;
+        }
+
+        Spectrum Le(const Vec3& p, const Vec3& n, const Vec3& d) const override
+        {
+            return radiance_;
+        }
+
+        void PdfLe(const Vec3& p, const Vec3& n, const Vec3& d, float& pdf_pos_out,
+                   float& pdf_dir_out) const override
+        {
+            pdf_pos_out = 0.f;
+            pdf_dir_out = PdfUniformSphere();
+        }
+
+        bool IsDeltaPosition() const override
+        {
+            return true;
+        }
+
     private:
         Vec3 point_;
         Spectrum radiance_; // spectrum at unit sphere around the point
@@ -4,7 +4,7 @@
 
 namespace akane
 {
-    // global distant light that casting toward one direction
+    // global light with radiance blended from white at bottom to albedo at top
     class SkyboxLight : public Light
     {
     public:
@@ -22,14 +22,19 @@ namespace akane
         LightSample SampleLi(const Point2f& u) const override
         {
             auto p   = world_center_ + world_radius_ * SampleUniformSphere(u);
-            auto pdf = PdfUniformSphere() / (world_radius_ * world_radius_);
+            return LightSample{p, {}, PdfUniformSphere(), true};
+        }
 
-            return LightSample{p, {}, pdf, true};
+        float PdfLi(const Vec3& wi) const override
+        {
+            return PdfUniformSphere();
         }
 
         float Power() const override
         {
-            AKANE_NO_IMPL();
+            // radiance is linear in z, which is uniformly distributed over the sphere
+            auto average = .5f * (Spectrum{1.f} + albedo_);
+            return average.Length() * kPi * world_radius_ * world_radius_;
         }
 
     private:
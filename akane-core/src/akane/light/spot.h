@@ -1,5 +1,6 @@
 #pragma once
 #include "akane/light.h"
+#include "akane/bsdf/bsdf_geometry.h"
 
 namespace akane
 {
@@ -32,6 +33,39 @@ namespace akane
             return radiance_.Length() * AreaUnitCone(cos_theta_);
         }
 
+        // directions are uniform in the cone
+        Spectrum SampleLe(const Point2f& u_pos, const Point2f& u_dir, Ray& ray_out,
+                          Vec3& normal_out, float& pdf_pos_out, float& pdf_dir_out) const override
+        {
+            auto cos_theta = 1.f - u_dir[0] * (1.f - cos_theta_);
+            auto sin_theta = sqrt(max(0.f, 1.f - cos_theta * cos_theta));
+            auto phi       = kTwoPi * u_dir[1];
+            auto local     = Vec3{sin_theta * cos(phi), sin_theta * sin(phi), cos_theta};
+
+            ray_out     = Ray{point_, CreateBsdfCoordTransform(direction_).InverseLinear(local)};
+            normal_out  = Vec3{0.f};
+            pdf_pos_out = 1.f;
+            pdf_dir_out = 1.f / AreaUnitCone(cos_theta_);
+            return radiance_;
+        }
+
+        Spectrum Le(const Vec3& p, const Vec3& n, const Vec3& d) const override
+        {
+            return Dot(d, direction_) < cos_theta_ ? kBlackSpectrum : radiance_;
+        }
+
+        void PdfLe(const Vec3& p, const Vec3& n, const Vec3& d, float& pdf_pos_out,
+                   float& pdf_dir_out) const override
+        {
+            pdf_pos_out = 0.f;
+            pdf_dir_out = Dot(d, direction_) < cos_theta_ ? 0.f : 1.f / AreaUnitCone(cos_theta_);
+        }
+
+        bool IsDeltaPosition() const override
+        {
+            return true;
+        }
+
     private:
         Vec3 point_;
         Vec3 direction_;
@@ -1,76 +1,86 @@
 #include "akane/material/generic.h"
-#include "akane/bsdf/lambertian.h"
-#include "akane/bsdf/specular.h"
-#include "akane/bsdf/microfacet.h"
-#include "akane/bsdf/hybrid.h"
 
 namespace akane
 {
-    const Bsdf* GenericMaterial::ComputeBsdf(Workspace& workspace,
-                                             const IntersectionInfo& isect) const
+    void GenericMaterial::Compile()
     {
-        auto u = isect.uv.X();
-        auto v = isect.uv.Y();
+        compiled_bsdf_       = Bsdf{};
+        diffuse_lobe_index_  = -1;
+        specular_lobe_index_ = -1;
 
-        Bsdf* bsdf         = nullptr;
-        HybridBsdf* hybrid = nullptr;
+        // alpha is stretched along u and shrunk along v by anisotropy, keeping their product
+        auto aspect     = sqrt(sqrt(1.f - .9f * anisotropy_));
+        auto fresnel    = Fresnel{eta_out_, eta_in_, abbe_};
+        auto microfacet = MicrofacetDistribution{roughness_ / aspect, roughness_ * aspect};
+        auto is_smooth  = roughness_ < 0.01f;
 
-        auto register_bsdf = [&](Bsdf* ff) {
-            if (hybrid != nullptr)
-            {
-                hybrid->Add(ff);
-            }
-            else if (bsdf != nullptr)
+        if (tr_.Min() > 1e-5)
+        {
+            if (is_smooth)
             {
-                hybrid = workspace.Construct<HybridBsdf>();
-                hybrid->Add(bsdf);
-                hybrid->Add(ff);
+                compiled_bsdf_.Add(SpecularTransmission{tr_, eta_in_, eta_out_, abbe_});
             }
             else
             {
-                bsdf = ff;
+                // SpecularTransmission reflects by itself, while here it's a separate lobe
+                compiled_bsdf_.Add(
+                    MicrofacetTransmission{tr_, eta_in_, eta_out_, microfacet, abbe_});
+                compiled_bsdf_.Add(MicrofacetReflection{tr_, fresnel, microfacet});
             }
-        };
-
-        if (tr_.Min() > 1e-5)
-        {
-            register_bsdf(workspace.Construct<SpecularTransmission>(tr_, eta_in_, eta_out_));
         }
 
         if (ks_.Max() > 1e-5)
         {
-            auto albedo = ks_ * EvalTexture(texture_specular_.get(), u, v);
-            if (roughness_ < 0.01f)
+            if (texture_specular_ != nullptr)
+            {
+                specular_lobe_index_ = compiled_bsdf_.LobeCount();
+            }
+
+            if (is_smooth)
             {
-                register_bsdf(workspace.Construct<SpecularReflection>(albedo));
+                compiled_bsdf_.Add(SpecularReflection{ks_});
             }
             else
             {
-                auto fresnel    = workspace.Construct<Fresnel>(eta_out_, eta_in_);
-                auto microfacet = workspace.Construct<MicrofacetDistribution>(roughness_);
-
-                register_bsdf(
-                    workspace.Construct<MicrofacetReflection>(albedo, fresnel, microfacet));
+                compiled_bsdf_.Add(MicrofacetReflection{ks_, fresnel, microfacet});
             }
         }
 
         if (kd_.Max() > 1e-5)
         {
-            auto albedo = kd_ * EvalTexture(texture_diffuse_.get(), u, v);
-            register_bsdf(workspace.Construct<LambertianReflection>(albedo));
+            if (texture_diffuse_ != nullptr)
+            {
+                diffuse_lobe_index_ = compiled_bsdf_.LobeCount();
+            }
+
+            compiled_bsdf_.Add(LambertianReflection{kd_});
         }
 
-        if (hybrid != nullptr)
+        compiled_ = true;
+    }
+
+    bool GenericMaterial::ComputeBsdf(const IntersectionInfo& isect, Bsdf& bsdf_out) const
+    {
+        AKANE_ASSERT(compiled_);
+
+        if (compiled_bsdf_.Empty())
         {
-            return hybrid;
+            return false;
         }
-        else if (bsdf != nullptr)
+
+        // only textured albedos vary between hits
+        bsdf_out = compiled_bsdf_;
+        if (specular_lobe_index_ >= 0)
         {
-            return bsdf;
+            bsdf_out.SetLobeAlbedo(specular_lobe_index_,
+                                   ks_ * EvalTexture(texture_specular_.get(), isect));
         }
-        else
+        if (diffuse_lobe_index_ >= 0)
         {
-            return nullptr;
+            bsdf_out.SetLobeAlbedo(diffuse_lobe_index_,
+                                   kd_ * EvalTexture(texture_diffuse_.get(), isect));
         }
+
+        return true;
     }
-} // namespace akane
\ No newline at end of file
+} // namespace akane
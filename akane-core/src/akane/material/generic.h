@@ -1,5 +1,6 @@
 #pragma once
 #include "akane/material.h"
+#include "akane/bsdf.h"
 #include "akane/texture.h"
 #include <string>
 #include <functional>
@@ -13,14 +14,19 @@ namespace akane
         {
         }
 
-        const Bsdf* ComputeBsdf(Workspace& workspace, const IntersectionInfo& isect) const override;
+        // lobes are chosen and their constant parameters are baked here, so that per hit only
+        // textured albedos are filled in
+        void Compile() override;
+
+        bool ComputeBsdf(const IntersectionInfo& isect, Bsdf& bsdf_out) const override;
 
     public:
-        Spectrum EvalTexture(const Texture3D* tex, float u, float v) const
+        Spectrum EvalTexture(const Texture3D* tex, const IntersectionInfo& isect) const
         {
             if (tex != nullptr)
             {
-                return tex->Eval(u, v);
+                auto footprint = TextureFootprint{isect.duvdx, isect.duvdy};
+                return tex->EvalFiltered(isect.uv[0], isect.uv[1], footprint);
             }
             else
             {
@@ -34,11 +40,19 @@ namespace akane
         Spectrum ks_;
         Spectrum tr_;
 
-        float roughness_ = .3f;
-        float eta_in_    = 1.f;
-        float eta_out_   = 1.f;
+        float roughness_  = .3f;
+        float anisotropy_ = 0.f;
+        float eta_in_     = 1.f;
+        float eta_out_    = 1.f;
+        float abbe_       = 0.f; // Abbe number of the inside, zero if eta doesn't vary
 
         shared_ptr<Texture3D> texture_diffuse_  = nullptr;
         shared_ptr<Texture3D> texture_specular_ = nullptr;
+
+    private:
+        bool compiled_           = false;
+        Bsdf compiled_bsdf_      = {};
+        int diffuse_lobe_index_  = -1; // lobe scaled by the diffuse texture, -1 if none
+        int specular_lobe_index_ = -1; // lobe scaled by the specular texture, -1 if none
     };
 } // namespace akane
\ No newline at end of file
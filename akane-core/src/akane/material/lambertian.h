@@ -1,7 +1,6 @@
 #pragma once
 #include "akane/material.h"
 #include "akane/bsdf.h"
-#include "akane/bsdf/lambertian.h"
 
 namespace akane
 {
@@ -12,10 +11,10 @@ namespace akane
         {
         }
 
-        const Bsdf* ComputeBsdf(Workspace& workspace,
-                                const IntersectionInfo& isect) const override
+        bool ComputeBsdf(const IntersectionInfo& isect, Bsdf& bsdf_out) const override
         {
-            return workspace.Construct<LambertianReflection>(albedo_);
+            bsdf_out.Add(LambertianReflection{albedo_});
+            return true;
         }
 
     private:
@@ -1,7 +1,7 @@
 #pragma once
 #include "akane/material.h"
 #include "akane/texture.h"
-#include "edslib/memory/arena.h"
+#include "akane/bsdf.h"
 #include <string>
 #include <functional>
 
@@ -11,20 +11,21 @@ namespace akane
     {
     public:
         TestMaterial(shared_ptr<Texture3D> texture,
-                     std::function<Bsdf*(Workspace&, Spectrum)> factory)
+                     std::function<BsdfLobe(Spectrum)> factory)
             : texture_(std::move(texture)), factory_(factory)
         {
             AKANE_ASSERT(texture_ != nullptr);
         }
 
-        const Bsdf* ComputeBsdf(Workspace& workspace,
-                                const IntersectionInfo& isect) const override
+        bool ComputeBsdf(const IntersectionInfo& isect, Bsdf& bsdf_out) const override
         {
-            return factory_(workspace, texture_->Eval(isect.uv[0], isect.uv[1]));
+            auto footprint = TextureFootprint{isect.duvdx, isect.duvdy};
+            bsdf_out.Add(factory_(texture_->EvalFiltered(isect.uv[0], isect.uv[1], footprint)));
+            return true;
         }
 
     private:
-        std::function<Bsdf*(Workspace&, Spectrum)> factory_;
+        std::function<BsdfLobe(Spectrum)> factory_;
         shared_ptr<Texture3D> texture_;
     };
 } // namespace akane
\ No newline at end of file
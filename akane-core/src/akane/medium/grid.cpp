@@ -0,0 +1,232 @@
+#include "akane/medium/grid.h"
+#include "akane/common/mapped_file.h"
+#include <cstring>
+
+using namespace std;
+
+namespace akane
+{
+    namespace
+    {
+        // clamp the inclusive range into the grid, returns false if nothing is left
+        bool ClampVoxelRange(Point3i resolution, Point3i& lower, Point3i& upper) noexcept
+        {
+            for (int a = 0; a < 3; ++a)
+            {
+                lower[a] = max(lower[a], 0);
+                upper[a] = min(upper[a], resolution[a] - 1);
+                if (lower[a] > upper[a])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        struct VolumeFileContent
+        {
+            Point3i resolution;
+            Bounds3 bound;
+            vector<float> density;
+        };
+
+        // see "gridvolume" of Mitsuba for the layout
+        VolumeFileContent LoadVolumeFile(const string& filename)
+        {
+            auto file = MappedFile::Open(filename);
+            if (file == nullptr)
+            {
+                Throw("failed to open volume file {}", filename);
+            }
+
+            constexpr size_t kHeaderSize = 48;
+
+            auto data = file->Data();
+            if (file->Size() < kHeaderSize || memcmp(data, "VOL", 3) != 0 || data[3] != 3)
+            {
+                Throw("unrecognized volume file {}", filename);
+            }
+
+            auto read_int = [&](size_t offset) {
+                int32_t value;
+                memcpy(&value, data + offset, sizeof(value));
+                return value;
+            };
+            auto read_float = [&](size_t offset) {
+                float value;
+                memcpy(&value, data + offset, sizeof(value));
+                return value;
+            };
+
+            if (read_int(4) != 1)
+            {
+                Throw("volume file {} is not of float32 data", filename);
+            }
+
+            VolumeFileContent result;
+            result.resolution = Point3i{read_int(8), read_int(12), read_int(16)};
+            result.bound      = Bounds3{Vec3{read_float(24), read_float(28), read_float(32)},
+                                   Vec3{read_float(36), read_float(40), read_float(44)}};
+
+            auto channels    = read_int(20);
+            auto voxel_count = static_cast<size_t>(result.resolution[0]) * result.resolution[1] *
+                               result.resolution[2];
+            if (channels <= 0 || voxel_count == 0 ||
+                file->Size() < kHeaderSize + voxel_count * channels * sizeof(float))
+            {
+                Throw("volume file {} is truncated", filename);
+            }
+
+            result.density.resize(voxel_count);
+            for (size_t i = 0; i < voxel_count; ++i)
+            {
+                auto offset       = kHeaderSize + i * channels * sizeof(float);
+                result.density[i] = max(read_float(offset), 0.f);
+            }
+
+            return result;
+        }
+    } // namespace
+
+    float DenseDensityGrid::MaxVoxel(Point3i lower, Point3i upper) const noexcept
+    {
+        if (!ClampVoxelRange(resolution_, lower, upper))
+        {
+            return 0.f;
+        }
+
+        float result = 0.f;
+        for (int z = lower[2]; z <= upper[2]; ++z)
+        {
+            for (int y = lower[1]; y <= upper[1]; ++y)
+            {
+                for (int x = lower[0]; x <= upper[0]; ++x)
+                {
+                    result = max(result, Voxel(x, y, z));
+                }
+            }
+        }
+
+        return result;
+    }
+
+    SparseDensityGrid::SparseDensityGrid(Point3i resolution, const float* data)
+        : resolution_(resolution)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            brick_count_[a] = (resolution[a] + kBrickSize - 1) / kBrickSize;
+        }
+
+        brick_index_.resize(static_cast<size_t>(brick_count_[0]) * brick_count_[1] *
+                                brick_count_[2],
+                            -1);
+
+        float brick[kBrickVoxelCount];
+        for (int bz = 0; bz < brick_count_[2]; ++bz)
+        {
+            for (int by = 0; by < brick_count_[1]; ++by)
+            {
+                for (int bx = 0; bx < brick_count_[0]; ++bx)
+                {
+                    // gather the brick, padded with zero out of the grid
+                    bool empty = true;
+                    for (int z = 0; z < kBrickSize; ++z)
+                    {
+                        for (int y = 0; y < kBrickSize; ++y)
+                        {
+                            for (int x = 0; x < kBrickSize; ++x)
+                            {
+                                auto gx = bx * kBrickSize + x;
+                                auto gy = by * kBrickSize + y;
+                                auto gz = bz * kBrickSize + z;
+
+                                float value = 0.f;
+                                if (gx < resolution[0] && gy < resolution[1] && gz < resolution[2])
+                                {
+                                    value = data[(static_cast<size_t>(gz) * resolution[1] + gy) *
+                                                     resolution[0] +
+                                                 gx];
+                                }
+
+                                brick[(z * kBrickSize + y) * kBrickSize + x] = value;
+                                empty                                      = empty && value == 0;
+                            }
+                        }
+                    }
+
+                    if (!empty)
+                    {
+                        brick_index_[BrickOffset(bx, by, bz)] =
+                            static_cast<int32_t>(bricks_.size() / kBrickVoxelCount);
+                        bricks_.insert(bricks_.end(), brick, brick + kBrickVoxelCount);
+                    }
+                }
+            }
+        }
+    }
+
+    float SparseDensityGrid::MaxVoxel(Point3i lower, Point3i upper) const noexcept
+    {
+        if (!ClampVoxelRange(resolution_, lower, upper))
+        {
+            return 0.f;
+        }
+
+        float result = 0.f;
+        for (int bz = lower[2] / kBrickSize; bz <= upper[2] / kBrickSize; ++bz)
+        {
+            for (int by = lower[1] / kBrickSize; by <= upper[1] / kBrickSize; ++by)
+            {
+                for (int bx = lower[0] / kBrickSize; bx <= upper[0] / kBrickSize; ++bx)
+                {
+                    if (brick_index_[BrickOffset(bx, by, bz)] < 0)
+                    {
+                        continue;
+                    }
+
+                    // voxels of the range in this brick
+                    auto z0 = max(lower[2], bz * kBrickSize);
+                    auto z1 = min(upper[2], bz * kBrickSize + kBrickSize - 1);
+                    auto y0 = max(lower[1], by * kBrickSize);
+                    auto y1 = min(upper[1], by * kBrickSize + kBrickSize - 1);
+                    auto x0 = max(lower[0], bx * kBrickSize);
+                    auto x1 = min(upper[0], bx * kBrickSize + kBrickSize - 1);
+                    for (int z = z0; z <= z1; ++z)
+                    {
+                        for (int y = y0; y <= y1; ++y)
+                        {
+                            for (int x = x0; x <= x1; ++x)
+                            {
+                                result = max(result, Voxel(x, y, z));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    shared_ptr<Medium> CreateGridMedium(const string& filename, float sigma_t,
+                                        const Spectrum& albedo, float g)
+    {
+        auto content = LoadVolumeFile(filename);
+
+        // bricks cost extra indirection per lookup, which only pays off if most are empty
+        auto sparse_grid = SparseDensityGrid{content.resolution, content.density.data()};
+        if (sparse_grid.Occupancy() < .5f)
+        {
+            return make_shared<GridMedium<SparseDensityGrid>>(std::move(sparse_grid),
+                                                              content.bound, sigma_t, albedo, g);
+        }
+        else
+        {
+            auto dense_grid = DenseDensityGrid{content.resolution, std::move(content.density)};
+            return make_shared<GridMedium<DenseDensityGrid>>(std::move(dense_grid), content.bound,
+                                                             sigma_t, albedo, g);
+        }
+    }
+} // namespace akane
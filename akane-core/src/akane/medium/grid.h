@@ -0,0 +1,368 @@
+#pragma once
+#include "akane/medium.h"
+#include "akane/math/bounds.h"
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace akane
+{
+    // density voxels stored in a dense array, where x varies fastest
+    class DenseDensityGrid
+    {
+    public:
+        DenseDensityGrid(Point3i resolution, std::vector<float> data)
+            : resolution_(resolution), data_(std::move(data))
+        {
+            AKANE_REQUIRE(data_.size() ==
+                          static_cast<size_t>(resolution[0]) * resolution[1] * resolution[2]);
+        }
+
+        Point3i Resolution() const noexcept
+        {
+            return resolution_;
+        }
+
+        // voxels out of the grid are empty
+        float Voxel(int x, int y, int z) const noexcept
+        {
+            if (x < 0 || y < 0 || z < 0 || x >= resolution_[0] || y >= resolution_[1] ||
+                z >= resolution_[2])
+            {
+                return 0.f;
+            }
+
+            return data_[(static_cast<size_t>(z) * resolution_[1] + y) * resolution_[0] + x];
+        }
+
+        // maximum of voxels in the inclusive range
+        float MaxVoxel(Point3i lower, Point3i upper) const noexcept;
+
+    private:
+        Point3i resolution_;
+        std::vector<float> data_;
+    };
+
+    // density voxels grouped into bricks of 8^3, where bricks without any density aren't stored
+    class SparseDensityGrid
+    {
+    public:
+        static constexpr int kBrickSize = 8;
+
+        // data is a dense array where x varies fastest
+        SparseDensityGrid(Point3i resolution, const float* data);
+
+        Point3i Resolution() const noexcept
+        {
+            return resolution_;
+        }
+
+        // fraction of bricks that are stored
+        float Occupancy() const noexcept
+        {
+            return brick_index_.empty()
+                       ? 0.f
+                       : static_cast<float>(bricks_.size() / kBrickVoxelCount) /
+                             brick_index_.size();
+        }
+
+        float Voxel(int x, int y, int z) const noexcept
+        {
+            if (x < 0 || y < 0 || z < 0 || x >= resolution_[0] || y >= resolution_[1] ||
+                z >= resolution_[2])
+            {
+                return 0.f;
+            }
+
+            auto brick = brick_index_[BrickOffset(x / kBrickSize, y / kBrickSize, z / kBrickSize)];
+            if (brick < 0)
+            {
+                return 0.f;
+            }
+
+            auto offset =
+                ((z % kBrickSize) * kBrickSize + y % kBrickSize) * kBrickSize + x % kBrickSize;
+            return bricks_[static_cast<size_t>(brick) * kBrickVoxelCount + offset];
+        }
+
+        // maximum of voxels in the inclusive range, where empty bricks are skipped
+        float MaxVoxel(Point3i lower, Point3i upper) const noexcept;
+
+    private:
+        static constexpr int kBrickVoxelCount = kBrickSize * kBrickSize * kBrickSize;
+
+        size_t BrickOffset(int bx, int by, int bz) const noexcept
+        {
+            return (static_cast<size_t>(bz) * brick_count_[1] + by) * brick_count_[0] + bx;
+        }
+
+        Point3i resolution_;
+        Point3i brick_count_;
+
+        std::vector<int32_t> brick_index_; // -1 for an empty brick
+        std::vector<float> bricks_;
+    };
+
+    /**
+     * Coarse grid over the unit cube storing maximum density of each cell
+     *
+     * Free flight distances are sampled against the majorant of the cell a ray is travelling
+     * through rather than a global one, so that sparse regions are crossed in a few steps and
+     * empty cells are skipped entirely.
+     */
+    class MajorantGrid
+    {
+    public:
+        static constexpr int kResolution = 16;
+
+        MajorantGrid() = default;
+
+        template <typename Grid> explicit MajorantGrid(const Grid& grid)
+        {
+            auto res = grid.Resolution();
+            for (int z = 0; z < kResolution; ++z)
+            {
+                for (int y = 0; y < kResolution; ++y)
+                {
+                    for (int x = 0; x < kResolution; ++x)
+                    {
+                        // voxels touched by trilinear lookups of points in the cell
+                        Point3i lower, upper;
+                        for (int a = 0; a < 3; ++a)
+                        {
+                            auto c     = a == 0 ? x : (a == 1 ? y : z);
+                            auto scale = static_cast<float>(res[a]) / kResolution;
+                            lower[a]   = static_cast<int>(floor(c * scale - .5f));
+                            upper[a]   = static_cast<int>(floor((c + 1) * scale - .5f)) + 1;
+                        }
+
+                        majorants_[CellOffset(x, y, z)] = grid.MaxVoxel(lower, upper);
+                    }
+                }
+            }
+        }
+
+        // walk through cells that the ray o + t * d in (t_min, t_max) overlaps, where
+        // f(t0, t1, majorant) is called for each segment and returns false to stop
+        template <typename F>
+        void Traverse(const Vec3& o, const Vec3& d, float t_min, float t_max, F&& f) const
+        {
+            // clip with the unit cube
+            for (int a = 0; a < 3; ++a)
+            {
+                if (d[a] != 0)
+                {
+                    auto t0 = -o[a] / d[a];
+                    auto t1 = (1.f - o[a]) / d[a];
+                    if (t0 > t1)
+                    {
+                        std::swap(t0, t1);
+                    }
+
+                    t_min = max(t_min, t0);
+                    t_max = min(t_max, t1);
+                }
+                else if (o[a] < 0 || o[a] > 1)
+                {
+                    return;
+                }
+            }
+
+            if (!(t_min < t_max))
+            {
+                return;
+            }
+
+            // 3D-DDA
+            auto p = o + t_min * d;
+
+            Point3i cell, step;
+            float next_t[3], delta_t[3];
+            for (int a = 0; a < 3; ++a)
+            {
+                cell[a] = clamp(static_cast<int>(p[a] * kResolution), 0, kResolution - 1);
+                if (d[a] > 0)
+                {
+                    step[a]    = 1;
+                    next_t[a]  = t_min + ((cell[a] + 1.f) / kResolution - p[a]) / d[a];
+                    delta_t[a] = 1.f / (kResolution * d[a]);
+                }
+                else if (d[a] < 0)
+                {
+                    step[a]    = -1;
+                    next_t[a]  = t_min + (static_cast<float>(cell[a]) / kResolution - p[a]) / d[a];
+                    delta_t[a] = -1.f / (kResolution * d[a]);
+                }
+                else
+                {
+                    step[a]    = 0;
+                    next_t[a]  = std::numeric_limits<float>::infinity();
+                    delta_t[a] = std::numeric_limits<float>::infinity();
+                }
+            }
+
+            auto t = t_min;
+            while (true)
+            {
+                auto axis = next_t[0] < next_t[1] ? (next_t[0] < next_t[2] ? 0 : 2)
+                                                  : (next_t[1] < next_t[2] ? 1 : 2);
+
+                auto t_exit = min(next_t[axis], t_max);
+                if (!f(t, t_exit, majorants_[CellOffset(cell[0], cell[1], cell[2])]) ||
+                    t_exit >= t_max)
+                {
+                    return;
+                }
+
+                t = t_exit;
+                cell[axis] += step[axis];
+                if (cell[axis] < 0 || cell[axis] >= kResolution)
+                {
+                    return;
+                }
+
+                next_t[axis] += delta_t[axis];
+            }
+        }
+
+    private:
+        static int CellOffset(int x, int y, int z) noexcept
+        {
+            return (z * kResolution + y) * kResolution + x;
+        }
+
+        float majorants_[kResolution * kResolution * kResolution] = {};
+    };
+
+    /**
+     * Heterogeneous medium with density voxels filling an axis-aligned box in world space
+     *
+     * Extinction is grey, i.e. sigma_t is density times a constant, so that free flights are
+     * sampled with delta tracking and transmittance is estimated with ratio tracking.
+     */
+    template <typename Grid> class GridMedium : public Medium
+    {
+    public:
+        GridMedium(Grid grid, const Bounds3& bound, float sigma_t, const Spectrum& albedo, float g)
+            : Medium(g), grid_(std::move(grid)), majorant_(grid_), bound_(bound),
+              sigma_t_(sigma_t), albedo_(albedo)
+        {
+        }
+
+        bool SampleInteraction(const Ray& ray, float t_max, Sampler& sampler, float& t_out,
+                               Spectrum& weight_out) const override
+        {
+            auto o = bound_.Offset(ray.o);
+            auto d = ray.d / bound_.Diagonal();
+
+            bool scattered = false;
+            majorant_.Traverse(o, d, 0.f, t_max, [&](float t0, float t1, float majorant) {
+                if (majorant <= 0)
+                {
+                    return true;
+                }
+
+                // tentative collisions against the majorant, each being real with probability
+                // density / majorant
+                auto sigma_maj = sigma_t_ * majorant;
+                for (auto t = t0;;)
+                {
+                    t -= std::log(1.f - sampler.Get1D()) / sigma_maj;
+                    if (t >= t1)
+                    {
+                        return true;
+                    }
+
+                    if (sampler.Get1D() * majorant < Density(o + t * d))
+                    {
+                        t_out     = t;
+                        scattered = true;
+                        return false;
+                    }
+                }
+            });
+
+            weight_out = scattered ? albedo_ : kWhiteSpectrum;
+            return scattered;
+        }
+
+        Spectrum Transmittance(const Ray& ray, float t_max, Sampler& sampler) const override
+        {
+            auto o = bound_.Offset(ray.o);
+            auto d = ray.d / bound_.Diagonal();
+
+            float tr = 1.f;
+            majorant_.Traverse(o, d, 0.f, t_max, [&](float t0, float t1, float majorant) {
+                if (majorant <= 0)
+                {
+                    return true;
+                }
+
+                auto sigma_maj = sigma_t_ * majorant;
+                for (auto t = t0;;)
+                {
+                    t -= std::log(1.f - sampler.Get1D()) / sigma_maj;
+                    if (t >= t1)
+                    {
+                        return true;
+                    }
+
+                    tr *= 1.f - Density(o + t * d) / majorant;
+
+                    // russian roulette once the estimate is low
+                    if (tr < .1f)
+                    {
+                        auto q = max(.05f, 1.f - tr);
+                        if (sampler.Get1D() < q)
+                        {
+                            tr = 0.f;
+                            return false;
+                        }
+
+                        tr /= 1.f - q;
+                    }
+                }
+            });
+
+            return Spectrum{tr};
+        }
+
+    private:
+        // trilinear interpolation of voxels, where p is in the unit cube
+        float Density(const Vec3& p) const noexcept
+        {
+            auto res = grid_.Resolution();
+
+            int i[3];
+            float f[3];
+            for (int a = 0; a < 3; ++a)
+            {
+                auto x = p[a] * res[a] - .5f;
+                i[a]   = static_cast<int>(floor(x));
+                f[a]   = x - i[a];
+            }
+
+            auto mix = [](float a, float b, float t) { return a + (b - a) * t; };
+            auto row = [&](int y, int z) {
+                return mix(grid_.Voxel(i[0], y, z), grid_.Voxel(i[0] + 1, y, z), f[0]);
+            };
+
+            auto d0 = mix(row(i[1], i[2]), row(i[1] + 1, i[2]), f[1]);
+            auto d1 = mix(row(i[1], i[2] + 1), row(i[1] + 1, i[2] + 1), f[1]);
+            return mix(d0, d1, f[2]);
+        }
+
+        Grid grid_;
+        MajorantGrid majorant_;
+
+        Bounds3 bound_;
+        float sigma_t_;
+        Spectrum albedo_;
+    };
+
+    // density grid from a Mitsuba volume file of float32 data, the first channel is used as
+    // density and the box in the file is placed in world space. The grid is stored sparsely if
+    // most of its bricks are empty
+    shared_ptr<Medium> CreateGridMedium(const std::string& filename, float sigma_t,
+                                        const Spectrum& albedo, float g);
+} // namespace akane
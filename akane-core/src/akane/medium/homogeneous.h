@@ -0,0 +1,56 @@
+#pragma once
+#include "akane/medium.h"
+#include <cmath>
+#include <limits>
+
+namespace akane
+{
+    // medium of constant coefficients, where free flight distances are sampled analytically
+    class HomogeneousMedium : public Medium
+    {
+    public:
+        HomogeneousMedium(const Spectrum& sigma_a, const Spectrum& sigma_s, float g)
+            : Medium(g), sigma_s_(sigma_s), sigma_t_(sigma_a + sigma_s)
+        {
+        }
+
+        bool SampleInteraction(const Ray& ray, float t_max, Sampler& sampler, float& t_out,
+                               Spectrum& weight_out) const override
+        {
+            // distance is sampled with a random channel, and weighted with the average pdf of all
+            // channels
+            auto channel = min(static_cast<int>(sampler.Get1D() * 3), 2);
+            auto t       = sigma_t_[channel] > 0
+                         ? -std::log(1.f - sampler.Get1D()) / sigma_t_[channel]
+                         : std::numeric_limits<float>::infinity();
+
+            auto scattered = t < t_max;
+            auto tr        = Exp(-sigma_t_ * min(t, t_max));
+            auto pdf       = scattered ? (sigma_t_ * tr).Sum() / 3.f : tr.Sum() / 3.f;
+
+            if (pdf == 0)
+            {
+                weight_out = kBlackSpectrum;
+                return false;
+            }
+
+            t_out      = t;
+            weight_out = scattered ? tr * sigma_s_ / pdf : tr / pdf;
+            return scattered;
+        }
+
+        Spectrum Transmittance(const Ray& ray, float t_max, Sampler& sampler) const override
+        {
+            return Exp(-sigma_t_ * t_max);
+        }
+
+    private:
+        static Spectrum Exp(const Spectrum& s) noexcept
+        {
+            return Spectrum{std::exp(s[0]), std::exp(s[1]), std::exp(s[2])};
+        }
+
+        Spectrum sigma_s_;
+        Spectrum sigma_t_;
+    };
+} // namespace akane
@@ -0,0 +1,23 @@
+#include "akane/medium.h"
+#include "akane/medium/grid.h"
+#include "akane/medium/homogeneous.h"
+#include "akane/model.h"
+
+using namespace std;
+
+namespace akane
+{
+    shared_ptr<Medium> CreateMedium(const MediumDesc& desc)
+    {
+        if (desc.type == "homogeneous")
+        {
+            return make_shared<HomogeneousMedium>(desc.sigma_a, desc.sigma_s, desc.g);
+        }
+        else if (desc.type == "grid")
+        {
+            return CreateGridMedium(desc.density_file, desc.sigma_t, desc.albedo, desc.g);
+        }
+
+        Throw("unknown medium type {}", desc.type);
+    }
+} // namespace akane
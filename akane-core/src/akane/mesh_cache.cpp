@@ -0,0 +1,426 @@
+#include "akane/mesh_cache.h"
+#include "akane/common/mapped_file.h"
+#include "akane/common/parallel.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+using namespace std;
+
+namespace akane
+{
+    namespace
+    {
+        // file layout:
+        //   header
+        //   material table and geometry table
+        //   vertex, normal, uv and index arrays
+        //
+        // every array starts at a multiple of kMeshCacheAlignment and is followed by at least
+        // kMeshCachePadding zero bytes, so that embree could read past the last element
+        constexpr char kMeshCacheMagic[8]    = {'A', 'K', 'M', 'E', 'S', 'H', 0, 0};
+        constexpr size_t kMeshCacheAlignment = 64;
+        constexpr size_t kMeshCachePadding   = 16;
+
+        // NOTE hash depends on the block size, so changing it requires bumping kMeshCacheVersion
+        constexpr size_t kContentHashBlockSize = 1 << 20;
+
+        constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+        constexpr uint64_t kFnvPrime       = 1099511628211ull;
+
+        inline uint64_t HashBytes(uint64_t hash, const uint8_t* data, size_t size) noexcept
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash ^= data[i];
+                hash *= kFnvPrime;
+            }
+
+            return hash;
+        }
+
+        struct MeshCacheSection
+        {
+            uint64_t offset;
+            uint64_t count;
+        };
+
+        struct MeshCacheHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t element_layout; // sizes of Point3f, Point2f and Point3i
+
+            uint64_t source_size;
+            int64_t source_mtime;
+            uint64_t source_hash;
+
+            MeshCacheSection material_table; // count of materials
+            MeshCacheSection geometry_table; // count of geometries
+
+            MeshCacheSection vertices;
+            MeshCacheSection normals;
+            MeshCacheSection uv;
+        };
+
+        static_assert(std::is_trivially_copyable_v<MeshCacheHeader>);
+
+        constexpr uint32_t GetElementLayout() noexcept
+        {
+            return static_cast<uint32_t>(sizeof(Point3f) | (sizeof(Point2f) << 8) |
+                                         (sizeof(Point3i) << 16));
+        }
+
+        // sequential writer that tracks the current offset
+        class CacheWriter
+        {
+        public:
+            CacheWriter(ofstream& stream) : stream_(stream)
+            {
+            }
+
+            uint64_t Offset() const noexcept
+            {
+                return offset_;
+            }
+
+            void WriteBytes(const void* data, size_t size)
+            {
+                stream_.write(reinterpret_cast<const char*>(data), size);
+                offset_ += size;
+            }
+
+            template <typename T> void Write(const T& value)
+            {
+                static_assert(std::is_trivially_copyable_v<T>);
+                WriteBytes(&value, sizeof(T));
+            }
+
+            void WriteString(const string& s)
+            {
+                Write(static_cast<uint32_t>(s.size()));
+                WriteBytes(s.data(), s.size());
+            }
+
+            void WriteZero(size_t size)
+            {
+                static constexpr char zero[kMeshCacheAlignment] = {};
+                while (size > 0)
+                {
+                    auto n = min(size, sizeof(zero));
+                    WriteBytes(zero, n);
+                    size -= n;
+                }
+            }
+
+            void Align()
+            {
+                WriteZero((kMeshCacheAlignment - offset_ % kMeshCacheAlignment) %
+                          kMeshCacheAlignment);
+            }
+
+            template <typename T> MeshCacheSection WriteArray(const SharedArray<T>& array)
+            {
+                Align();
+
+                MeshCacheSection section{offset_, array.size()};
+                WriteBytes(array.data(), array.size() * sizeof(T));
+                WriteZero(kMeshCachePadding);
+
+                return section;
+            }
+
+        private:
+            ofstream& stream_;
+            uint64_t offset_ = 0;
+        };
+
+        // sequential reader with bound checking, any failure marks the cache as broken
+        class CacheReader
+        {
+        public:
+            CacheReader(const MappedFile::SharedPtr& file, uint64_t offset)
+                : file_(file), offset_(offset)
+            {
+            }
+
+            bool Good() const noexcept
+            {
+                return good_;
+            }
+
+            bool ReadBytes(void* data, size_t size)
+            {
+                if (!good_ || offset_ + size > file_->Size())
+                {
+                    good_ = false;
+                    return false;
+                }
+
+                memcpy(data, file_->Data() + offset_, size);
+                offset_ += size;
+                return true;
+            }
+
+            template <typename T> T Read()
+            {
+                static_assert(std::is_trivially_copyable_v<T>);
+
+                T value{};
+                ReadBytes(&value, sizeof(T));
+                return value;
+            }
+
+            string ReadString()
+            {
+                auto size = Read<uint32_t>();
+                if (!good_ || offset_ + size > file_->Size())
+                {
+                    good_ = false;
+                    return {};
+                }
+
+                string result(reinterpret_cast<const char*>(file_->Data() + offset_), size);
+                offset_ += size;
+                return result;
+            }
+
+            // zero-copy view of an array section
+            template <typename T> SharedArray<T> ViewArray(const MeshCacheSection& section)
+            {
+                auto end = section.offset + section.count * sizeof(T) + kMeshCachePadding;
+                if (!good_ || section.offset % kMeshCacheAlignment != 0 || end > file_->Size())
+                {
+                    good_ = false;
+                    return {};
+                }
+
+                auto data = reinterpret_cast<const T*>(file_->Data() + section.offset);
+                return SharedArray<T>(file_, data, section.count);
+            }
+
+        private:
+            const MappedFile::SharedPtr& file_;
+            uint64_t offset_;
+            bool good_ = true;
+        };
+
+        void WriteMaterial(CacheWriter& writer, const tinyobj::material_t& mat)
+        {
+            writer.WriteString(mat.name);
+            for (auto color : {mat.ambient, mat.diffuse, mat.specular, mat.transmittance,
+                               mat.emission})
+            {
+                writer.WriteBytes(color, 3 * sizeof(float));
+            }
+
+            writer.Write(mat.shininess);
+            writer.Write(mat.ior);
+            writer.Write(mat.dissolve);
+            writer.Write(mat.illum);
+            writer.Write(mat.roughness);
+            writer.Write(mat.metallic);
+            writer.Write(mat.anisotropy);
+            writer.Write(mat.anisotropy_rotation);
+
+            writer.WriteString(mat.ambient_texname);
+            writer.WriteString(mat.diffuse_texname);
+            writer.WriteString(mat.specular_texname);
+            writer.WriteString(mat.bump_texname);
+
+            writer.Write(static_cast<uint32_t>(mat.unknown_parameter.size()));
+            for (const auto& [key, value] : mat.unknown_parameter)
+            {
+                writer.WriteString(key);
+                writer.WriteString(value);
+            }
+        }
+
+        tinyobj::material_t ReadMaterial(CacheReader& reader)
+        {
+            tinyobj::material_t mat{};
+
+            mat.name = reader.ReadString();
+            for (auto color : {mat.ambient, mat.diffuse, mat.specular, mat.transmittance,
+                               mat.emission})
+            {
+                reader.ReadBytes(color, 3 * sizeof(float));
+            }
+
+            mat.shininess           = reader.Read<float>();
+            mat.ior                 = reader.Read<float>();
+            mat.dissolve            = reader.Read<float>();
+            mat.illum               = reader.Read<int>();
+            mat.roughness           = reader.Read<float>();
+            mat.metallic            = reader.Read<float>();
+            mat.anisotropy          = reader.Read<float>();
+            mat.anisotropy_rotation = reader.Read<float>();
+
+            mat.ambient_texname  = reader.ReadString();
+            mat.diffuse_texname  = reader.ReadString();
+            mat.specular_texname = reader.ReadString();
+            mat.bump_texname     = reader.ReadString();
+
+            auto parameter_count = reader.Read<uint32_t>();
+            for (uint32_t i = 0; i < parameter_count && reader.Good(); ++i)
+            {
+                auto key                   = reader.ReadString();
+                mat.unknown_parameter[key] = reader.ReadString();
+            }
+
+            return mat;
+        }
+    } // namespace
+
+    uint64_t ComputeContentHash(const uint8_t* data, size_t size)
+    {
+        auto block_count = (size + kContentHashBlockSize - 1) / kContentHashBlockSize;
+
+        vector<uint64_t> block_hashes(block_count);
+        ParallelFor(block_count, 1, [&](size_t begin, size_t end) {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto offset     = i * kContentHashBlockSize;
+                block_hashes[i] = HashBytes(kFnvOffsetBasis, data + offset,
+                                            min(kContentHashBlockSize, size - offset));
+            }
+        });
+
+        auto length = static_cast<uint64_t>(size);
+        auto hash   = HashBytes(kFnvOffsetBasis, reinterpret_cast<const uint8_t*>(&length),
+                                sizeof(length));
+        return HashBytes(hash, reinterpret_cast<const uint8_t*>(block_hashes.data()),
+                         block_hashes.size() * sizeof(uint64_t));
+    }
+
+    bool LoadMeshCache(const string& filename, const MeshSourceStamp& stamp,
+                       MeshCacheContent& content_out)
+    {
+        auto file = MappedFile::Open(filename);
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        CacheReader reader{file, 0};
+
+        auto header = reader.Read<MeshCacheHeader>();
+        if (!reader.Good() || memcmp(header.magic, kMeshCacheMagic, sizeof(header.magic)) != 0 ||
+            header.version != kMeshCacheVersion || header.element_layout != GetElementLayout())
+        {
+            return false;
+        }
+
+        // stale cache
+        if (header.source_size != stamp.size || header.source_mtime != stamp.mtime)
+        {
+            return false;
+        }
+
+        MeshCacheContent content;
+        content.source_hash = header.source_hash;
+
+        content.vertices = reader.ViewArray<Point3f>(header.vertices);
+        content.normals  = reader.ViewArray<Point3f>(header.normals);
+        content.uv       = reader.ViewArray<Point2f>(header.uv);
+
+        CacheReader material_reader{file, header.material_table.offset};
+        for (uint64_t i = 0; i < header.material_table.count && material_reader.Good(); ++i)
+        {
+            content.materials.push_back(ReadMaterial(material_reader));
+        }
+
+        CacheReader geometry_reader{file, header.geometry_table.offset};
+        for (uint64_t i = 0; i < header.geometry_table.count && geometry_reader.Good(); ++i)
+        {
+            MeshCacheGeometry geometry;
+            geometry.name        = geometry_reader.ReadString();
+            geometry.material_id = geometry_reader.Read<int32_t>();
+
+            geometry.triangle_indices =
+                reader.ViewArray<Point3i>(geometry_reader.Read<MeshCacheSection>());
+            geometry.normal_indices =
+                reader.ViewArray<Point3i>(geometry_reader.Read<MeshCacheSection>());
+            geometry.uv_indices =
+                reader.ViewArray<Point3i>(geometry_reader.Read<MeshCacheSection>());
+
+            if (geometry.material_id >= static_cast<int>(content.materials.size()))
+            {
+                return false;
+            }
+
+            content.geometries.push_back(std::move(geometry));
+        }
+
+        if (!reader.Good() || !material_reader.Good() || !geometry_reader.Good())
+        {
+            return false;
+        }
+
+        content_out = std::move(content);
+        return true;
+    }
+
+    bool SaveMeshCache(const string& filename, const MeshSourceStamp& stamp,
+                       const MeshCacheContent& content)
+    {
+        auto temp_filename = MakeTemporaryFilename(filename);
+        auto written       = [&] {
+            ofstream stream{temp_filename, ios::binary | ios::trunc};
+            if (!stream)
+            {
+                return false;
+            }
+
+            CacheWriter writer{stream};
+
+            MeshCacheHeader header{};
+            memcpy(header.magic, kMeshCacheMagic, sizeof(header.magic));
+            header.version        = kMeshCacheVersion;
+            header.element_layout = GetElementLayout();
+            header.source_size    = stamp.size;
+            header.source_mtime   = stamp.mtime;
+            header.source_hash    = content.source_hash;
+
+            // header is rewritten after offsets are known
+            writer.Write(header);
+
+            writer.Align();
+            header.material_table = {writer.Offset(), content.materials.size()};
+            for (const auto& material : content.materials)
+            {
+                WriteMaterial(writer, material);
+            }
+
+            header.vertices = writer.WriteArray(content.vertices);
+            header.normals  = writer.WriteArray(content.normals);
+            header.uv       = writer.WriteArray(content.uv);
+
+            vector<MeshCacheSection> index_sections;
+            for (const auto& geometry : content.geometries)
+            {
+                index_sections.push_back(writer.WriteArray(geometry.triangle_indices));
+                index_sections.push_back(writer.WriteArray(geometry.normal_indices));
+                index_sections.push_back(writer.WriteArray(geometry.uv_indices));
+            }
+
+            writer.Align();
+            header.geometry_table = {writer.Offset(), content.geometries.size()};
+            for (size_t i = 0; i < content.geometries.size(); ++i)
+            {
+                writer.WriteString(content.geometries[i].name);
+                writer.Write(static_cast<int32_t>(content.geometries[i].material_id));
+                writer.Write(index_sections[3 * i]);
+                writer.Write(index_sections[3 * i + 1]);
+                writer.Write(index_sections[3 * i + 2]);
+            }
+
+            stream.seekp(0);
+            stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            return static_cast<bool>(stream);
+        }();
+
+        return CommitTemporaryFile(temp_filename, filename, written);
+    }
+} // namespace akane
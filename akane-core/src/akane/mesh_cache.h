@@ -0,0 +1,62 @@
+#pragma once
+#include "akane/common/basic.h"
+#include "akane/common/shared_array.h"
+#include "akane/math/math.h"
+#include <tiny_obj_loader.h>
+#include <string>
+#include <vector>
+
+namespace akane
+{
+    // bump this whenever layout of the cache file changes
+    constexpr uint32_t kMeshCacheVersion = 3;
+
+    // suffix appended to the obj file path for its cache file
+    constexpr const char* kMeshCacheSuffix = ".akmesh";
+
+    // identity of the source file that a cache is built from
+    struct MeshSourceStamp
+    {
+        uint64_t size;
+        int64_t mtime;
+    };
+
+    struct MeshCacheGeometry
+    {
+        std::string name;
+        int material_id; // -1 if no material
+
+        SharedArray<Point3i> triangle_indices;
+        SharedArray<Point3i> normal_indices;
+        SharedArray<Point3i> uv_indices;
+    };
+
+    // parsed content of an obj file, as stored in the cache
+    struct MeshCacheContent
+    {
+        uint64_t source_hash = 0; // see ComputeContentHash
+
+        std::vector<tinyobj::material_t> materials;
+
+        SharedArray<Point3f> vertices;
+        SharedArray<Point3f> normals;
+        SharedArray<Point2f> uv;
+
+        std::vector<MeshCacheGeometry> geometries;
+    };
+
+    // FNV-1a hashes of fixed-size blocks, computed in parallel and then combined
+    uint64_t ComputeContentHash(const uint8_t* data, size_t size);
+
+    /**
+     * Memory-map a cache file, arrays of the content are views into the mapping
+     *
+     * Returns false if the cache is missing, broken, or built from a different source.
+     */
+    bool LoadMeshCache(const std::string& filename, const MeshSourceStamp& stamp,
+                       MeshCacheContent& content_out);
+
+    // returns false if the cache couldn't be written
+    bool SaveMeshCache(const std::string& filename, const MeshSourceStamp& stamp,
+                       const MeshCacheContent& content);
+} // namespace akane
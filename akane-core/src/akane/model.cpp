@@ -1,8 +1,13 @@
 #include "akane/model.h"
+#include "akane/asset_cache.h"
+#include "akane/common/mapped_file.h"
 #include "akane/texture.h"
-#include "akane/texture/image.h"
+#include "akane/common/parallel.h"
+#include "akane/mesh_cache.h"
+#include "akane/obj_parser.h"
 #include <tiny_obj_loader.h>
 #include <nlohmann/json.hpp>
+#include <chrono>
 #include <string>
 #include <filesystem>
 #include <unordered_map>
@@ -20,26 +25,24 @@ namespace akane
 
     static shared_ptr<MaterialDesc>
     ParseMaterial(const tinyobj::material_t& mat, const path& dir,
-                  unordered_map<string, shared_ptr<Texture3D>>& texture_cache)
+                  unordered_map<string, TextureHandle>& texture_cache)
     {
-        auto try_load_texture = [&](const string& name) -> shared_ptr<Texture3D> {
+        // decoding is deferred so that textures of the whole scene are decoded in parallel
+        auto try_load_texture = [&](const string& name) -> TextureHandle {
             if (name.empty())
             {
-                return nullptr;
+                return {};
             }
 
-            auto iter = texture_cache.find(name);
-            if (iter != texture_cache.end())
+            auto& texture = texture_cache[name];
+            if (texture.IsNull())
             {
-                return iter->second;
+                texture = TextureHandle::Defer([filename = (dir / name).string()] {
+                    return AssetCache::Instance().LoadTexture(filename);
+                });
             }
-            else
-            {
-                auto texture_path   = dir / name;
-                texture_cache[name] = make_shared<ImageTexture>(texture_path.string());
 
-                return texture_cache[name];
-            }
+            return texture;
         };
 
         auto result = make_shared<MaterialDesc>();
@@ -68,6 +71,23 @@ namespace akane
             result->roughness = 0;
         }
 
+        result->anisotropy = clamp(mat.anisotropy, 0.f, .99f);
+
+        // not a standard mtl statement, so tinyobj keeps it among unknown parameters
+        if (auto it = mat.unknown_parameter.find("abbe"); it != mat.unknown_parameter.end())
+        {
+            result->abbe = max(strtof(it->second.c_str(), nullptr), 0.f);
+        }
+
+        return result;
+    }
+
+    static MeshSourceStamp GetSourceStamp(const path& file)
+    {
+        MeshSourceStamp result{};
+        result.size  = file_size(file);
+        result.mtime = last_write_time(file).time_since_epoch().count();
+
         return result;
     }
 
@@ -76,93 +96,50 @@ namespace akane
         path file = filename;
         path dir  = file.parent_path();
 
-        tinyobj::ObjReader reader{};
-        tinyobj::ObjReaderConfig config{};
+        // parsed content is cached in a binary file next to the obj file, which is
+        // memory-mapped instead of parsing the obj file again
+        auto stamp          = GetSourceStamp(file);
+        auto cache_filename = filename + kMeshCacheSuffix;
 
-        // config.mtl_search_path = dir.string();
-        bool success = reader.ParseFromFile(file.string(), config);
-        AKANE_REQUIRE(success);
+        MeshCacheContent content;
+        if (!LoadMeshCache(cache_filename, stamp, content))
+        {
+            ParseObjFile(filename, content);
+            if (!SaveMeshCache(cache_filename, stamp, content))
+            {
+                Warn("failed to write mesh cache {}\n", cache_filename);
+            }
+        }
 
         vector<shared_ptr<MaterialDesc>> material_vec;
-        unordered_map<string, shared_ptr<Texture3D>> texture_cache;
-        for (const auto& material : reader.GetMaterials())
+        unordered_map<string, TextureHandle> texture_cache;
+        for (const auto& material : content.materials)
         {
             material_vec.push_back(ParseMaterial(material, dir, texture_cache));
         }
 
-        auto result  = make_shared<MeshDesc>();
-        result->name = filename;
+        auto result         = make_shared<MeshDesc>();
+        result->name        = filename;
+        result->source_hash = content.source_hash;
 
-        for (size_t i = 0; i < reader.GetAttrib().vertices.size(); i += 3)
-        {
-            result->vertices.push_back({reader.GetAttrib().vertices[i],
-                                        reader.GetAttrib().vertices[i + 1u],
-                                        reader.GetAttrib().vertices[i + 2u]});
-        }
-        for (size_t i = 0; i < reader.GetAttrib().normals.size(); i += 3)
-        {
-            result->normals.push_back({reader.GetAttrib().normals[i],
-                                       reader.GetAttrib().normals[i + 1u],
-                                       reader.GetAttrib().normals[i + 2u]});
-        }
-        for (size_t i = 0; i < reader.GetAttrib().texcoords.size(); i += 2)
-        {
-            result->uv.push_back(
-                {reader.GetAttrib().texcoords[i], reader.GetAttrib().texcoords[i + 1u]});
-        }
+        result->vertices = content.vertices;
+        result->normals  = content.normals;
+        result->uv       = content.uv;
 
-        for (const auto& shape : reader.GetShapes())
+        for (const auto& geometry : content.geometries)
         {
-            std::unordered_map<int, shared_ptr<GeometryDesc>> geom_map;
+            auto geom              = make_shared<GeometryDesc>();
+            geom->name             = geometry.name;
+            geom->triangle_indices = geometry.triangle_indices;
+            geom->normal_indices   = geometry.normal_indices;
+            geom->uv_indices       = geometry.uv_indices;
 
-            auto vertex_iter = shape.mesh.indices.begin();
-            for (int face_index = 0; face_index < shape.mesh.num_face_vertices.size(); ++face_index)
+            if (geometry.material_id >= 0)
             {
-                auto face_vertex_count = shape.mesh.num_face_vertices[face_index];
-                auto face_material     = shape.mesh.material_ids[face_index];
-
-                auto& geom = geom_map[face_material];
-                if (geom == nullptr)
-                {
-                    geom       = make_shared<GeometryDesc>();
-                    geom->name = shape.name;
-
-                    geom->material = material_vec[face_material];
-                }
-
-                auto v0 = *vertex_iter;
-                ++vertex_iter;
-                --face_vertex_count;
-
-                auto v1 = *vertex_iter;
-                ++vertex_iter;
-                --face_vertex_count;
-
-                for (int i = 0; i < face_vertex_count; ++i)
-                {
-                    auto v2 = *vertex_iter;
-                    ++vertex_iter;
-
-                    geom->triangle_indices.push_back(
-                        {v0.vertex_index, v1.vertex_index, v2.vertex_index});
-
-                    if (!result->normals.empty() && v0.normal_index != -1)
-                    {
-                        geom->normal_indices.push_back(
-                            {v0.normal_index, v1.normal_index, v2.normal_index});
-                    }
-                    if (!result->uv.empty() && v0.texcoord_index != -1)
-                    {
-                        geom->uv_indices.push_back(
-                            {v0.texcoord_index, v1.texcoord_index, v2.texcoord_index});
-                    }
-                }
+                geom->material = material_vec[geometry.material_id];
             }
 
-            for (const auto& [mat_id, geom] : geom_map)
-            {
-                result->geomtries.push_back(geom);
-            }
+            result->geomtries.push_back(geom);
         }
 
         result->texture_lookup = move(texture_cache);
@@ -171,20 +148,18 @@ namespace akane
 
     static json LoadJsonFile(const string& filename)
     {
-        char json_buf[10000];
-        size_t file_size = 0;
+        // parse directly from the mapped file, so that size of the scene desc is unbounded
+        auto file = MappedFile::Open(filename);
+        AKANE_REQUIRE(file != nullptr);
 
-        // read scene desc file
-        {
-            auto file = fopen(filename.c_str(), "rb");
-            AKANE_REQUIRE(file != nullptr);
+        auto start_time = chrono::steady_clock::now();
+        auto result     = json::parse(file->Data(), file->Data() + file->Size());
 
-            // TODO: check file is exhausted
-            file_size = fread(json_buf, 1, sizeof json_buf, file);
-            fclose(file);
-        }
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start_time;
+        fmt::print("[scene] parsed {} ({} bytes) in {:.1f}ms\n", filename, file->Size(),
+                   elapsed.count());
 
-        return json::parse(json_buf, json_buf + file_size);
+        return result;
     }
 
     static CameraDesc ParseJson_CameraDesc(const json& value)
@@ -197,12 +172,55 @@ namespace akane
         result.upward  = value.value<Vec3>("upward", {});
         result.fov     = value.value<float>("fov", 0.5f);
 
+        result.shutter_open  = value.value<float>("shutter_open", 0.f);
+        result.shutter_close = value.value<float>("shutter_close", 1.f);
+
+        return result;
+    }
+
+    static EnvironmentDesc ParseJson_EnvironmentDesc(const json& value)
+    {
+        AKANE_REQUIRE(value.is_object());
+
+        EnvironmentDesc result{};
+        result.image_file = value.value<string>("image_file", "");
+        result.scale      = value.value<float>("scale", 1.f);
+
+        return result;
+    }
+
+    static shared_ptr<MediumDesc> ParseJson_MediumDesc(const json& value)
+    {
+        AKANE_REQUIRE(value.is_object());
+
+        auto result             = make_shared<MediumDesc>();
+        result->type            = value.value<string>("type", "homogeneous");
+        result->sigma_a         = value.value<Vec3>("sigma_a", {});
+        result->sigma_s         = value.value<Vec3>("sigma_s", {});
+        result->density_file    = value.value<string>("density_file", "");
+        result->sigma_t         = value.value<float>("sigma_t", 1.f);
+        result->albedo          = value.value<Vec3>("albedo", Vec3{1.f, 1.f, 1.f});
+        result->g               = value.value<float>("g", 0.f);
+        result->surface_visible = value.value<bool>("surface_visible", false);
+
+        return result;
+    }
+
+    static KeyframeDesc ParseJson_KeyframeDesc(const json& value)
+    {
+        AKANE_REQUIRE(value.is_object());
+
+        KeyframeDesc result{};
+        result.rotation = value.value<Vec3>("rotation", {}) / 180.f * kPi;
+        result.position = value.value<Vec3>("position", {});
+        result.scale    = value.value<float>("scale", 1.f);
+
         return result;
     }
 
     static PrimitiveDesc
     ParseJson_PrimitiveDesc(const json& value,
-                            unordered_map<string, shared_ptr<MeshDesc>>& mesh_cache)
+                            unordered_map<string, shared_ptr<const MeshDesc>>& mesh_cache)
     {
         AKANE_REQUIRE(value.is_object());
         AKANE_REQUIRE(value["type"] == "mesh");
@@ -214,19 +232,34 @@ namespace akane
         auto& cached_item   = mesh_cache[obj_filename];
         if (cached_item == nullptr)
         {
-            cached_item = LoadMeshDesc(obj_filename);
+            cached_item = AssetCache::Instance().LoadMesh(obj_filename);
         }
 
         result.mesh = cached_item;
 
         // parse transform
-        auto transform_config = value["transform"];
+        const auto& transform_config = value["transform"];
         AKANE_REQUIRE(transform_config.is_object());
 
         result.rotation = transform_config.value<Vec3>("rotation", {}) / 180.f * kPi;
         result.position = transform_config.value<Vec3>("position", {});
         result.scale    = transform_config.value<float>("scale", 1.f);
 
+        // parse motion, if any
+        if (auto motion_config = value.find("motion"); motion_config != value.end())
+        {
+            AKANE_REQUIRE(motion_config->is_array());
+            for (const auto& item : *motion_config)
+            {
+                result.motion.push_back(ParseJson_KeyframeDesc(item));
+            }
+        }
+
+        if (auto medium_config = value.find("medium"); medium_config != value.end())
+        {
+            result.medium = ParseJson_MediumDesc(*medium_config);
+        }
+
         // finalize
         return result;
     }
@@ -235,15 +268,71 @@ namespace akane
     {
         auto config = LoadJsonFile(filename);
 
-        unordered_map<string, shared_ptr<MeshDesc>> mesh_cache;
-
         auto result    = make_unique<SceneDesc>();
         result->name   = config["name"];
         result->camera = ParseJson_CameraDesc(config["camera"]);
 
-        auto scene_config = config["scene"];
-        auto primitives   = scene_config["primitives"];
+        auto& scene_config     = config["scene"];
+        const auto& primitives = scene_config["primitives"];
         AKANE_REQUIRE(primitives.is_array());
+
+        if (auto environment = scene_config.find("environment"); environment != scene_config.end())
+        {
+            result->environment = ParseJson_EnvironmentDesc(*environment);
+        }
+
+        if (auto medium = scene_config.find("medium"); medium != scene_config.end())
+        {
+            result->medium = ParseJson_MediumDesc(*medium);
+        }
+
+        // distinct meshes are loaded concurrently before primitives are parsed, and shared with
+        // other scenes through the asset cache
+        vector<string> obj_filenames;
+        unordered_map<string, shared_ptr<const MeshDesc>> mesh_cache;
+        for (const auto& item : primitives)
+        {
+            AKANE_REQUIRE(item.is_object() && item.contains("obj_file"));
+
+            string obj_filename = item["obj_file"];
+            if (mesh_cache.emplace(obj_filename, nullptr).second)
+            {
+                obj_filenames.push_back(obj_filename);
+            }
+        }
+
+        vector<shared_ptr<const MeshDesc>> meshes(obj_filenames.size());
+        ParallelFor(obj_filenames.size(), 1, [&](size_t begin, size_t end) {
+            for (auto i = begin; i < end; ++i)
+            {
+                meshes[i] = AssetCache::Instance().LoadMesh(obj_filenames[i]);
+            }
+        });
+
+        for (size_t i = 0; i < obj_filenames.size(); ++i)
+        {
+            mesh_cache[obj_filenames[i]] = meshes[i];
+        }
+
+        // decode all textures before rendering starts, rather than on first access by a single
+        // thread building the scene
+        vector<TextureHandle> textures;
+        for (const auto& mesh : meshes)
+        {
+            for (const auto& [name, texture] : mesh->texture_lookup)
+            {
+                textures.push_back(texture);
+            }
+        }
+
+        ParallelFor(textures.size(), 1, [&](size_t begin, size_t end) {
+            for (auto i = begin; i < end; ++i)
+            {
+                textures[i].Get();
+            }
+        });
+
+        result->objects.reserve(primitives.size());
         for (const auto& item : primitives)
         {
             result->objects.push_back(ParseJson_PrimitiveDesc(item, mesh_cache));
@@ -251,4 +340,25 @@ namespace akane
 
         return result;
     }
+
+    std::vector<Transform> ComputeKeyframeTransforms(const PrimitiveDesc& desc)
+    {
+        auto create_transform = [](float scale, const Vec3& position, const Vec3& rotation) {
+            return Transform::CreateScale(scale)
+                .RotateX(rotation[0])
+                .RotateY(rotation[1])
+                .RotateZ(rotation[2])
+                .Move(position);
+        };
+
+        std::vector<Transform> result;
+        result.push_back(create_transform(desc.scale, desc.position, desc.rotation));
+        for (const auto& keyframe : desc.motion)
+        {
+            result.push_back(
+                create_transform(keyframe.scale, keyframe.position, keyframe.rotation));
+        }
+
+        return result;
+    }
 } // namespace akane
\ No newline at end of file
@@ -0,0 +1,495 @@
+#include "akane/obj_parser.h"
+#include "akane/common/mapped_file.h"
+#include "akane/common/parallel.h"
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+using namespace std;
+using namespace std::filesystem;
+
+namespace akane
+{
+    namespace
+    {
+        // approximate size of a chunk parsed by a single task
+        constexpr size_t kObjChunkSize = 1 << 22;
+
+        struct GeometryBuilder
+        {
+            vector<Point3i> triangle_indices;
+            vector<Point3i> normal_indices;
+            vector<Point3i> uv_indices;
+        };
+
+        struct ObjChunk
+        {
+            const char* begin;
+            const char* end;
+
+            // counts are collected in the first pass, and prefix sums give where data of the
+            // chunk is written
+            size_t vertex_count = 0;
+            size_t normal_count = 0;
+            size_t uv_count     = 0;
+
+            size_t vertex_base = 0;
+            size_t normal_base = 0;
+            size_t uv_base     = 0;
+
+            vector<string> mtllibs;
+
+            // segment 0 continues the last shape of the previous chunk, and every "o" or "g"
+            // statement starts a new one
+            vector<string> shape_names;
+
+            // material slot -1 continues the last material of the previous chunk, otherwise it
+            // indexes names of "usemtl" statements
+            vector<string> material_names;
+
+            map<pair<int, int>, GeometryBuilder> groups;
+        };
+
+        // index of a vertex in a face, -1 if absent
+        struct FaceVertex
+        {
+            int vertex;
+            int uv;
+            int normal;
+        };
+
+        inline bool IsSpace(char c) noexcept
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        inline void SkipSpace(const char*& p, const char* end) noexcept
+        {
+            while (p < end && IsSpace(*p))
+            {
+                ++p;
+            }
+        }
+
+        inline void SkipLine(const char*& p, const char* end) noexcept
+        {
+            while (p < end && *p != '\n')
+            {
+                ++p;
+            }
+            if (p < end)
+            {
+                ++p;
+            }
+        }
+
+        // test if the line starts with the keyword followed by a space
+        inline bool MatchKeyword(const char*& p, const char* end, string_view keyword) noexcept
+        {
+            auto size = keyword.size();
+            if (static_cast<size_t>(end - p) > size && string_view{p, size} == keyword &&
+                IsSpace(p[size]))
+            {
+                p += size;
+                return true;
+            }
+
+            return false;
+        }
+
+        inline float ParseFloat(const char*& p, const char* end)
+        {
+            SkipSpace(p, end);
+            if (p < end && *p == '+')
+            {
+                ++p;
+            }
+
+            float value    = 0.f;
+            auto [ptr, ec] = from_chars(p, end, value);
+            AKANE_REQUIRE(ec == errc{});
+
+            p = ptr;
+            return value;
+        }
+
+        inline int ParseInt(const char*& p, const char* end)
+        {
+            int value      = 0;
+            auto [ptr, ec] = from_chars(p, end, value);
+            AKANE_REQUIRE(ec == errc{});
+
+            p = ptr;
+            return value;
+        }
+
+        // rest of the line without surrounding spaces
+        inline string ParseName(const char*& p, const char* end)
+        {
+            SkipSpace(p, end);
+
+            auto first = p;
+            while (p < end && *p != '\n')
+            {
+                ++p;
+            }
+
+            auto last = p;
+            while (last > first && IsSpace(last[-1]))
+            {
+                --last;
+            }
+
+            return string{first, last};
+        }
+
+        // convert a one-based or negative relative index of obj into zero-based
+        inline int ResolveIndex(int index, size_t current_count, size_t total_count)
+        {
+            auto result = index > 0 ? index - 1 : static_cast<int>(current_count) + index;
+            AKANE_REQUIRE(index != 0 && result >= 0 && static_cast<size_t>(result) < total_count);
+
+            return result;
+        }
+
+        void CountChunk(ObjChunk& chunk)
+        {
+            for (auto p = chunk.begin; p < chunk.end; SkipLine(p, chunk.end))
+            {
+                SkipSpace(p, chunk.end);
+                if (MatchKeyword(p, chunk.end, "v"))
+                {
+                    chunk.vertex_count += 1;
+                }
+                else if (MatchKeyword(p, chunk.end, "vn"))
+                {
+                    chunk.normal_count += 1;
+                }
+                else if (MatchKeyword(p, chunk.end, "vt"))
+                {
+                    chunk.uv_count += 1;
+                }
+            }
+        }
+
+        void ParseChunk(ObjChunk& chunk, vector<Point3f>& vertices, vector<Point3f>& normals,
+                        vector<Point2f>& uv)
+        {
+            auto vertex_index = chunk.vertex_base;
+            auto normal_index = chunk.normal_base;
+            auto uv_index     = chunk.uv_base;
+
+            vector<FaceVertex> face;
+            GeometryBuilder* geom = nullptr;
+
+            auto end = chunk.end;
+            for (auto p = chunk.begin; p < end; SkipLine(p, end))
+            {
+                SkipSpace(p, end);
+                if (MatchKeyword(p, end, "v"))
+                {
+                    auto x = ParseFloat(p, end);
+                    auto y = ParseFloat(p, end);
+                    auto z = ParseFloat(p, end);
+
+                    vertices[vertex_index++] = {x, y, z};
+                }
+                else if (MatchKeyword(p, end, "vn"))
+                {
+                    auto x = ParseFloat(p, end);
+                    auto y = ParseFloat(p, end);
+                    auto z = ParseFloat(p, end);
+
+                    normals[normal_index++] = {x, y, z};
+                }
+                else if (MatchKeyword(p, end, "vt"))
+                {
+                    auto u = ParseFloat(p, end);
+
+                    // v coordinate is optional
+                    SkipSpace(p, end);
+                    auto v = p < end && *p != '\n' ? ParseFloat(p, end) : 0.f;
+
+                    uv[uv_index++] = {u, v};
+                }
+                else if (MatchKeyword(p, end, "f"))
+                {
+                    // parse vertices in forms of v, v/vt, v//vn or v/vt/vn
+                    face.clear();
+                    while (SkipSpace(p, end), p < end && *p != '\n')
+                    {
+                        FaceVertex fv{-1, -1, -1};
+                        fv.vertex =
+                            ResolveIndex(ParseInt(p, end), vertex_index, vertices.size());
+                        if (p < end && *p == '/')
+                        {
+                            ++p;
+                            if (p < end && *p != '/')
+                            {
+                                fv.uv = ResolveIndex(ParseInt(p, end), uv_index, uv.size());
+                            }
+                            if (p < end && *p == '/')
+                            {
+                                ++p;
+                                fv.normal =
+                                    ResolveIndex(ParseInt(p, end), normal_index, normals.size());
+                            }
+                        }
+
+                        face.push_back(fv);
+                    }
+
+                    AKANE_REQUIRE(face.size() >= 3);
+
+                    if (geom == nullptr)
+                    {
+                        auto segment = static_cast<int>(chunk.shape_names.size());
+                        auto slot    = static_cast<int>(chunk.material_names.size()) - 1;
+                        geom         = &chunk.groups[{segment, slot}];
+                    }
+
+                    // triangulate as a fan
+                    const auto& v0 = face[0];
+                    for (size_t i = 2; i < face.size(); ++i)
+                    {
+                        const auto& v1 = face[i - 1];
+                        const auto& v2 = face[i];
+
+                        geom->triangle_indices.push_back({v0.vertex, v1.vertex, v2.vertex});
+                        if (!normals.empty() && v0.normal != -1)
+                        {
+                            geom->normal_indices.push_back({v0.normal, v1.normal, v2.normal});
+                        }
+                        if (!uv.empty() && v0.uv != -1)
+                        {
+                            geom->uv_indices.push_back({v0.uv, v1.uv, v2.uv});
+                        }
+                    }
+                }
+                else if (MatchKeyword(p, end, "usemtl"))
+                {
+                    chunk.material_names.push_back(ParseName(p, end));
+                    geom = nullptr;
+                }
+                else if (MatchKeyword(p, end, "mtllib"))
+                {
+                    chunk.mtllibs.push_back(ParseName(p, end));
+                }
+                else if (MatchKeyword(p, end, "o") || MatchKeyword(p, end, "g"))
+                {
+                    chunk.shape_names.push_back(ParseName(p, end));
+                    geom = nullptr;
+                }
+            }
+        }
+
+        // like tinyobj, the first library that could be opened is loaded
+        void LoadMaterialLibrary(const path& dir, const string& names,
+                                 map<string, int>& material_map,
+                                 vector<tinyobj::material_t>& materials)
+        {
+            for (auto p = names.data(), end = names.data() + names.size(); p < end;)
+            {
+                SkipSpace(p, end);
+
+                auto first = p;
+                while (p < end && !IsSpace(*p))
+                {
+                    ++p;
+                }
+                if (first == p)
+                {
+                    break;
+                }
+
+                ifstream stream{dir / string{first, p}};
+                if (stream)
+                {
+                    string warning, error;
+                    tinyobj::LoadMtl(&material_map, &materials, &stream, &warning, &error);
+                    if (!error.empty())
+                    {
+                        Warn("{}", error);
+                    }
+
+                    return;
+                }
+            }
+
+            Warn("material library {} not found\n", names);
+        }
+
+        template <typename T> SharedArray<T> ConcatBuilders(const vector<vector<T>*>& parts)
+        {
+            size_t size = 0;
+            for (auto part : parts)
+            {
+                size += part->size();
+            }
+
+            // NOTE SharedArray needs one more element of capacity to avoid reallocation
+            vector<T> result;
+            result.reserve(size + 1);
+            for (auto part : parts)
+            {
+                result.insert(result.end(), part->begin(), part->end());
+            }
+
+            return std::move(result);
+        }
+    } // namespace
+
+    void ParseObjFile(const string& filename, MeshCacheContent& content)
+    {
+        auto source = MappedFile::Open(filename);
+        AKANE_REQUIRE(source != nullptr);
+
+        auto data = reinterpret_cast<const char*>(source->Data());
+        auto size = source->Size();
+
+        content.source_hash = ComputeContentHash(source->Data(), size);
+
+        // split the file into chunks that end at line breaks
+        vector<ObjChunk> chunks;
+        for (size_t offset = 0; offset < size;)
+        {
+            auto chunk_end = min(offset + kObjChunkSize, size);
+            while (chunk_end < size && data[chunk_end - 1] != '\n')
+            {
+                ++chunk_end;
+            }
+
+            auto& chunk = chunks.emplace_back();
+            chunk.begin = data + offset;
+            chunk.end   = data + chunk_end;
+
+            offset = chunk_end;
+        }
+
+        // first pass: count vertex data to know where each chunk writes into
+        ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+            for (auto i = begin; i < end; ++i)
+            {
+                CountChunk(chunks[i]);
+            }
+        });
+
+        size_t vertex_count = 0;
+        size_t normal_count = 0;
+        size_t uv_count     = 0;
+        for (auto& chunk : chunks)
+        {
+            chunk.vertex_base = vertex_count;
+            chunk.normal_base = normal_count;
+            chunk.uv_base     = uv_count;
+
+            vertex_count += chunk.vertex_count;
+            normal_count += chunk.normal_count;
+            uv_count += chunk.uv_count;
+        }
+
+        // NOTE SharedArray needs one more element of capacity to avoid reallocation
+        vector<Point3f> vertices;
+        vector<Point3f> normals;
+        vector<Point2f> uv;
+        vertices.reserve(vertex_count + 1);
+        normals.reserve(normal_count + 1);
+        uv.reserve(uv_count + 1);
+        vertices.resize(vertex_count);
+        normals.resize(normal_count);
+        uv.resize(uv_count);
+
+        // second pass: parse vertex data in place, and triangulate faces into local groups
+        ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+            for (auto i = begin; i < end; ++i)
+            {
+                ParseChunk(chunks[i], vertices, normals, uv);
+            }
+        });
+
+        // load materials
+        map<string, int> material_map;
+        auto dir = path{filename}.parent_path();
+        for (const auto& chunk : chunks)
+        {
+            for (const auto& mtllib : chunk.mtllibs)
+            {
+                LoadMaterialLibrary(dir, mtllib, material_map, content.materials);
+            }
+        }
+
+        // resolve shapes and materials of local groups, which continue from previous chunks
+        struct MergedGroup
+        {
+            vector<vector<Point3i>*> triangle_indices;
+            vector<vector<Point3i>*> normal_indices;
+            vector<vector<Point3i>*> uv_indices;
+        };
+
+        vector<string> shape_names = {""};
+        map<pair<int, int>, MergedGroup> merged_groups;
+
+        int current_shape    = 0;
+        int current_material = -1;
+        for (auto& chunk : chunks)
+        {
+            vector<int> shape_ids = {current_shape};
+            for (const auto& name : chunk.shape_names)
+            {
+                shape_ids.push_back(static_cast<int>(shape_names.size()));
+                shape_names.push_back(name);
+            }
+
+            vector<int> material_ids;
+            for (const auto& name : chunk.material_names)
+            {
+                auto iter = material_map.find(name);
+                material_ids.push_back(iter != material_map.end() ? iter->second : -1);
+            }
+
+            for (auto& [key, geom] : chunk.groups)
+            {
+                auto shape_id    = shape_ids[key.first];
+                auto material_id = key.second == -1 ? current_material : material_ids[key.second];
+
+                auto& merged = merged_groups[{shape_id, material_id}];
+                merged.triangle_indices.push_back(&geom.triangle_indices);
+                merged.normal_indices.push_back(&geom.normal_indices);
+                merged.uv_indices.push_back(&geom.uv_indices);
+            }
+
+            current_shape = shape_ids.back();
+            if (!material_ids.empty())
+            {
+                current_material = material_ids.back();
+            }
+        }
+
+        // concatenate local groups
+        vector<pair<pair<int, int>, MergedGroup*>> merged_list;
+        for (auto& [key, merged] : merged_groups)
+        {
+            merged_list.push_back({key, &merged});
+        }
+
+        content.geometries.resize(merged_list.size());
+        ParallelFor(merged_list.size(), 1, [&](size_t begin, size_t end) {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto [key, merged] = merged_list[i];
+
+                auto& geometry            = content.geometries[i];
+                geometry.name             = shape_names[key.first];
+                geometry.material_id      = key.second;
+                geometry.triangle_indices = ConcatBuilders(merged->triangle_indices);
+                geometry.normal_indices   = ConcatBuilders(merged->normal_indices);
+                geometry.uv_indices       = ConcatBuilders(merged->uv_indices);
+            }
+        });
+
+        content.vertices = std::move(vertices);
+        content.normals  = std::move(normals);
+        content.uv       = std::move(uv);
+    }
+} // namespace akane
@@ -0,0 +1,15 @@
+#pragma once
+#include "akane/mesh_cache.h"
+#include <string>
+
+namespace akane
+{
+    /**
+     * Parse an obj file and its material libraries into content of a mesh cache
+     *
+     * The memory-mapped file is split into chunks at line boundaries that are parsed concurrently.
+     * Polygons are triangulated as fans and grouped by shape and material, in the same order as
+     * they appear in the file.
+     */
+    void ParseObjFile(const std::string& filename, MeshCacheContent& content);
+} // namespace akane
@@ -15,6 +15,11 @@ namespace akane
             AKANE_NO_IMPL();
         }
 
+        Bounds3 Bound() const override
+        {
+            return Union(Union(Bounds3{v0_}, v0_ + e1_), v0_ + e2_);
+        }
+
         float Area() const override
         {
             return area_;
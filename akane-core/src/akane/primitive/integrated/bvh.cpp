@@ -0,0 +1,367 @@
+#include "akane/primitive/integrated/bvh.h"
+#include <algorithm>
+
+namespace akane
+{
+    namespace
+    {
+        // slab test against a node, t_max is the closest hit found so far
+        inline bool IntersectBound(const Vec3& lower, const Vec3& upper, const Vec3& origin,
+                                   const Vec3& inv_dir, float t_min, float t_max) noexcept
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                float t0 = (lower[i] - origin[i]) * inv_dir[i];
+                float t1 = (upper[i] - origin[i]) * inv_dir[i];
+                if (inv_dir[i] < 0.f)
+                {
+                    std::swap(t0, t1);
+                }
+
+                // NOTE written in this form so that NaN (0 * inf) never shrinks the interval
+                t_min = t0 > t_min ? t0 : t_min;
+                t_max = t1 < t_max ? t1 : t_max;
+                if (t_min > t_max)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    } // namespace
+
+    void BvhComposite::Build()
+    {
+        nodes_.clear();
+        ordered_objects_.clear();
+        ordered_sphere_ids_.clear();
+        dirty_        = false;
+        sphere_width_ = shape::GetSpherePackWidth();
+
+        if (objects_.empty())
+        {
+            return;
+        }
+
+        std::vector<BuildItem> items;
+        items.reserve(objects_.size());
+        for (size_t i = 0; i < objects_.size(); ++i)
+        {
+            // primitives that occupy no space could never be hit
+            auto bound = objects_[i]->Bound();
+            if (!bound.Empty())
+            {
+                items.push_back(BuildItem{bound, bound.Centroid(), objects_[i], sphere_ids_[i]});
+            }
+        }
+
+        if (items.empty())
+        {
+            return;
+        }
+
+        nodes_.reserve(2 * items.size());
+        ordered_objects_.reserve(items.size());
+        BuildRecursive(items.data(), items.data() + items.size(), 0);
+
+        nodes_.shrink_to_fit();
+
+        sphere_pack_.Resize(ordered_objects_.size());
+        for (size_t i = 0; i < ordered_objects_.size(); ++i)
+        {
+            if (ordered_sphere_ids_[i] != -1)
+            {
+                sphere_pack_.Set(i, spheres_[ordered_sphere_ids_[i]]);
+            }
+        }
+    }
+
+    uint32_t BvhComposite::BuildRecursive(BuildItem* begin, BuildItem* end, int depth)
+    {
+        // median splits below kMaxSahDepth add at most log2 of the count to the depth
+        AKANE_ASSERT(depth < kTraversalStackSize);
+
+        auto node_index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+
+        auto count = static_cast<int>(end - begin);
+
+        Bounds3 bound;
+        Bounds3 centroid_bound;
+        int sphere_count = 0;
+        for (auto p = begin; p != end; ++p)
+        {
+            bound          = Union(bound, p->bound);
+            centroid_bound = Union(centroid_bound, p->centroid);
+            sphere_count += p->sphere_id != -1;
+        }
+
+        auto make_leaf = [&] {
+            // spheres are moved to the front of the leaf to be tested together
+            auto sphere_end = std::stable_partition(
+                begin, end, [](const BuildItem& item) { return item.sphere_id != -1; });
+
+            auto& node           = nodes_[node_index];
+            node.lower           = bound.lower;
+            node.upper           = bound.upper;
+            node.offset          = static_cast<uint32_t>(ordered_objects_.size());
+            node.primitive_count = static_cast<uint16_t>(count);
+            node.sphere_count    = static_cast<uint8_t>(sphere_end - begin);
+
+            for (auto p = begin; p != end; ++p)
+            {
+                ordered_objects_.push_back(p->object);
+                ordered_sphere_ids_.push_back(p->sphere_id);
+            }
+
+            return node_index;
+        };
+
+        if (count == 1)
+        {
+            return make_leaf();
+        }
+
+        int axis       = centroid_bound.MaxExtent();
+        BuildItem* mid = nullptr;
+        if (centroid_bound.upper[axis] == centroid_bound.lower[axis])
+        {
+            // all centroids collapse into one point, there's no meaningful split
+            if (FitInLeaf(count, sphere_count))
+            {
+                return make_leaf();
+            }
+
+            mid = begin + count / 2;
+        }
+        else if (depth >= kMaxSahDepth)
+        {
+            if (FitInLeaf(count, sphere_count))
+            {
+                return make_leaf();
+            }
+
+            mid = begin + count / 2;
+            std::nth_element(begin, mid, end, [&](const BuildItem& lhs, const BuildItem& rhs) {
+                return lhs.centroid[axis] < rhs.centroid[axis];
+            });
+        }
+        else
+        {
+            mid = PartitionSah(begin, end, bound, centroid_bound, axis, sphere_count);
+            if (mid == nullptr)
+            {
+                return make_leaf();
+            }
+        }
+
+        BuildRecursive(begin, mid, depth + 1);
+        auto second = BuildRecursive(mid, end, depth + 1);
+
+        // NOTE nodes_ may be reallocated by recursion, so the node is fetched afterwards
+        auto& node           = nodes_[node_index];
+        node.lower           = bound.lower;
+        node.upper           = bound.upper;
+        node.offset          = second;
+        node.primitive_count = 0;
+        node.axis            = static_cast<uint8_t>(axis);
+        node.sphere_count    = 0;
+        return node_index;
+    }
+
+    BvhComposite::BuildItem* BvhComposite::PartitionSah(BuildItem* begin, BuildItem* end,
+                                                        const Bounds3& bound,
+                                                        const Bounds3& centroid_bound, int axis,
+                                                        int sphere_count)
+    {
+        auto count = static_cast<int>(end - begin);
+
+        // packed spheres are tested in batches as wide as the kernel, each costing about the
+        // same as a single primitive
+        auto primitive_cost = [&](int count, int sphere_count) {
+            auto batch_count = (sphere_count + sphere_width_ - 1) / sphere_width_;
+            return static_cast<float>(count - sphere_count + batch_count);
+        };
+
+        // bucket primitives by centroid along the split axis
+        struct Bucket
+        {
+            int count        = 0;
+            int sphere_count = 0;
+            Bounds3 bound;
+        };
+
+        Bucket buckets[kSahBucketCount];
+        auto bucket_of = [&](const BuildItem& item) {
+            auto b = static_cast<int>(kSahBucketCount * centroid_bound.Offset(item.centroid)[axis]);
+            return min(b, kSahBucketCount - 1);
+        };
+
+        for (auto p = begin; p != end; ++p)
+        {
+            auto& bucket = buckets[bucket_of(*p)];
+            bucket.count += 1;
+            bucket.sphere_count += p->sphere_id != -1;
+            bucket.bound = Union(bucket.bound, p->bound);
+        }
+
+        // evaluate SAH cost of splitting after each bucket with a sweep from both sides
+        float cost[kSahBucketCount - 1] = {};
+        {
+            Bounds3 acc_bound;
+            int acc_count        = 0;
+            int acc_sphere_count = 0;
+            for (int i = 0; i < kSahBucketCount - 1; ++i)
+            {
+                acc_bound = Union(acc_bound, buckets[i].bound);
+                acc_count += buckets[i].count;
+                acc_sphere_count += buckets[i].sphere_count;
+                cost[i] = primitive_cost(acc_count, acc_sphere_count) * acc_bound.SurfaceArea();
+            }
+        }
+        {
+            Bounds3 acc_bound;
+            int acc_count        = 0;
+            int acc_sphere_count = 0;
+            for (int i = kSahBucketCount - 1; i > 0; --i)
+            {
+                acc_bound = Union(acc_bound, buckets[i].bound);
+                acc_count += buckets[i].count;
+                acc_sphere_count += buckets[i].sphere_count;
+                cost[i - 1] += primitive_cost(acc_count, acc_sphere_count) *
+                               acc_bound.SurfaceArea();
+            }
+        }
+
+        int best_split  = 0;
+        float best_cost = cost[0];
+        for (int i = 1; i < kSahBucketCount - 1; ++i)
+        {
+            if (cost[i] < best_cost)
+            {
+                best_split = i;
+                best_cost  = cost[i];
+            }
+        }
+
+        // relative cost of traversal step is assumed to be 1/8 of a primitive intersection
+        float leaf_cost  = primitive_cost(count, sphere_count);
+        float split_cost = .125f + best_cost / bound.SurfaceArea();
+        if (FitInLeaf(count, sphere_count) && leaf_cost <= split_cost)
+        {
+            return nullptr;
+        }
+
+        auto mid = std::partition(
+            begin, end, [&](const BuildItem& item) { return bucket_of(item) <= best_split; });
+        if (mid == begin || mid == end)
+        {
+            mid = begin + count / 2;
+            std::nth_element(begin, mid, end, [&](const BuildItem& lhs, const BuildItem& rhs) {
+                return lhs.centroid[axis] < rhs.centroid[axis];
+            });
+        }
+
+        return mid;
+    }
+
+    bool BvhComposite::Intersect(const Ray& ray, float t_min, float t_max,
+                                 IntersectionInfo& isect) const
+    {
+        AKANE_ASSERT(!dirty_);
+        if (nodes_.empty())
+        {
+            return false;
+        }
+
+        auto inv_dir       = Vec3{1.f / ray.d[0], 1.f / ray.d[1], 1.f / ray.d[2]};
+        bool dir_is_neg[3] = {inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0};
+
+        bool any_hit = false;
+        float t      = t_max;
+
+        IntersectionInfo isect_buf;
+
+        uint32_t stack[kTraversalStackSize];
+        int stack_size   = 0;
+        uint32_t current = 0;
+        while (true)
+        {
+            const auto& node = nodes_[current];
+            if (IntersectBound(node.lower, node.upper, ray.o, inv_dir, t_min, t))
+            {
+                if (node.primitive_count > 0)
+                {
+                    // the kernel only locates the closest sphere, whose intersection record is
+                    // then filled by the primitive itself
+                    uint32_t first = 0;
+                    if (node.sphere_count > 0)
+                    {
+                        float t_hit;
+                        int index = shape::IntersectSpherePack(sphere_pack_, node.offset,
+                                                               node.sphere_count, ray, t_min, t,
+                                                               t_hit);
+                        if (index == -1)
+                        {
+                            first = node.sphere_count;
+                        }
+                        else if (ordered_objects_[node.offset + index]->Intersect(ray, t_min, t,
+                                                                                 isect_buf))
+                        {
+                            any_hit = true;
+                            t       = isect_buf.t;
+                            first   = node.sphere_count;
+                        }
+
+                        // otherwise the scalar test rejected a grazing hit due to rounding
+                        // difference, so spheres in the leaf are tested again one by one
+                    }
+
+                    for (uint32_t i = first; i < node.primitive_count; ++i)
+                    {
+                        if (ordered_objects_[node.offset + i]->Intersect(ray, t_min, t, isect_buf))
+                        {
+                            any_hit = true;
+                            t       = isect_buf.t;
+                        }
+                    }
+
+                    if (stack_size == 0)
+                    {
+                        break;
+                    }
+                    current = stack[--stack_size];
+                }
+                else
+                {
+                    // visit the near child first
+                    if (dir_is_neg[node.axis])
+                    {
+                        stack[stack_size++] = current + 1;
+                        current             = node.offset;
+                    }
+                    else
+                    {
+                        stack[stack_size++] = node.offset;
+                        current             = current + 1;
+                    }
+                }
+            }
+            else
+            {
+                if (stack_size == 0)
+                {
+                    break;
+                }
+                current = stack[--stack_size];
+            }
+        }
+
+        if (any_hit)
+        {
+            isect = isect_buf;
+        }
+        return any_hit;
+    }
+} // namespace akane
@@ -0,0 +1,107 @@
+#pragma once
+#include "akane/primitive.h"
+#include "akane/math/bounds.h"
+#include "akane/shape/sphere.h"
+#include "akane/shape/sphere_pack.h"
+#include <vector>
+
+namespace akane
+{
+    // bounding volume hierarchy built with surface area heuristic
+    //
+    // nodes are flattened in depth-first order so that the first child of an interior node
+    // always immediately follows its parent, and only the offset of the second child is stored
+    //
+    // spheres registered with AddSpherePrimitive are also packed into SoA buffers in leaf order
+    // so that a leaf tests all its spheres with one SIMD kernel call. A leaf holds up to as many
+    // spheres as the kernel is wide, and SAH counts a full batch of them as one intersection
+    class BvhComposite : public Composite
+    {
+    public:
+        static constexpr int kMaxPrimitiveInLeaf = 4; // besides packed spheres
+        static constexpr int kSahBucketCount     = 12;
+
+        // deeper nodes are split at the median, so that degenerate SAH splits can't grow the
+        // tree beyond the traversal stack
+        static constexpr int kMaxSahDepth        = 32;
+        static constexpr int kTraversalStackSize = 64;
+
+        void AddPrimitive(Primitive* body)
+        {
+            objects_.push_back(body);
+            sphere_ids_.push_back(-1);
+            dirty_ = true;
+        }
+
+        // add a primitive whose geometry is exactly the given sphere
+        void AddSpherePrimitive(Primitive* body, const shape::Sphere& sphere)
+        {
+            objects_.push_back(body);
+            sphere_ids_.push_back(static_cast<int>(spheres_.size()));
+            spheres_.push_back(sphere);
+            dirty_ = true;
+        }
+
+        // (re)build the hierarchy, this must be called after primitives are added
+        void Build();
+
+        bool Intersect(const Ray& ray, float t_min, float t_max,
+                       IntersectionInfo& isect) const override;
+
+        Bounds3 Bound() const noexcept
+        {
+            return nodes_.empty() ? Bounds3{} : Bounds3{nodes_[0].lower, nodes_[0].upper};
+        }
+
+    private:
+        struct BuildItem
+        {
+            Bounds3 bound;
+            Vec3 centroid;
+            Primitive* object;
+            int sphere_id;
+        };
+
+        // a node fits in exactly half a cache line
+        struct alignas(32) LinearNode
+        {
+            Vec3 lower;
+            Vec3 upper;
+
+            // leaf: index of the first primitive in ordered primitive list
+            // interior: index of the second child
+            uint32_t offset;
+
+            uint16_t primitive_count; // zero for interior node
+            uint8_t axis;             // split axis for interior node
+            uint8_t sphere_count;     // leading primitives of the leaf that are packed spheres
+        };
+
+        static_assert(sizeof(LinearNode) == 32);
+
+        uint32_t BuildRecursive(BuildItem* begin, BuildItem* end, int depth);
+
+        // returns nullptr if making a leaf is cheaper than any split
+        BuildItem* PartitionSah(BuildItem* begin, BuildItem* end, const Bounds3& bound,
+                                const Bounds3& centroid_bound, int axis, int sphere_count);
+
+        // whether primitives fit in a single leaf
+        bool FitInLeaf(int count, int sphere_count) const noexcept
+        {
+            return count - sphere_count <= kMaxPrimitiveInLeaf &&
+                   sphere_count <= max(kMaxPrimitiveInLeaf, sphere_width_);
+        }
+
+        bool dirty_       = false;
+        int sphere_width_ = 1; // spheres tested by one kernel call
+        std::vector<Primitive*> objects_;
+        std::vector<int> sphere_ids_; // index into spheres_ for each object, or -1
+        std::vector<shape::Sphere> spheres_;
+
+        std::vector<Primitive*> ordered_objects_;
+        std::vector<int> ordered_sphere_ids_;
+        std::vector<LinearNode> nodes_;
+
+        shape::SpherePack sphere_pack_; // indexed the same as ordered_objects_
+    };
+} // namespace akane
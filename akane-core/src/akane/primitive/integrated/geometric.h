@@ -7,6 +7,7 @@
 #include "akane/light/diffuse.h"
 #include "akane/ray.h"
 #include "akane/material.h"
+#include "akane/medium.h"
 
 namespace akane
 {
@@ -26,11 +27,21 @@ namespace akane
                 isect.object     = this;
                 isect.area_light = GetAreaLight();
                 isect.material   = GetMaterial();
+
+                if (bounds_medium_)
+                {
+                    isect.medium_interface = &medium_interface_;
+                }
             }
 
             return hit;
         }
 
+        Bounds3 Bound() const override
+        {
+            return geometry_.Bound();
+        }
+
         float Area() const override
         {
             return geometry_.Area();
@@ -49,6 +60,12 @@ namespace akane
         {
             area_light_ = make_unique<DiffuseAreaLight>(this, color, power);
         }
+        // the shape bounds media, whose lifetime is managed by the scene
+        void BindMedium(const Medium* inside, const Medium* outside)
+        {
+            medium_interface_ = MediumInterface{inside, outside};
+            bounds_medium_    = true;
+        }
 
         Material* GetMaterial() const noexcept
         {
@@ -64,5 +81,8 @@ namespace akane
 
         shared_ptr<Material> material_    = nullptr;
         unique_ptr<AreaLight> area_light_ = nullptr;
+
+        MediumInterface medium_interface_ = {};
+        bool bounds_medium_               = false;
     };
 } // namespace akane
\ No newline at end of file
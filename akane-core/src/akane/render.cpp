@@ -13,9 +13,20 @@ namespace akane
 
         RenderingContext ctx;
         auto working_canvas = std::make_shared<Canvas>(resolution[0], resolution[1]);
+        auto splat_film     = integrator.UseSplatFilm()
+                              ? std::make_shared<SplatFilm>(resolution[0], resolution[1])
+                              : nullptr;
+
+        ctx.camera     = &camera;
+        ctx.splat_film = splat_film.get();
 
         auto sampler = CreateRandomSampler(seed);
 
+        // a sample covers less than a pixel as samples accumulate, but the footprint is kept no
+        // smaller than 1/8 pixel so that texture lookups stay coherent
+        auto pixel_scale = max(.125f, 1.f / sqrt(static_cast<float>(sample_per_pixel)));
+        auto duv         = Vec2{pixel_scale / resolution[0], pixel_scale / resolution[1]};
+
         int ssp_per_batch =
             static_cast<int>(ceil(sample_per_pixel / min(sample_per_pixel * 1.f, 100.f)));
 
@@ -37,7 +48,7 @@ namespace akane
                     for (int i = 0; i < ssp_this_batch; ++i)
                     {
                         auto uv  = ComputeScreenSpaceUV({x, y}, resolution, sampler->Get2D());
-                        auto ray = camera.SpawnRay(uv);
+                        auto ray = camera.SpawnRayDifferential(uv, duv, sampler->Get1D());
 
                         radiance += integrator.Li(ctx, *sampler, scene, ray);
                     }
@@ -56,6 +67,10 @@ namespace akane
             {
                 result.ssp += ssp_this_batch;
                 result.canvas->Set(*working_canvas);
+                if (splat_film != nullptr)
+                {
+                    splat_film->Resolve(*result.canvas);
+                }
 
                 progress = static_cast<int>(result.ssp * 100.f / sample_per_pixel);
             }
@@ -1,10 +1,14 @@
 #include "akane/scene/embree.h"
 #include "akane/math/transform.h"
 #include "akane/light/diffuse.h"
+#include "akane/light/environment.h"
 #include "akane/material/generic.h"
 #include "akane/model.h"
+#include "akane/common/parallel.h"
+#include <limits>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 using namespace std;
 
@@ -54,7 +58,7 @@ namespace akane
             ray.dir_x = ak_ray.d.X();
             ray.dir_y = ak_ray.d.Y();
             ray.dir_z = ak_ray.d.Z();
-            ray.time  = 0.f;
+            ray.time  = ak_ray.time;
 
             ray.tfar  = kTravelDistanceMax;
             ray.mask  = 0u;
@@ -67,45 +71,148 @@ namespace akane
 
             return result;
         }
+
+        // intersect context passed through embree so that user geometry callbacks could hand
+        // back the full intersection record
+        struct EmbreeIntersectContext
+        {
+            RTCIntersectContext context; // must be the first member
+            IntersectionInfo* isect;
+        };
+
+        Ray CreateRayFromEmbree(const RTCRay& rtc_ray) noexcept
+        {
+            return Ray{{rtc_ray.org_x, rtc_ray.org_y, rtc_ray.org_z},
+                       {rtc_ray.dir_x, rtc_ray.dir_y, rtc_ray.dir_z}};
+        }
+
+        void BoundUserPrimitive(const RTCBoundsFunctionArguments* args)
+        {
+            auto object = static_cast<const Primitive*>(args->geometryUserPtr);
+            auto bound  = object->Bound();
+
+            auto& bounds_o   = *args->bounds_o;
+            bounds_o.lower_x = bound.lower.X();
+            bounds_o.lower_y = bound.lower.Y();
+            bounds_o.lower_z = bound.lower.Z();
+            bounds_o.upper_x = bound.upper.X();
+            bounds_o.upper_y = bound.upper.Y();
+            bounds_o.upper_z = bound.upper.Z();
+        }
+
+        // NOTE only rtcIntersect1/rtcOccluded1 are used, so a single ray is always passed in
+        void IntersectUserPrimitive(const RTCIntersectFunctionNArgs* args)
+        {
+            AKANE_ASSERT(args->N == 1);
+            if (!args->valid[0])
+            {
+                return;
+            }
+
+            auto object   = static_cast<const Primitive*>(args->geometryUserPtr);
+            auto context  = reinterpret_cast<EmbreeIntersectContext*>(args->context);
+            auto& rtc_ray = reinterpret_cast<RTCRayHit*>(args->rayhit)->ray;
+            auto& rtc_hit = reinterpret_cast<RTCRayHit*>(args->rayhit)->hit;
+
+            IntersectionInfo isect;
+            if (object->Intersect(CreateRayFromEmbree(rtc_ray), rtc_ray.tnear, rtc_ray.tfar,
+                                  isect))
+            {
+                rtc_ray.tfar = isect.t;
+
+                rtc_hit.Ng_x      = isect.ng.X();
+                rtc_hit.Ng_y      = isect.ng.Y();
+                rtc_hit.Ng_z      = isect.ng.Z();
+                rtc_hit.u         = isect.uv[0];
+                rtc_hit.v         = isect.uv[1];
+                rtc_hit.primID    = args->primID;
+                rtc_hit.geomID    = args->geomID;
+                rtc_hit.instID[0] = args->context->instID[0];
+
+                // embree only accepts closer hits, so the record always belongs to the closest
+                // user geometry found so far
+                *context->isect = isect;
+            }
+        }
+
+        void OccludedUserPrimitive(const RTCOccludedFunctionNArgs* args)
+        {
+            AKANE_ASSERT(args->N == 1);
+            if (!args->valid[0])
+            {
+                return;
+            }
+
+            auto object   = static_cast<const Primitive*>(args->geometryUserPtr);
+            auto& rtc_ray = *reinterpret_cast<RTCRay*>(args->ray);
+
+            IntersectionInfo isect;
+            if (object->Intersect(CreateRayFromEmbree(rtc_ray), rtc_ray.tnear, rtc_ray.tfar,
+                                  isect))
+            {
+                rtc_ray.tfar = -std::numeric_limits<float>::infinity();
+            }
+        }
     } // namespace
 
     struct EmbreeMeshBuffer
     {
+        // number of keyframes evenly distributed in [0, 1], where vertex and normal data of each
+        // keyframe are stored one after another
+        size_t time_step_count;
+
+        // vertex and normal data either point into the source mesh when no transform is
+        // applied, or into the storage owned by the buffer
         size_t vertex_count;
-        std::unique_ptr<float[]> vertex_data; // layouts: [x, y, z]...
+        const float* vertex_data; // layouts: [x, y, z]...
+        std::unique_ptr<float[]> vertex_storage;
 
         size_t normal_count;
-        std::unique_ptr<float[]> normal_data; // layouts: [x, y, z]...
+        const float* normal_data; // layouts: [x, y, z]...
+        std::unique_ptr<float[]> normal_storage;
 
-        size_t uv_count;
-        std::unique_ptr<float[]> uv_data; // layouts: [u, v]...
+        SharedArray<Point2f> uv_data;
 
         static constexpr size_t kVertexIndexStride = 3;
         static constexpr size_t kNormalIndexStride = 3;
-        static constexpr size_t kUVIndexStride     = 2;
 
-        Vec3 GetVertex(size_t index) const noexcept
+        Vec3 GetVertex(size_t index, float time = 0.f) const noexcept
         {
             AKANE_ASSERT(index < vertex_count);
 
-            const float* p = vertex_data.get() + index * kVertexIndexStride;
-            return {p[0], p[1], p[2]};
+            return Interpolate(vertex_data, vertex_count, index * kVertexIndexStride, time);
         }
 
-        Vec3 GetNormal(size_t index) const noexcept
+        Vec3 GetNormal(size_t index, float time = 0.f) const noexcept
         {
             AKANE_ASSERT(index < normal_count);
 
-            const float* p = normal_data.get() + index * kNormalIndexStride;
-            return {p[0], p[1], p[2]};
+            return Interpolate(normal_data, normal_count, index * kNormalIndexStride, time);
         }
 
         Vec2 GetUV(size_t index) const noexcept
         {
-            AKANE_ASSERT(index < uv_count);
+            AKANE_ASSERT(index < uv_data.size());
+
+            return PointToVec(uv_data[index]);
+        }
+
+        // linearly interpolate between the two keyframes around time, same as embree does
+        Vec3 Interpolate(const float* data, size_t count, size_t offset, float time) const noexcept
+        {
+            if (time_step_count == 1)
+            {
+                const float* p = data + offset;
+                return {p[0], p[1], p[2]};
+            }
 
-            const float* p = uv_data.get() + index * kUVIndexStride;
-            return {p[0], p[1]};
+            auto segment = time * static_cast<float>(time_step_count - 1);
+            auto step    = min(static_cast<size_t>(segment), time_step_count - 2);
+            auto k       = segment - static_cast<float>(step);
+
+            const float* p0 = data + step * 3 * count + offset;
+            const float* p1 = p0 + 3 * count;
+            return (1 - k) * Vec3{p0[0], p0[1], p0[2]} + k * Vec3{p1[0], p1[1], p1[2]};
         }
     };
 
@@ -114,18 +221,20 @@ namespace akane
         unsigned geom_id;
         const EmbreeMeshBuffer* mesh_buffer;
 
+        // index data are shared with the mesh desc without copying
         size_t triangle_count;
-        std::unique_ptr<uint32_t[]> triangle_indices; // layouts: [x, y, z]...
-        std::unique_ptr<uint32_t[]> normal_indices;   // layouts: [x, y, z]...
-        std::unique_ptr<uint32_t[]> uv_indices;       // layouts: [x, y, z]...
+        SharedArray<Point3i> triangle_indices;
+        SharedArray<Point3i> normal_indices;
+        SharedArray<Point3i> uv_indices;
 
         //
         std::vector<const AreaLight*> area_lights;
-        const Material* material;
+        std::vector<EmbreeTriangle*> light_primitives; // primitives bound to area_lights
+        const Material* material = nullptr;
 
-        static constexpr size_t kTriangleIndexStride = 3;
-        static constexpr size_t kNormalIndexStride   = 3;
-        static constexpr size_t kUVIndexStride       = 3;
+        // set if the mesh bounds media, where an invisible surface has no material
+        const MediumInterface* medium_interface = nullptr;
+        bool surface_visible                    = true;
 
         bool ContainAreaLight() const noexcept
         {
@@ -140,50 +249,59 @@ namespace akane
             return material;
         }
 
-        std::tuple<Vec3, Vec3, Vec3> GetTriangle(size_t index) const noexcept
+        std::tuple<Vec3, Vec3, Vec3> GetTriangle(size_t index, float time = 0.f) const noexcept
         {
             AKANE_ASSERT(index < triangle_count);
 
-            auto p = triangle_indices.get() + index * kTriangleIndexStride;
-            return {mesh_buffer->GetVertex(p[0]), mesh_buffer->GetVertex(p[1]),
-                    mesh_buffer->GetVertex(p[2])};
+            const auto& p = triangle_indices[index];
+            return {mesh_buffer->GetVertex(p[0], time), mesh_buffer->GetVertex(p[1], time),
+                    mesh_buffer->GetVertex(p[2], time)};
         }
 
         bool HasVertexNormal() const noexcept
         {
-            return normal_indices != nullptr;
+            return !normal_indices.empty();
         }
-        std::tuple<Vec3, Vec3, Vec3> GetVertexNormal(size_t index) const noexcept
+        std::tuple<Vec3, Vec3, Vec3> GetVertexNormal(size_t index,
+                                                     float time = 0.f) const noexcept
         {
-            AKANE_ASSERT(normal_indices != nullptr && index < triangle_count);
+            AKANE_ASSERT(HasVertexNormal() && index < triangle_count);
 
-            auto p = normal_indices.get() + index * kNormalIndexStride;
-            return {mesh_buffer->GetNormal(p[0]), mesh_buffer->GetNormal(p[1]),
-                    mesh_buffer->GetNormal(p[2])};
+            const auto& p = normal_indices[index];
+            return {mesh_buffer->GetNormal(p[0], time), mesh_buffer->GetNormal(p[1], time),
+                    mesh_buffer->GetNormal(p[2], time)};
         }
 
         bool HasVertexUV() const noexcept
         {
-            return uv_indices != nullptr;
+            return !uv_indices.empty();
         }
         std::tuple<Vec2, Vec2, Vec2> GetVertexUV(size_t index) const noexcept
         {
-            AKANE_ASSERT(uv_indices != nullptr && index < triangle_count);
+            AKANE_ASSERT(HasVertexUV() && index < triangle_count);
 
-            auto p = uv_indices.get() + index * kUVIndexStride;
+            const auto& p = uv_indices[index];
             return {mesh_buffer->GetUV(p[0]), mesh_buffer->GetUV(p[1]), mesh_buffer->GetUV(p[2])};
         }
     };
 
-    EmbreeScene::EmbreeScene()
+    EmbreeScene::EmbreeScene(bool dynamic)
     {
         auto device = GetEmbreeDevice();
 
         scene_ = rtcNewScene(device);
+
+        // top-level BVH is rebuilt on every commit, so favor build speed over traversal speed
+        if (dynamic)
+        {
+            rtcSetSceneFlags(scene_, RTC_SCENE_FLAG_DYNAMIC);
+            rtcSetSceneBuildQuality(scene_, RTC_BUILD_QUALITY_LOW);
+        }
     }
 
     EmbreeScene::~EmbreeScene()
     {
+        ReleaseRetiredMeshes();
         rtcReleaseScene(scene_);
     }
 
@@ -191,21 +309,43 @@ namespace akane
     {
         Scene::Commit();
         rtcCommitScene(scene_);
+
+        // replaced meshes are no longer referenced by the committed scene
+        ReleaseRetiredMeshes();
+    }
+
+    Bounds3 EmbreeScene::Bound() const
+    {
+        RTCBounds bounds;
+        rtcGetSceneBounds(scene_, &bounds);
+
+        return Bounds3{Vec3{bounds.lower_x, bounds.lower_y, bounds.lower_z},
+                       Vec3{bounds.upper_x, bounds.upper_y, bounds.upper_z}};
     }
 
     bool EmbreeScene::Intersect(const Ray& ray, Workspace& workspace, IntersectionInfo& isect) const
     {
-        RTCIntersectContext ctx;
-        rtcInitIntersectContext(&ctx);
+        IntersectionInfo user_isect;
+
+        EmbreeIntersectContext ctx;
+        rtcInitIntersectContext(&ctx.context);
+        ctx.isect = &user_isect;
 
         RTCRayHit ray_hit = CreateEmptyRayHit(ray);
 
-        rtcIntersect1(scene_, &ctx, &ray_hit);
+        rtcIntersect1(scene_, &ctx.context, &ray_hit);
         auto geom_id = ray_hit.hit.geomID;
         auto prim_id = ray_hit.hit.primID;
 
         if (geom_id != RTC_INVALID_GEOMETRY_ID && prim_id != RTC_INVALID_GEOMETRY_ID)
         {
+            // user geometry has already filled in the intersection in callback
+            if (user_objects_[geom_id] != nullptr)
+            {
+                isect = user_isect;
+                return true;
+            }
+
             auto geometry = geoms_[geom_id];
 
             isect.t = ray_hit.ray.tfar;
@@ -217,7 +357,7 @@ namespace akane
             // override shading normal
             if (geometry->HasVertexNormal())
             {
-                auto [n0, n1, n2] = geometry->GetVertexNormal(prim_id);
+                auto [n0, n1, n2] = geometry->GetVertexNormal(prim_id, ray.time);
 
                 auto uu = ray_hit.hit.u;
                 auto vv = ray_hit.hit.v;
@@ -240,22 +380,43 @@ namespace akane
                 auto ww = 1 - uu - vv;
 
                 isect.uv = ww * uv0 + uu * uv1 + vv * uv2;
+
+                // solve dp02 = dpdu * duv02[0] + dpdv * duv02[1], and the same for dp12
+                auto [p0, p1, p2] = geometry->GetTriangle(prim_id, ray.time);
+
+                auto duv02 = uv0 - uv2;
+                auto duv12 = uv1 - uv2;
+                auto dp02  = p0 - p2;
+                auto dp12  = p1 - p2;
+                auto det   = duv02[0] * duv12[1] - duv02[1] * duv12[0];
+                if (abs(det) > 1e-12f)
+                {
+                    isect.dpdu = (duv12[1] * dp02 - duv02[1] * dp12) / det;
+                    isect.dpdv = (duv02[0] * dp12 - duv12[0] * dp02) / det;
+                }
             }
             else
             {
                 isect.uv = {ray_hit.hit.u, ray_hit.hit.v};
+
+                // barycentric coordinates, where vertex 1 is at u = 1 and vertex 2 at v = 1
+                auto [p0, p1, p2] = geometry->GetTriangle(prim_id, ray.time);
+
+                isect.dpdu = p1 - p0;
+                isect.dpdv = p2 - p0;
             }
 
             isect.index = prim_id;
 
-            isect.object = InstantiateTemporaryPrimitive(workspace, geom_id, prim_id);
+            isect.object = InstantiateTemporaryPrimitive(workspace, geom_id, prim_id, ray.time);
 
             if (geometry->ContainAreaLight())
             {
                 isect.area_light = geometry->GetAreaLight(prim_id);
             }
 
-            isect.material = geometry->material;
+            isect.material         = geometry->surface_visible ? geometry->material : nullptr;
+            isect.medium_interface = geometry->medium_interface;
 
             return true;
         }
@@ -265,146 +426,342 @@ namespace akane
         }
     }
 
-    void ParseMeshBuffer(EmbreeMeshBuffer& mesh_buffer, const MeshDesc& mesh_data,
-                         const Transform& transform)
+    // number of vertices transformed by a single task
+    constexpr size_t kTransformGrainSize = 1 << 16;
+
+    // write transformed vertex and normal data of every keyframe into storage of the buffer
+    void TransformMeshBuffer(EmbreeMeshBuffer& mesh_buffer, const SharedArray<Point3f>& vertices,
+                             const SharedArray<Point3f>& normals,
+                             const std::vector<Transform>& keyframes)
     {
+        AKANE_REQUIRE(keyframes.size() == mesh_buffer.time_step_count);
+        AKANE_REQUIRE(vertices.size() == mesh_buffer.vertex_count);
+        AKANE_REQUIRE(normals.size() == mesh_buffer.normal_count);
+
+        auto time_step_count = keyframes.size();
+
         // copy vertex data
         {
-            size_t vertex_count      = mesh_data.vertices.size();
-            mesh_buffer.vertex_count = vertex_count;
-            mesh_buffer.vertex_data  = std::make_unique<float[]>(3 * vertex_count + 1);
+            if (mesh_buffer.vertex_storage == nullptr)
+            {
+                mesh_buffer.vertex_storage =
+                    std::make_unique<float[]>(3 * vertices.size() * time_step_count + 1);
+            }
 
-            auto p = mesh_buffer.vertex_data.get();
-            for (const auto& vertex : mesh_data.vertices)
+            auto p = mesh_buffer.vertex_storage.get();
+            for (const auto& transform : keyframes)
             {
-                auto transformed = transform.Apply(PointToVec(vertex));
+                ParallelFor(vertices.size(), kTransformGrainSize, [&](size_t begin, size_t end) {
+                    for (auto i = begin; i < end; ++i)
+                    {
+                        auto transformed = transform.Apply(PointToVec(vertices[i]));
+
+                        p[3 * i]     = transformed.X();
+                        p[3 * i + 1] = transformed.Y();
+                        p[3 * i + 2] = transformed.Z();
+                    }
+                });
 
-                *(p++) = transformed.X();
-                *(p++) = transformed.Y();
-                *(p++) = transformed.Z();
+                p += 3 * vertices.size();
             }
 
             *p = 0.f;
+
+            mesh_buffer.vertex_data = mesh_buffer.vertex_storage.get();
         }
 
         // copy normal data
+        if (!normals.empty())
         {
-            size_t normal_count      = mesh_data.normals.size();
-            mesh_buffer.normal_count = normal_count;
-
-            if (normal_count > 0)
+            if (mesh_buffer.normal_storage == nullptr)
             {
-                mesh_buffer.normal_data = std::make_unique<float[]>(3 * normal_count + 1);
+                mesh_buffer.normal_storage =
+                    std::make_unique<float[]>(3 * normals.size() * time_step_count + 1);
+            }
 
-                auto p = mesh_buffer.normal_data.get();
-                for (const auto& normal : mesh_data.normals)
-                {
-                    auto transformed = transform.ApplyLinear(PointToVec(normal));
+            auto p = mesh_buffer.normal_storage.get();
+            for (const auto& transform : keyframes)
+            {
+                ParallelFor(normals.size(), kTransformGrainSize, [&](size_t begin, size_t end) {
+                    for (auto i = begin; i < end; ++i)
+                    {
+                        auto transformed = transform.ApplyLinear(PointToVec(normals[i]));
 
-                    *(p++) = transformed.X();
-                    *(p++) = transformed.Y();
-                    *(p++) = transformed.Z();
-                }
+                        p[3 * i]     = transformed.X();
+                        p[3 * i + 1] = transformed.Y();
+                        p[3 * i + 2] = transformed.Z();
+                    }
+                });
 
-                *p = 0.f;
-            }
-            else
-            {
-                mesh_buffer.normal_data = nullptr;
+                p += 3 * normals.size();
             }
+
+            *p = 0.f;
+
+            mesh_buffer.normal_data = mesh_buffer.normal_storage.get();
         }
+    }
 
-        // copy uv data
+    // one vertex buffer slot for each keyframe
+    void BindVertexBuffers(RTCGeometry rtc_geom, const EmbreeMeshBuffer& mesh_buffer)
+    {
+        for (unsigned i = 0; i < mesh_buffer.time_step_count; ++i)
         {
-            size_t uv_count      = mesh_data.uv.size();
-            mesh_buffer.uv_count = uv_count;
+            rtcSetSharedGeometryBuffer(rtc_geom, RTC_BUFFER_TYPE_VERTEX, i, RTC_FORMAT_FLOAT3,
+                                       mesh_buffer.vertex_data,
+                                       i * 3 * 4 * mesh_buffer.vertex_count, 3 * 4,
+                                       mesh_buffer.vertex_count);
+        }
+    }
 
-            if (uv_count > 0)
-            {
-                mesh_buffer.uv_data = std::make_unique<float[]>(2 * uv_count + 1);
+    void ParseMeshBuffer(EmbreeMeshBuffer& mesh_buffer, const MeshDesc& mesh_data,
+                         const std::vector<Transform>& keyframes)
+    {
+        static_assert(sizeof(Point3f) == 3 * sizeof(float));
 
-                auto p = mesh_buffer.uv_data.get();
-                for (const auto& uv : mesh_data.uv)
-                {
-                    *(p++) = uv[0];
-                    *(p++) = uv[1];
-                }
+        mesh_buffer.time_step_count = keyframes.size();
+        mesh_buffer.vertex_count    = mesh_data.vertices.size();
+        mesh_buffer.normal_count    = mesh_data.normals.size();
+        mesh_buffer.uv_data         = mesh_data.uv;
 
-                *p = 0.f;
-            }
-            else
-            {
-                mesh_buffer.uv_data = nullptr;
-            }
+        // a static mesh without transform is used in place, which is usually memory-mapped
+        if (keyframes.size() == 1 && keyframes[0].IsIdentity())
+        {
+            mesh_buffer.vertex_data = reinterpret_cast<const float*>(mesh_data.vertices.data());
+            mesh_buffer.normal_data = reinterpret_cast<const float*>(mesh_data.normals.data());
+        }
+        else
+        {
+            TransformMeshBuffer(mesh_buffer, mesh_data.vertices, mesh_data.normals, keyframes);
         }
     }
 
     void ParseMeshGeometry(EmbreeMeshGeometry& geometry, const GeometryDesc& geom_desc)
     {
-        auto triangle_count = geom_desc.triangle_indices.size();
+        static_assert(sizeof(Point3i) == 3 * sizeof(uint32_t));
+
+        // AKANE_REQUIRE(geom_desc.normal_indices.size() == triangle_count);
+        // AKANE_REQUIRE(geom_desc.uv_indices.size() == triangle_count);
+        geometry.triangle_count   = geom_desc.triangle_indices.size();
+        geometry.triangle_indices = geom_desc.triangle_indices;
+        geometry.normal_indices   = geom_desc.normal_indices;
+        geometry.uv_indices       = geom_desc.uv_indices;
+    }
+
+    // a mesh added by AddMesh/AddMovingMesh, which is tracked for incremental updates
+    struct EmbreeMeshInstance
+    {
+        // untransformed data kept to recompute vertex and normal buffer when moved
+        SharedArray<Point3f> vertices;
+        SharedArray<Point3f> normals;
+        std::vector<Transform> keyframes;
+
+        // geometries, lights and materials are allocated here, so that the storage is dropped
+        // as a whole when the mesh is replaced
+        std::unique_ptr<Arena> arena;
+
+        EmbreeMeshBuffer* mesh_buffer;
+        std::vector<EmbreeMeshGeometry*> geometries;
+        std::vector<GenericMaterial*> materials;
+
+        // media bound by SetMeshMedium, kept when the mesh is replaced
+        MediumInterface medium_interface;
+        bool bounds_medium   = false;
+        bool surface_visible = true;
+
+        bool enabled = true;
+    };
+
+    std::unordered_set<const Light*> CollectAreaLights(const EmbreeMeshInstance& mesh)
+    {
+        std::unordered_set<const Light*> result;
+        for (auto geometry : mesh.geometries)
+        {
+            result.insert(geometry->area_lights.begin(), geometry->area_lights.end());
+        }
+
+        return result;
+    }
+
+    void ApplyMeshMedium(EmbreeMeshGeometry& geometry, const EmbreeMeshInstance& mesh)
+    {
+        if (mesh.bounds_medium)
+        {
+            geometry.medium_interface = &mesh.medium_interface;
+            geometry.surface_visible  = mesh.surface_visible;
+        }
+    }
+
+    EmbreeScene::MeshHandle EmbreeScene::AddMesh(const MeshDesc& mesh_desc,
+                                                 const Transform& transform)
+    {
+        return AddMovingMesh(mesh_desc, {transform});
+    }
+
+    EmbreeScene::MeshHandle EmbreeScene::AddMovingMesh(const MeshDesc& mesh_desc,
+                                                       const std::vector<Transform>& keyframes)
+    {
+        AKANE_REQUIRE(!keyframes.empty());
+
+        auto mesh       = arena_.Construct<EmbreeMeshInstance>();
+        mesh->keyframes = keyframes;
+        CreateMeshGeometries(*mesh, mesh_desc);
+
+        meshes_.push_back(mesh);
+        return meshes_.size() - 1;
+    }
+
+    void EmbreeScene::UpdateMeshTransform(MeshHandle handle,
+                                          const std::vector<Transform>& keyframes)
+    {
+        auto& mesh = *meshes_.at(handle);
+        AKANE_REQUIRE(keyframes.size() == mesh.keyframes.size());
+
+        mesh.keyframes = keyframes;
+        TransformMeshBuffer(*mesh.mesh_buffer, mesh.vertices, mesh.normals, keyframes);
 
-        // copy triangle indices
+        // topology is unchanged, so the geometry BVHs are refitted rather than rebuilt
+        // NOTE vertex buffers are bound again as they may have moved into owned storage
+        for (auto geometry : mesh.geometries)
         {
-            geometry.triangle_count   = triangle_count;
-            geometry.triangle_indices = std::make_unique<uint32_t[]>(3 * triangle_count + 1);
+            auto rtc_geom = rtcGetGeometry(scene_, geometry->geom_id);
+            rtcSetGeometryBuildQuality(rtc_geom, RTC_BUILD_QUALITY_REFIT);
+            BindVertexBuffers(rtc_geom, *mesh.mesh_buffer);
+            rtcCommitGeometry(rtc_geom);
 
-            auto p = geometry.triangle_indices.get();
-            for (const auto& triangle : geom_desc.triangle_indices)
+            // cached triangles of area lights have moved as well
+            for (size_t i = 0; i < geometry->light_primitives.size(); ++i)
             {
-                *(p++) = triangle[0];
-                *(p++) = triangle[1];
-                *(p++) = triangle[2];
+                CreatePrimitiveAux(*geometry->light_primitives[i], geometry->geom_id, i);
             }
-
-            *p = 0.f;
         }
+    }
 
-        // copy normal indices if presented
-        if (!geom_desc.normal_indices.empty())
+    void EmbreeScene::SetMeshEnabled(MeshHandle handle, bool enabled)
+    {
+        auto& mesh = *meshes_.at(handle);
+        if (mesh.enabled == enabled)
         {
-            // AKANE_REQUIRE(geom_desc.normal_indices.size() == triangle_count);
+            return;
+        }
 
-            geometry.normal_indices = std::make_unique<uint32_t[]>(3 * triangle_count + 1);
+        mesh.enabled = enabled;
+        for (auto geometry : mesh.geometries)
+        {
+            auto rtc_geom = rtcGetGeometry(scene_, geometry->geom_id);
+            if (enabled)
+            {
+                rtcEnableGeometry(rtc_geom);
+            }
+            else
+            {
+                rtcDisableGeometry(rtc_geom);
+            }
 
-            auto p = geometry.normal_indices.get();
-            for (const auto& normal : geom_desc.normal_indices)
+            // disabled mesh should neither emit light
+            if (enabled)
             {
-                *(p++) = normal[0];
-                *(p++) = normal[1];
-                *(p++) = normal[2];
+                for (auto light : geometry->area_lights)
+                {
+                    RegisterLight(const_cast<AreaLight*>(light));
+                }
             }
+        }
 
-            *p = 0.f;
+        if (!enabled)
+        {
+            UnregisterLights(CollectAreaLights(mesh));
         }
+    }
+
+    void EmbreeScene::ReplaceMesh(MeshHandle handle, const MeshDesc& mesh_desc)
+    {
+        auto& mesh = *meshes_.at(handle);
 
-        // copy uv indices if presented
-        if (!geom_desc.uv_indices.empty())
+        if (mesh.enabled)
         {
-            // AKANE_REQUIRE(geom_desc.uv_indices.size() == triangle_count);
+            UnregisterLights(CollectAreaLights(mesh));
+        }
 
-            geometry.uv_indices = std::make_unique<uint32_t[]>(3 * triangle_count + 1);
+        // old geometries are detached while their memory is kept until the next Commit(), as
+        // the scene built before may still be in use. The reference taken by rtcNewGeometry
+        // keeps a detached geometry alive until then
+        for (auto geometry : mesh.geometries)
+        {
+            retired_geometries_.push_back(rtcGetGeometry(scene_, geometry->geom_id));
 
-            auto p = geometry.uv_indices.get();
-            for (const auto& uv : geom_desc.uv_indices)
-            {
-                *(p++) = uv[0];
-                *(p++) = uv[1];
-                *(p++) = uv[2];
-            }
+            rtcDetachGeometry(scene_, geometry->geom_id);
+            geoms_[geometry->geom_id] = nullptr;
+        }
 
-            *p = 0.f;
+        for (auto material : mesh.materials)
+        {
+            UnregisterMaterial(material);
+        }
+
+        mesh.geometries.clear();
+        mesh.materials.clear();
+        retired_arenas_.push_back(std::move(mesh.arena));
+        CreateMeshGeometries(mesh, mesh_desc);
+
+        if (!mesh.enabled)
+        {
+            mesh.enabled = true;
+            SetMeshEnabled(handle, false);
+        }
+    }
+
+    void EmbreeScene::SetMeshMedium(MeshHandle handle, shared_ptr<Medium> interior,
+                                    shared_ptr<Medium> exterior, bool surface_visible)
+    {
+        auto& mesh = *meshes_.at(handle);
+
+        mesh.medium_interface = MediumInterface{interior.get(), exterior.get()};
+        mesh.bounds_medium    = true;
+        mesh.surface_visible  = surface_visible;
+        for (auto geometry : mesh.geometries)
+        {
+            ApplyMeshMedium(*geometry, mesh);
+        }
+
+        RegisterMedium(move(interior));
+        RegisterMedium(move(exterior));
+    }
+
+    std::vector<GenericMaterial*> EmbreeScene::GetEditMaterials() const
+    {
+        std::vector<GenericMaterial*> result;
+        for (auto mesh : meshes_)
+        {
+            result.insert(result.end(), mesh->materials.begin(), mesh->materials.end());
         }
+
+        return result;
+    }
+
+    void EmbreeScene::AddEnvironmentMap(const std::string& filename, float scale,
+                                        Vec3 world_center, float world_radius)
+    {
+        RegisterLight(
+            arena_.Construct<EnvironmentLight>(filename, scale, world_center, world_radius), true);
     }
 
-    void EmbreeScene::AddMesh(const MeshDesc& mesh_desc, const Transform& transform)
+    void EmbreeScene::CreateMeshGeometries(EmbreeMeshInstance& mesh, const MeshDesc& mesh_desc)
     {
-        auto mesh_buffer = arena_.Construct<EmbreeMeshBuffer>();
-        ParseMeshBuffer(*mesh_buffer, mesh_desc, transform);
+        mesh.vertices = mesh_desc.vertices;
+        mesh.normals  = mesh_desc.normals;
+        mesh.arena    = std::make_unique<Arena>();
+
+        auto& arena      = *mesh.arena;
+        auto mesh_buffer = arena.Construct<EmbreeMeshBuffer>();
+        ParseMeshBuffer(*mesh_buffer, mesh_desc, mesh.keyframes);
+
+        mesh.mesh_buffer = mesh_buffer;
 
         unordered_map<string, GenericMaterial*> material_cache;
         for (const auto& geom_desc : mesh_desc.geomtries)
         {
-            auto geometry = arena_.Construct<EmbreeMeshGeometry>();
+            auto geometry = arena.Construct<EmbreeMeshGeometry>();
             ParseMeshGeometry(*geometry, *geom_desc);
 
             geometry->mesh_buffer = mesh_buffer;
@@ -413,6 +770,9 @@ namespace akane
             auto geom_id      = RegisterMeshGeometry(geometry);
             geometry->geom_id = geom_id;
 
+            mesh.geometries.push_back(geometry);
+            ApplyMeshMedium(*geometry, mesh);
+
             // load material and light
             if (geom_desc->material != nullptr)
             {
@@ -422,30 +782,36 @@ namespace akane
                     size_t triangle_count = geom_desc->triangle_indices.size();
                     for (size_t i = 0; i < triangle_count; ++i)
                     {
-                        auto primitive = InstantiatePrimitive(geom_id, i);
-                        auto light     = arena_.Construct<DiffuseAreaLight>(
+                        auto primitive = InstantiatePrimitive(arena, geom_id, i);
+                        auto light     = arena.Construct<DiffuseAreaLight>(
                             primitive, material_desc.emission.Normalized(),
                             material_desc.emission.Length());
 
                         RegisterLight(light);
                         geometry->area_lights.push_back(light);
+                        geometry->light_primitives.push_back(primitive);
                     }
                 }
 
                 auto& cached_material = material_cache[material_desc.name];
                 if (cached_material == nullptr)
                 {
-                    cached_material                    = arena_.Construct<GenericMaterial>();
+                    cached_material                    = arena.Construct<GenericMaterial>();
 
                     cached_material->name_             = material_desc.name;
                     cached_material->kd_               = material_desc.kd;
                     cached_material->ks_               = material_desc.ks;
                     cached_material->tr_               = material_desc.tr;
                     cached_material->roughness_        = material_desc.roughness;
+                    cached_material->anisotropy_       = material_desc.anisotropy;
                     cached_material->eta_in_           = material_desc.eta;
                     cached_material->eta_out_          = 1.f;
-                    cached_material->texture_diffuse_  = material_desc.diffuse_texture;
-                    cached_material->texture_specular_ = material_desc.specular_texture;
+                    cached_material->abbe_             = material_desc.abbe;
+                    cached_material->texture_diffuse_  = material_desc.diffuse_texture.Get();
+                    cached_material->texture_specular_ = material_desc.specular_texture.Get();
+
+                    mesh.materials.push_back(cached_material);
+                    RegisterMaterial(cached_material);
                 }
 
                 geometry->material = cached_material;
@@ -520,7 +886,7 @@ namespace akane
 
         RegisterMeshGeometry(geometry);
 
-        auto primitive = InstantiatePrimitive(geometry->geom_id, 0);
+        auto primitive = InstantiatePrimitive(arena_, geometry->geom_id, 0);
 
         geometry->material = nullptr;
         geometry->area_lights = { CreateLight_Area(primitive, albedo) };
@@ -537,13 +903,12 @@ namespace akane
             rtcNewGeometry(GetEmbreeDevice(), RTCGeometryType::RTC_GEOMETRY_TYPE_TRIANGLE);
 
         // register vertex buffer
-        rtcSetSharedGeometryBuffer(rtc_geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3,
-                                   mesh_buffer->vertex_data.get(), 0, 3 * 4,
-                                   mesh_buffer->vertex_count);
+        rtcSetGeometryTimeStepCount(rtc_geom, static_cast<unsigned>(mesh_buffer->time_step_count));
+        BindVertexBuffers(rtc_geom, *mesh_buffer);
 
         // register triangle buffer
         rtcSetSharedGeometryBuffer(rtc_geom, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3,
-                                   geometry->triangle_indices.get(), 0, 3 * 4,
+                                   geometry->triangle_indices.data(), 0, 3 * 4,
                                    geometry->triangle_count);
 
         // finalize
@@ -555,34 +920,71 @@ namespace akane
         // register id
         geometry->geom_id = id;
         this->geoms_.push_back(geometry);
+        this->user_objects_.push_back(nullptr);
+
+        return id;
+    }
+
+    unsigned EmbreeScene::RegisterUserGeometry(const Primitive* object)
+    {
+        auto id = this->geoms_.size();
+
+        // each analytic primitive is a user geometry with exactly one primitive
+        auto rtc_geom = rtcNewGeometry(GetEmbreeDevice(), RTCGeometryType::RTC_GEOMETRY_TYPE_USER);
+
+        rtcSetGeometryUserPrimitiveCount(rtc_geom, 1);
+        rtcSetGeometryUserData(rtc_geom, const_cast<Primitive*>(object));
+        rtcSetGeometryBoundsFunction(rtc_geom, BoundUserPrimitive, nullptr);
+        rtcSetGeometryIntersectFunction(rtc_geom, IntersectUserPrimitive);
+        rtcSetGeometryOccludedFunction(rtc_geom, OccludedUserPrimitive);
+
+        // finalize
+        rtcCommitGeometry(rtc_geom);
+        rtcAttachGeometryByID(this->scene_, rtc_geom, id);
+
+        // register id
+        this->geoms_.push_back(nullptr);
+        this->user_objects_.push_back(object);
 
         return id;
     }
 
-    Primitive* EmbreeScene::InstantiatePrimitive(unsigned geom_id, unsigned prim_id)
+    EmbreeTriangle* EmbreeScene::InstantiatePrimitive(Arena& arena, unsigned geom_id,
+                                                      unsigned prim_id)
     {
-        auto p = arena_.Construct<EmbreeTriangle>();
+        auto p = arena.Construct<EmbreeTriangle>();
         CreatePrimitiveAux(*p, geom_id, prim_id);
 
         return p;
     }
 
+    void EmbreeScene::ReleaseRetiredMeshes()
+    {
+        for (auto rtc_geom : retired_geometries_)
+        {
+            rtcReleaseGeometry(rtc_geom);
+        }
+
+        retired_geometries_.clear();
+        retired_arenas_.clear();
+    }
+
     Primitive* EmbreeScene::InstantiateTemporaryPrimitive(Workspace& workspace, unsigned geom_id,
-                                                          unsigned prim_id) const
+                                                          unsigned prim_id, float time) const
     {
         auto p = workspace.Construct<EmbreeTriangle>();
-        CreatePrimitiveAux(*p, geom_id, prim_id);
+        CreatePrimitiveAux(*p, geom_id, prim_id, time);
 
         return p;
     }
 
-    void EmbreeScene::CreatePrimitiveAux(EmbreeTriangle& p, unsigned geom_id,
-                                         unsigned prim_id) const
+    void EmbreeScene::CreatePrimitiveAux(EmbreeTriangle& p, unsigned geom_id, unsigned prim_id,
+                                         float time) const
     {
         p.geom_id_ = geom_id;
         p.prim_id_ = prim_id;
 
-        auto [v0, v1, v2] = geoms_.at(geom_id)->GetTriangle(prim_id);
+        auto [v0, v1, v2] = geoms_.at(geom_id)->GetTriangle(prim_id, time);
         p.v0_             = v0;
         p.e1_             = v1 - v0;
         p.e2_             = v2 - v0;
@@ -8,19 +8,27 @@
 #include "akane/texture.h"
 #include "akane/primitive.h"
 #include "akane/primitive/embree/triangle.h"
+#include "akane/primitive/integrated/geometric.h"
 
 #include <embree3/rtcore.h>
 #include <memory>
+#include <vector>
 
 namespace akane
 {
     struct EmbreeMeshBuffer;
     struct EmbreeMeshGeometry;
+    struct EmbreeMeshInstance;
+    class GenericMaterial;
 
     class EmbreeScene : public Scene
     {
     public:
-        EmbreeScene();
+        // identifies a mesh added into the scene for incremental updates
+        using MeshHandle = size_t;
+
+        // dynamic scene is optimized for frequent updates, e.g. interactive editing
+        explicit EmbreeScene(bool dynamic = false);
         ~EmbreeScene();
 
         void Commit() override;
@@ -28,7 +36,75 @@ namespace akane
         bool Intersect(const Ray& ray, Workspace& workspace,
                        IntersectionInfo& isect) const override;
 
-        void AddMesh(const MeshDesc& mesh_desc, const Transform& transform = Transform::Identity());
+        Bounds3 Bound() const override;
+
+        MeshHandle AddMesh(const MeshDesc& mesh_desc,
+                           const Transform& transform = Transform::Identity());
+
+        // add a mesh moving through keyframes evenly distributed in the frame, vertices are
+        // linearly interpolated between adjacent keyframes
+        MeshHandle AddMovingMesh(const MeshDesc& mesh_desc,
+                                 const std::vector<Transform>& keyframes);
+
+        // incremental updates, only geometries of the mesh are touched and Commit() must be
+        // called afterwards
+
+        // move the mesh, keyframe count must not change
+        void UpdateMeshTransform(MeshHandle handle, const std::vector<Transform>& keyframes);
+        void SetMeshEnabled(MeshHandle handle, bool enabled);
+        // replace geometries and materials of the mesh while keeping its transform
+        void ReplaceMesh(MeshHandle handle, const MeshDesc& mesh_desc);
+        // fill the mesh, which should be closed, with the interior medium. Its surface is an
+        // invisible boundary between the media unless surface_visible is set
+        void SetMeshMedium(MeshHandle handle, shared_ptr<Medium> interior,
+                           shared_ptr<Medium> exterior, bool surface_visible = false);
+
+        // materials that could be edited in place, changes are visible after the next Commit()
+        std::vector<GenericMaterial*> GetEditMaterials() const;
+
+        // analytic shapes are registered as embree user geometries so that they share the same
+        // BVH with triangle meshes
+        template <typename ShapeType>
+        void AddGeometricPrimitive(ShapeType shape, shared_ptr<Material> mat)
+        {
+            auto object = arena_.Construct<GeometricPrimitive<ShapeType>>(shape);
+            RegisterMaterial(mat.get());
+            object->BindMaterial(move(mat));
+
+            RegisterUserGeometry(object);
+        }
+
+        // shape filled with the interior medium, whose surface is an invisible boundary unless a
+        // material is given
+        template <typename ShapeType>
+        void AddGeometricMedium(ShapeType shape, shared_ptr<Medium> interior,
+                                shared_ptr<Medium> exterior = nullptr,
+                                shared_ptr<Material> mat    = nullptr)
+        {
+            auto object = arena_.Construct<GeometricPrimitive<ShapeType>>(shape);
+            RegisterMaterial(mat.get());
+            object->BindMaterial(move(mat));
+            object->BindMedium(interior.get(), exterior.get());
+            RegisterMedium(move(interior));
+            RegisterMedium(move(exterior));
+
+            RegisterUserGeometry(object);
+        }
+
+        template <typename ShapeType>
+        void AddGeometricLight(ShapeType shape, Vec3 color, float power)
+        {
+            auto object = arena_.Construct<GeometricPrimitive<ShapeType>>(shape);
+
+            object->BindAreaLight(color, power);
+            RegisterLight(object->GetAreaLight());
+
+            RegisterUserGeometry(object);
+        }
+
+        // lat-long HDR image surrounding the world as global light
+        void AddEnvironmentMap(const std::string& filename, float scale, Vec3 world_center,
+                               float world_radius);
 
         // for testing
         void AddGround(float z, shared_ptr<Texture3D> tex);
@@ -36,17 +112,29 @@ namespace akane
                               const Spectrum& color);
 
     private:
+        void CreateMeshGeometries(EmbreeMeshInstance& mesh, const MeshDesc& mesh_desc);
+
         unsigned RegisterMeshGeometry(EmbreeMeshGeometry* geometry);
+        unsigned RegisterUserGeometry(const Primitive* object);
 
-        Primitive* InstantiatePrimitive(unsigned geom_id, unsigned prim_id);
+        EmbreeTriangle* InstantiatePrimitive(Arena& arena, unsigned geom_id, unsigned prim_id);
         Primitive* InstantiateTemporaryPrimitive(Workspace& workspace, unsigned geom_id,
-                                                 unsigned prim_id) const;
+                                                 unsigned prim_id, float time) const;
 
-        void CreatePrimitiveAux(EmbreeTriangle& p, unsigned geom_id, unsigned prim_id) const;
+        void ReleaseRetiredMeshes();
+
+        void CreatePrimitiveAux(EmbreeTriangle& p, unsigned geom_id, unsigned prim_id,
+                                float time = 0.f) const;
 
         Arena arena_;
 
         RTCScene scene_;
-        std::vector<const EmbreeMeshGeometry*> geoms_;
+        std::vector<const EmbreeMeshGeometry*> geoms_; // nullptr for user geometry
+        std::vector<const Primitive*> user_objects_;   // nullptr for mesh geometry
+        std::vector<EmbreeMeshInstance*> meshes_;
+
+        // storage of replaced meshes, released once the scene is committed again
+        std::vector<std::unique_ptr<Arena>> retired_arenas_;
+        std::vector<RTCGeometry> retired_geometries_;
     };
 } // namespace akane
\ No newline at end of file
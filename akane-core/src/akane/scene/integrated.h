@@ -5,11 +5,15 @@
 #include "akane/material.h"
 #include "akane/math/distribution.h"
 #include "akane/primitive/integrated/geometric.h"
+#include "akane/primitive/integrated/bvh.h"
+#include "akane/shape/sphere.h"
+#include <type_traits>
 
 #include "akane/light/point.h"
 #include "akane/light/spot.h"
 #include "akane/light/distant.h"
 #include "akane/light/skybox.h"
+#include "akane/light/environment.h"
 
 namespace akane
 {
@@ -22,11 +26,22 @@ namespace akane
         {
         }
 
+        void Commit() override
+        {
+            world_->Build();
+            Scene::Commit();
+        }
+
         bool Intersect(const Ray& ray, Workspace& workspace, IntersectionInfo& isect) const override
         {
             return world_->Intersect(ray, kTravelDistanceMin, kTravelDistanceMax, isect);
         }
 
+        Bounds3 Bound() const override
+        {
+            return world_->Bound();
+        }
+
         // primitive factory
         //
 
@@ -34,9 +49,27 @@ namespace akane
         void AddGeometricPrimitive(ShapeType shape, shared_ptr<Material> mat)
         {
             auto object = arena_.Construct<GeometricPrimitive<ShapeType>>(shape);
+            RegisterMaterial(mat.get());
+            object->BindMaterial(move(mat));
+
+            AddToWorld(object, shape);
+        }
+
+        // shape filled with the interior medium, whose surface is an invisible boundary unless a
+        // material is given
+        template <typename ShapeType>
+        void AddGeometricMedium(ShapeType shape, shared_ptr<Medium> interior,
+                                shared_ptr<Medium> exterior = nullptr,
+                                shared_ptr<Material> mat    = nullptr)
+        {
+            auto object = arena_.Construct<GeometricPrimitive<ShapeType>>(shape);
+            RegisterMaterial(mat.get());
             object->BindMaterial(move(mat));
+            object->BindMedium(interior.get(), exterior.get());
+            RegisterMedium(move(interior));
+            RegisterMedium(move(exterior));
 
-            world_->AddPrimitive(object);
+            AddToWorld(object, shape);
         }
 
         template <typename ShapeType>
@@ -47,7 +80,7 @@ namespace akane
             object->BindAreaLight(color, power);
             RegisterLight(object->GetAreaLight());
 
-            world_->AddPrimitive(object);
+            AddToWorld(object, shape);
         }
 
         void AddPointLight(Vec3 point, Vec3 color, float power)
@@ -70,10 +103,31 @@ namespace akane
         {
             RegisterLight(arena_.Construct<SkyboxLight>(albedo, world_center, world_radius), true);
         }
+        void AddEnvironmentMap(const std::string& filename, float scale, Vec3 world_center,
+                               float world_radius)
+        {
+            RegisterLight(
+                arena_.Construct<EnvironmentLight>(filename, scale, world_center, world_radius),
+                true);
+        }
 
     private:
+        template <typename ShapeType>
+        void AddToWorld(Primitive* object, const ShapeType& shape)
+        {
+            // spheres are intersected with SIMD kernels in BVH leaves
+            if constexpr (std::is_same_v<ShapeType, shape::Sphere>)
+            {
+                world_->AddSpherePrimitive(object, shape);
+            }
+            else
+            {
+                world_->AddPrimitive(object);
+            }
+        }
+
         Arena arena_;
 
-        std::unique_ptr<NaiveComposite> world_ = std::make_unique<NaiveComposite>();
+        std::unique_ptr<BvhComposite> world_ = std::make_unique<BvhComposite>();
     };
 } // namespace akane
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "akane/math/math.h"
+#include "akane/math/bounds.h"
 #include "akane/math/sampling.h"
 #include "akane/ray.h"
 
@@ -48,6 +49,12 @@ namespace akane::shape
             return true;
         }
 
+        Bounds3 Bound() const noexcept
+        {
+            auto extent = Vec3{radius_, radius_, 0.f};
+            return Bounds3{center_ - extent, center_ + extent};
+        }
+
         float Area() const noexcept
         {
             return 2.f * kPi * radius_;
@@ -1,5 +1,6 @@
 #pragma once
 #include "akane/math/math.h"
+#include "akane/math/bounds.h"
 #include "akane/math/sampling.h"
 #include "akane/ray.h"
 
@@ -24,6 +25,14 @@ namespace akane::shape
             return false;
         }
 
+        /**
+         * Bounding box for the geometric object
+         */
+        Bounds3 Bound() const noexcept
+        {
+            return Bounds3{};
+        }
+
         /**
          * Surface area for the geometric object
          */
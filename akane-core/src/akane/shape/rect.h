@@ -1,5 +1,6 @@
 #pragma once
 #include "akane/math/math.h"
+#include "akane/math/bounds.h"
 #include "akane/math/sampling.h"
 #include "akane/ray.h"
 
@@ -50,6 +51,12 @@ namespace akane::shape
             return true;
         }
 
+        Bounds3 Bound() const noexcept
+        {
+            auto extent = Vec3{len_x_ * .5f, len_y_ * .5f, 0.f};
+            return Bounds3{center_ - extent, center_ + extent};
+        }
+
         float Area() const noexcept
         {
             return len_x_ * len_y_;
@@ -1,5 +1,6 @@
 #pragma once
 #include "akane/math/math.h"
+#include "akane/math/bounds.h"
 #include "akane/math/sampling.h"
 #include "akane/ray.h"
 
@@ -46,7 +47,8 @@ namespace akane::shape
             auto t0    = (-b - delta) / (2 * a);
             auto t1    = (-b + delta) / (2 * a);
 
-            auto t = t0 >= 0 ? t0 : t1;
+            // fall back to the far root if the near one is behind t_min, e.g. leaving the sphere
+            auto t = t0 >= t_min ? t0 : t1;
             if (t < 0 || t < t_min || t > t_max)
             {
                 return false;
@@ -62,12 +64,36 @@ namespace akane::shape
             isect.ng    = normal;
             isect.ns    = normal;
             isect.uv    = {u, v};
+
+            // u goes along the latitude and v along the longitude, which has no direction at poles
+            auto cos_latitude = sqrt(normal.X() * normal.X() + normal.Z() * normal.Z());
+
+            isect.dpdu = 2 * kPi * r * Vec3{-normal.Z(), 0.f, normal.X()};
+            isect.dpdv = cos_latitude > 0 ? kPi * r *
+                                                Vec3{-normal.Y() * normal.X() / cos_latitude,
+                                                     cos_latitude,
+                                                     -normal.Y() * normal.Z() / cos_latitude}
+                                          : Vec3{};
             return true;
         }
 
+        constexpr const Vec3& Center() const noexcept
+        {
+            return center_;
+        }
+        constexpr float Radius() const noexcept
+        {
+            return radius_;
+        }
+
+        Bounds3 Bound() const noexcept
+        {
+            return Bounds3{center_ - Vec3{radius_}, center_ + Vec3{radius_}};
+        }
+
         float Area() const noexcept
         {
-            return 4.f * kPi * radius_;
+            return 4.f * kPi * radius_ * radius_;
         }
 
         void SamplePoint(const Point2f& u, Vec3& p_out, Vec3& n_out, float& pdf_out) const noexcept
@@ -0,0 +1,397 @@
+#include "akane/shape/sphere_pack.h"
+#include <limits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define AKANE_SPHERE_PACK_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(AKANE_SPHERE_PACK_X86) && (defined(__GNUC__) || defined(__clang__))
+#define AKANE_TARGET(ISA) __attribute__((target(ISA)))
+#else
+#define AKANE_TARGET(ISA)
+#endif
+
+namespace akane::shape
+{
+    namespace
+    {
+        constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+        // per-ray values shared by every kernel, mirroring Sphere::Intersect
+        struct SphereRayQuery
+        {
+            Vec3 o;
+            Vec3 d;
+            float a;
+            float inv_2a;
+            float t_min;
+        };
+
+        SphereRayQuery CreateQuery(const Ray& ray, float t_min) noexcept
+        {
+            auto a = Dot(ray.d, ray.d);
+            return SphereRayQuery{ray.o, ray.d, a, 1.f / (2 * a), max(t_min, 0.f)};
+        }
+
+        int IntersectScalar(const SpherePack& pack, size_t offset, int count, const Ray& ray,
+                            float t_min, float t_max, float& t_out) noexcept
+        {
+            auto q = CreateQuery(ray, t_min);
+
+            int result = -1;
+            for (int i = 0; i < count; ++i)
+            {
+                auto index = offset + i;
+                auto D     = q.o - Vec3{pack.CenterX()[index], pack.CenterY()[index],
+                                    pack.CenterZ()[index]};
+                auto r     = pack.Radius()[index];
+
+                auto b        = 2 * Dot(q.d, D);
+                auto c        = Dot(D, D) - r * r;
+                auto delta_sq = b * b - 4 * q.a * c;
+                if (delta_sq < 0)
+                {
+                    continue;
+                }
+
+                auto delta = sqrt(delta_sq);
+                auto t0    = (-b - delta) * q.inv_2a;
+                auto t1    = (-b + delta) * q.inv_2a;
+                auto t     = t0 >= q.t_min ? t0 : t1;
+                if (t >= q.t_min && t <= t_max)
+                {
+                    result = i;
+                    t_max  = t;
+                }
+            }
+
+            t_out = t_max;
+            return result;
+        }
+
+#ifdef AKANE_SPHERE_PACK_X86
+        // 4-wide kernel, SSE2 is always available on x64
+        int IntersectSse(const SpherePack& pack, size_t offset, int count, const Ray& ray,
+                         float t_min, float t_max, float& t_out) noexcept
+        {
+            auto q = CreateQuery(ray, t_min);
+
+            const __m128 ox     = _mm_set1_ps(q.o[0]);
+            const __m128 oy     = _mm_set1_ps(q.o[1]);
+            const __m128 oz     = _mm_set1_ps(q.o[2]);
+            const __m128 dx     = _mm_set1_ps(q.d[0]);
+            const __m128 dy     = _mm_set1_ps(q.d[1]);
+            const __m128 dz     = _mm_set1_ps(q.d[2]);
+            const __m128 four_a = _mm_set1_ps(4 * q.a);
+            const __m128 inv_2a = _mm_set1_ps(q.inv_2a);
+            const __m128 vt_min = _mm_set1_ps(q.t_min);
+            const __m128 zero   = _mm_setzero_ps();
+            const __m128 inf    = _mm_set1_ps(kInfinity);
+            const __m128 lane   = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+
+            int result = -1;
+            for (int base = 0; base < count; base += 4)
+            {
+                auto index = offset + base;
+
+                // D = o - c
+                __m128 Dx = _mm_sub_ps(ox, _mm_loadu_ps(pack.CenterX() + index));
+                __m128 Dy = _mm_sub_ps(oy, _mm_loadu_ps(pack.CenterY() + index));
+                __m128 Dz = _mm_sub_ps(oz, _mm_loadu_ps(pack.CenterZ() + index));
+                __m128 r  = _mm_loadu_ps(pack.Radius() + index);
+
+                __m128 half_b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, Dx), _mm_mul_ps(dy, Dy)),
+                                           _mm_mul_ps(dz, Dz));
+                __m128 b      = _mm_add_ps(half_b, half_b);
+                __m128 D2     = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Dx, Dx), _mm_mul_ps(Dy, Dy)),
+                                           _mm_mul_ps(Dz, Dz));
+                __m128 c      = _mm_sub_ps(D2, _mm_mul_ps(r, r));
+
+                __m128 delta_sq = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(four_a, c));
+                __m128 delta    = _mm_sqrt_ps(_mm_max_ps(delta_sq, zero));
+                __m128 neg_b    = _mm_sub_ps(zero, b);
+                __m128 t0       = _mm_mul_ps(_mm_sub_ps(neg_b, delta), inv_2a);
+                __m128 t1       = _mm_mul_ps(_mm_add_ps(neg_b, delta), inv_2a);
+
+                __m128 use_t0 = _mm_cmpge_ps(t0, vt_min);
+                __m128 t      = _mm_or_ps(_mm_and_ps(use_t0, t0), _mm_andnot_ps(use_t0, t1));
+
+                __m128 valid = _mm_cmpge_ps(delta_sq, zero);
+                valid        = _mm_and_ps(valid, _mm_cmpge_ps(t, vt_min));
+                valid        = _mm_and_ps(valid, _mm_cmple_ps(t, _mm_set1_ps(t_max)));
+                valid        = _mm_and_ps(
+                    valid, _mm_cmplt_ps(lane, _mm_set1_ps(static_cast<float>(count - base))));
+                if (_mm_movemask_ps(valid) == 0)
+                {
+                    continue;
+                }
+
+                // horizontal minimum among valid lanes
+                __m128 tv = _mm_or_ps(_mm_and_ps(valid, t), _mm_andnot_ps(valid, inf));
+                __m128 m  = _mm_min_ps(tv, _mm_shuffle_ps(tv, tv, _MM_SHUFFLE(2, 3, 0, 1)));
+                m         = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+
+                int mask = _mm_movemask_ps(_mm_and_ps(valid, _mm_cmpeq_ps(tv, m)));
+                int bit  = 0;
+                while ((mask & (1 << bit)) == 0)
+                {
+                    ++bit;
+                }
+
+                result = base + bit;
+                t_max  = _mm_cvtss_f32(m);
+            }
+
+            t_out = t_max;
+            return result;
+        }
+
+        // 8-wide kernel
+        AKANE_TARGET("avx2,fma")
+        int IntersectAvx2(const SpherePack& pack, size_t offset, int count, const Ray& ray,
+                          float t_min, float t_max, float& t_out) noexcept
+        {
+            auto q = CreateQuery(ray, t_min);
+
+            const __m256 ox     = _mm256_set1_ps(q.o[0]);
+            const __m256 oy     = _mm256_set1_ps(q.o[1]);
+            const __m256 oz     = _mm256_set1_ps(q.o[2]);
+            const __m256 dx     = _mm256_set1_ps(q.d[0]);
+            const __m256 dy     = _mm256_set1_ps(q.d[1]);
+            const __m256 dz     = _mm256_set1_ps(q.d[2]);
+            const __m256 four_a = _mm256_set1_ps(4 * q.a);
+            const __m256 inv_2a = _mm256_set1_ps(q.inv_2a);
+            const __m256 vt_min = _mm256_set1_ps(q.t_min);
+            const __m256 zero   = _mm256_setzero_ps();
+            const __m256 inf    = _mm256_set1_ps(kInfinity);
+            const __m256 lane   = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+
+            int result = -1;
+            for (int base = 0; base < count; base += 8)
+            {
+                auto index = offset + base;
+
+                __m256 Dx = _mm256_sub_ps(ox, _mm256_loadu_ps(pack.CenterX() + index));
+                __m256 Dy = _mm256_sub_ps(oy, _mm256_loadu_ps(pack.CenterY() + index));
+                __m256 Dz = _mm256_sub_ps(oz, _mm256_loadu_ps(pack.CenterZ() + index));
+                __m256 r  = _mm256_loadu_ps(pack.Radius() + index);
+
+                __m256 half_b =
+                    _mm256_fmadd_ps(dz, Dz, _mm256_fmadd_ps(dy, Dy, _mm256_mul_ps(dx, Dx)));
+                __m256 b = _mm256_add_ps(half_b, half_b);
+                __m256 c = _mm256_fmadd_ps(
+                    Dz, Dz, _mm256_fmadd_ps(Dy, Dy, _mm256_fmsub_ps(Dx, Dx, _mm256_mul_ps(r, r))));
+
+                __m256 delta_sq = _mm256_fmsub_ps(b, b, _mm256_mul_ps(four_a, c));
+                __m256 delta    = _mm256_sqrt_ps(_mm256_max_ps(delta_sq, zero));
+                __m256 neg_b    = _mm256_sub_ps(zero, b);
+                __m256 t0       = _mm256_mul_ps(_mm256_sub_ps(neg_b, delta), inv_2a);
+                __m256 t1       = _mm256_mul_ps(_mm256_add_ps(neg_b, delta), inv_2a);
+                __m256 t        = _mm256_blendv_ps(t1, t0, _mm256_cmp_ps(t0, vt_min, _CMP_GE_OQ));
+
+                __m256 valid = _mm256_cmp_ps(delta_sq, zero, _CMP_GE_OQ);
+                valid        = _mm256_and_ps(valid, _mm256_cmp_ps(t, vt_min, _CMP_GE_OQ));
+                valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, _mm256_set1_ps(t_max), _CMP_LE_OQ));
+                valid = _mm256_and_ps(
+                    valid, _mm256_cmp_ps(lane, _mm256_set1_ps(static_cast<float>(count - base)),
+                                         _CMP_LT_OQ));
+                if (_mm256_movemask_ps(valid) == 0)
+                {
+                    continue;
+                }
+
+                __m256 tv = _mm256_blendv_ps(inf, t, valid);
+                __m256 m  = _mm256_min_ps(tv, _mm256_permute2f128_ps(tv, tv, 0x01));
+                m         = _mm256_min_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+                m         = _mm256_min_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+
+                int mask =
+                    _mm256_movemask_ps(_mm256_and_ps(valid, _mm256_cmp_ps(tv, m, _CMP_EQ_OQ)));
+                int bit = 0;
+                while ((mask & (1 << bit)) == 0)
+                {
+                    ++bit;
+                }
+
+                result = base + bit;
+                t_max  = _mm256_cvtss_f32(m);
+            }
+
+            t_out = t_max;
+            return result;
+        }
+
+        // 16-wide kernel
+        AKANE_TARGET("avx512f")
+        int IntersectAvx512(const SpherePack& pack, size_t offset, int count, const Ray& ray,
+                            float t_min, float t_max, float& t_out) noexcept
+        {
+            auto q = CreateQuery(ray, t_min);
+
+            const __m512 ox     = _mm512_set1_ps(q.o[0]);
+            const __m512 oy     = _mm512_set1_ps(q.o[1]);
+            const __m512 oz     = _mm512_set1_ps(q.o[2]);
+            const __m512 dx     = _mm512_set1_ps(q.d[0]);
+            const __m512 dy     = _mm512_set1_ps(q.d[1]);
+            const __m512 dz     = _mm512_set1_ps(q.d[2]);
+            const __m512 four_a = _mm512_set1_ps(4 * q.a);
+            const __m512 inv_2a = _mm512_set1_ps(q.inv_2a);
+            const __m512 vt_min = _mm512_set1_ps(q.t_min);
+            const __m512 zero   = _mm512_setzero_ps();
+            const __m512 inf    = _mm512_set1_ps(kInfinity);
+
+            int result = -1;
+            for (int base = 0; base < count; base += 16)
+            {
+                auto index = offset + base;
+
+                __m512 Dx = _mm512_sub_ps(ox, _mm512_loadu_ps(pack.CenterX() + index));
+                __m512 Dy = _mm512_sub_ps(oy, _mm512_loadu_ps(pack.CenterY() + index));
+                __m512 Dz = _mm512_sub_ps(oz, _mm512_loadu_ps(pack.CenterZ() + index));
+                __m512 r  = _mm512_loadu_ps(pack.Radius() + index);
+
+                __m512 half_b =
+                    _mm512_fmadd_ps(dz, Dz, _mm512_fmadd_ps(dy, Dy, _mm512_mul_ps(dx, Dx)));
+                __m512 b = _mm512_add_ps(half_b, half_b);
+                __m512 c = _mm512_fmadd_ps(
+                    Dz, Dz, _mm512_fmadd_ps(Dy, Dy, _mm512_fmsub_ps(Dx, Dx, _mm512_mul_ps(r, r))));
+
+                __m512 delta_sq = _mm512_fmsub_ps(b, b, _mm512_mul_ps(four_a, c));
+                __m512 delta    = _mm512_sqrt_ps(_mm512_max_ps(delta_sq, zero));
+                __m512 neg_b    = _mm512_sub_ps(zero, b);
+                __m512 t0       = _mm512_mul_ps(_mm512_sub_ps(neg_b, delta), inv_2a);
+                __m512 t1       = _mm512_mul_ps(_mm512_add_ps(neg_b, delta), inv_2a);
+                __m512 t =
+                    _mm512_mask_blend_ps(_mm512_cmp_ps_mask(t0, vt_min, _CMP_GE_OQ), t1, t0);
+
+                auto remaining = count - base;
+                __mmask16 valid =
+                    remaining >= 16 ? __mmask16(0xffff) : __mmask16((1u << remaining) - 1);
+                valid &= _mm512_cmp_ps_mask(delta_sq, zero, _CMP_GE_OQ);
+                valid &= _mm512_cmp_ps_mask(t, vt_min, _CMP_GE_OQ);
+                valid &= _mm512_cmp_ps_mask(t, _mm512_set1_ps(t_max), _CMP_LE_OQ);
+                if (valid == 0)
+                {
+                    continue;
+                }
+
+                __m512 tv   = _mm512_mask_blend_ps(valid, inf, t);
+                float t_hit = _mm512_reduce_min_ps(tv);
+
+                unsigned mask = valid & _mm512_cmp_ps_mask(tv, _mm512_set1_ps(t_hit), _CMP_EQ_OQ);
+                int bit       = 0;
+                while ((mask & (1u << bit)) == 0)
+                {
+                    ++bit;
+                }
+
+                result = base + bit;
+                t_max  = t_hit;
+            }
+
+            t_out = t_max;
+            return result;
+        }
+
+        bool CpuSupportAvx2() noexcept
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+
+            // os must save ymm registers on context switch
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool fma     = (info[2] & (1 << 12)) != 0;
+            if (!osxsave || !fma || (_xgetbv(0) & 0x6) != 0x6)
+            {
+                return false;
+            }
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+        }
+
+        bool CpuSupportAvx512() noexcept
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+
+            // os must save zmm and opmask registers on context switch
+            __cpuid(info, 1);
+            if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0xe6) != 0xe6)
+            {
+                return false;
+            }
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 16)) != 0;
+#else
+            return __builtin_cpu_supports("avx512f");
+#endif
+        }
+#endif // AKANE_SPHERE_PACK_X86
+
+        using SpherePackKernel = int (*)(const SpherePack&, size_t, int, const Ray&, float, float,
+                                         float&) noexcept;
+
+        struct SpherePackKernelInfo
+        {
+            SpherePackKernel kernel;
+            int width; // spheres tested at once
+        };
+
+        SpherePackKernelInfo SelectSpherePackKernel() noexcept
+        {
+#ifdef AKANE_SPHERE_PACK_X86
+            if (CpuSupportAvx512())
+            {
+                return {IntersectAvx512, 16};
+            }
+            if (CpuSupportAvx2())
+            {
+                return {IntersectAvx2, 8};
+            }
+
+            return {IntersectSse, 4};
+#else
+            return {IntersectScalar, 1};
+#endif
+        }
+
+        const SpherePackKernelInfo kSpherePackKernel = SelectSpherePackKernel();
+    } // namespace
+
+    int GetSpherePackWidth() noexcept
+    {
+        return kSpherePackKernel.width;
+    }
+
+    int IntersectSpherePack(const SpherePack& pack, size_t offset, int count, const Ray& ray,
+                            float t_min, float t_max, float& t_out) noexcept
+    {
+        // a single sphere doesn't pay for the broadcast
+        if (count == 1)
+        {
+            return IntersectScalar(pack, offset, count, ray, t_min, t_max, t_out);
+        }
+
+        return kSpherePackKernel.kernel(pack, offset, count, ray, t_min, t_max, t_out);
+    }
+} // namespace akane::shape
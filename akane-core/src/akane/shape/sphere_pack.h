@@ -0,0 +1,72 @@
+#pragma once
+#include "akane/math/math.h"
+#include "akane/ray.h"
+#include "akane/shape/sphere.h"
+#include <vector>
+
+namespace akane::shape
+{
+    /**
+     * Structure-of-arrays storage of spheres so that a ray could be tested against several of
+     * them at once with SIMD instructions
+     */
+    class SpherePack
+    {
+    public:
+        // extra slots at the end so that the widest kernel never reads out of bound
+        static constexpr size_t kPaddingCount = 16;
+
+        void Resize(size_t count)
+        {
+            for (auto vec : {&cx_, &cy_, &cz_, &radius_})
+            {
+                vec->assign(count + kPaddingCount, 0.f);
+            }
+        }
+
+        void Set(size_t index, const Sphere& sphere) noexcept
+        {
+            cx_[index]     = sphere.Center()[0];
+            cy_[index]     = sphere.Center()[1];
+            cz_[index]     = sphere.Center()[2];
+            radius_[index] = sphere.Radius();
+        }
+
+        const float* CenterX() const noexcept
+        {
+            return cx_.data();
+        }
+        const float* CenterY() const noexcept
+        {
+            return cy_.data();
+        }
+        const float* CenterZ() const noexcept
+        {
+            return cz_.data();
+        }
+        const float* Radius() const noexcept
+        {
+            return radius_.data();
+        }
+
+    private:
+        std::vector<float> cx_;
+        std::vector<float> cy_;
+        std::vector<float> cz_;
+        std::vector<float> radius_;
+    };
+
+    /**
+     * Find the closest sphere in [offset, offset + count) that the ray hits in (t_min, t_max)
+     *
+     * The widest kernel the running cpu supports (SSE2/AVX2/AVX-512) is selected at runtime.
+     * Returns index of the sphere relative to offset, or -1 if nothing is hit. Hit distance is
+     * written to t_out, while the caller is expected to compute the full intersection record
+     * with the scalar Sphere::Intersect.
+     */
+    int IntersectSpherePack(const SpherePack& pack, size_t offset, int count, const Ray& ray,
+                            float t_min, float t_max, float& t_out) noexcept;
+
+    // number of spheres the selected kernel tests at once, one if there's no SIMD kernel
+    int GetSpherePackWidth() noexcept;
+} // namespace akane::shape
@@ -1,5 +1,6 @@
 #pragma once
 #include "akane/math/math.h"
+#include "akane/math/bounds.h"
 #include "akane/math/sampling.h"
 #include "akane/math/transform.h"
 #include "akane/ray.h"
@@ -18,7 +19,7 @@ namespace akane::shape
         bool Intersect(const Ray& ray, float t_min, float t_max, IntersectionInfo& isect) const
             noexcept
         {
-            Ray ray2 = Ray{transform_.ApplyLinear(ray.o), transform_.ApplyLinear(ray.d)};
+            Ray ray2 = Ray{transform_.ApplyLinear(ray.o), transform_.ApplyLinear(ray.d), ray.time};
 
             if (!shape_.Intersect(ray2, t_min, t_max, isect))
             {
@@ -31,6 +32,28 @@ namespace akane::shape
             return true;
         }
 
+        Bounds3 Bound() const noexcept
+        {
+            // transform every corner of the bounding box of the underlying shape
+            auto bound = shape_.Bound();
+            if (bound.Empty())
+            {
+                return bound;
+            }
+
+            Bounds3 result;
+            for (int i = 0; i < 8; ++i)
+            {
+                auto corner = Vec3{(i & 1) ? bound.upper[0] : bound.lower[0],
+                                   (i & 2) ? bound.upper[1] : bound.lower[1],
+                                   (i & 4) ? bound.upper[2] : bound.lower[2]};
+
+                result = Union(result, transform_.InverseLinear(corner));
+            }
+
+            return result;
+        }
+
         float Area() const noexcept
         {
             return shape_.Area();
@@ -0,0 +1,201 @@
+#include "akane/spectral.h"
+
+namespace akane
+{
+    namespace
+    {
+        // piecewise gaussian with different widths on either side of the mean
+        float PiecewiseGaussian(float x, float mu, float sigma_left, float sigma_right) noexcept
+        {
+            auto t = (x - mu) / (x < mu ? sigma_left : sigma_right);
+            return std::exp(-.5f * t * t);
+        }
+
+        // CIE 1931 matching functions fitted with multi-lobe gaussians (Wyman et al. 2013)
+        Vec3 EvalMatchingXYZ(float lambda) noexcept
+        {
+            auto x = 1.056f * PiecewiseGaussian(lambda, 599.8f, 37.9f, 31.0f) +
+                     .362f * PiecewiseGaussian(lambda, 442.0f, 16.0f, 26.7f) -
+                     .065f * PiecewiseGaussian(lambda, 501.1f, 20.4f, 26.2f);
+            auto y = .821f * PiecewiseGaussian(lambda, 568.8f, 46.9f, 40.5f) +
+                     .286f * PiecewiseGaussian(lambda, 530.9f, 16.3f, 31.1f);
+            auto z = 1.217f * PiecewiseGaussian(lambda, 437.0f, 11.8f, 36.0f) +
+                     .681f * PiecewiseGaussian(lambda, 459.0f, 26.0f, 13.8f);
+
+            return Vec3{x, y, z};
+        }
+
+        Vec3 XYZToLinearSRGB(const Vec3& xyz) noexcept
+        {
+            return Vec3{3.2404542f * xyz[0] - 1.5371385f * xyz[1] - .4985314f * xyz[2],
+                        -.9692660f * xyz[0] + 1.8760108f * xyz[1] + .0415560f * xyz[2],
+                        .0556434f * xyz[0] - .2040259f * xyz[1] + 1.0572252f * xyz[2]};
+        }
+
+        float SmoothStep(float x, float lower, float upper) noexcept
+        {
+            auto t = clamp((x - lower) / (upper - lower), 0.f, 1.f);
+            return t * t * (3.f - 2.f * t);
+        }
+
+        // smooth spectra for red, green and blue that add up to one at every wavelength, so that
+        // white is uplifted to a constant spectrum and reflectances stay below one
+        Vec3 EvalUpliftBasis(float lambda) noexcept
+        {
+            auto blue = 1.f - SmoothStep(lambda, 480.f, 510.f);
+            auto red  = SmoothStep(lambda, 570.f, 600.f);
+
+            return Vec3{red, 1.f - red - blue, blue};
+        }
+
+        Vec3 Transform3x3(const Vec3 (&rows)[3], const Vec3& v) noexcept
+        {
+            return Vec3{Dot(rows[0], v), Dot(rows[1], v), Dot(rows[2], v)};
+        }
+
+        /**
+         * Constants derived from the matching functions, which are integrated once at startup
+         */
+        struct SpectralTables
+        {
+            // scale of each channel, which normalizes Y and balances white of linear sRGB
+            Vec3 rgb_scale;
+
+            // rows of the inverse of the matrix taking basis coefficients to colors, so that an
+            // uplifted color converts back to itself
+            Vec3 uplift[3];
+
+            SpectralTables()
+            {
+                constexpr int kStepCount = 470;
+                constexpr float kStep    = (kLambdaMax - kLambdaMin) / kStepCount;
+
+                Vec3 xyz_total = {};
+                for (int i = 0; i <= kStepCount; ++i)
+                {
+                    xyz_total += EvalMatchingXYZ(kLambdaMin + i * kStep) * kStep;
+                }
+
+                auto white = XYZToLinearSRGB(xyz_total / xyz_total[1]);
+                rgb_scale  = Vec3{1.f} / (white * xyz_total[1]);
+
+                // columns are colors of basis spectra
+                Vec3 columns[3] = {};
+                for (int i = 0; i <= kStepCount; ++i)
+                {
+                    auto lambda = kLambdaMin + i * kStep;
+                    auto rgb    = XYZToLinearSRGB(EvalMatchingXYZ(lambda)) * rgb_scale;
+                    auto basis  = EvalUpliftBasis(lambda);
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        columns[j] += rgb * basis[j] * kStep;
+                    }
+                }
+
+                // inverse by cofactors, where rows of the inverse are cross products of columns
+                auto det  = Dot(columns[0], Cross(columns[1], columns[2]));
+                uplift[0] = Cross(columns[1], columns[2]) / det;
+                uplift[1] = Cross(columns[2], columns[0]) / det;
+                uplift[2] = Cross(columns[0], columns[1]) / det;
+            }
+        };
+
+        const SpectralTables& GetSpectralTables()
+        {
+            static const SpectralTables tables;
+            return tables;
+        }
+
+        // wavelengths are importance sampled roughly by luminance (Radziszewski et al. 2009)
+        float SampleVisibleWavelength(float u) noexcept
+        {
+            return 538.f - 138.888889f * std::atanh(.85691062f - 1.82750197f * u);
+        }
+
+        float VisibleWavelengthPdf(float lambda) noexcept
+        {
+            if (lambda < kLambdaMin || lambda > kLambdaMax)
+            {
+                return 0.f;
+            }
+
+            auto c = std::cosh(.0072f * (lambda - 538.f));
+            return .0039398042f / (c * c);
+        }
+    } // namespace
+
+    SampledWavelengths SampledWavelengths::Sample(Sampler& sampler)
+    {
+        SampledWavelengths result;
+
+        auto u = sampler.Get1D();
+        for (int i = 0; i < kChannelCount; ++i)
+        {
+            auto ui = u + static_cast<float>(i) / kChannelCount;
+            if (ui >= 1.f)
+            {
+                ui -= 1.f;
+            }
+
+            result.lambda_[i] = clamp(SampleVisibleWavelength(ui), kLambdaMin, kLambdaMax);
+            result.pdf_[i]    = VisibleWavelengthPdf(result.lambda_[i]);
+        }
+
+        float basis[3][kChannelCount];
+        for (int i = 0; i < kChannelCount; ++i)
+        {
+            auto b = EvalUpliftBasis(result.lambda_[i]);
+            for (int j = 0; j < 3; ++j)
+            {
+                basis[j][i] = b[j];
+            }
+        }
+
+        for (int j = 0; j < 3; ++j)
+        {
+            result.basis_[j] = SampledSpectrum{basis[j][0], basis[j][1], basis[j][2], basis[j][3]};
+        }
+
+        return result;
+    }
+
+    void SampledWavelengths::TerminateSecondary() noexcept
+    {
+        if (SecondaryTerminated())
+        {
+            return;
+        }
+
+        // the hero alone now stands for every wavelength
+        for (int i = 1; i < kChannelCount; ++i)
+        {
+            pdf_[i] = 0.f;
+        }
+
+        pdf_[0] /= kChannelCount;
+    }
+
+    SampledSpectrum SampledWavelengths::Lift(const Spectrum& rgb) const noexcept
+    {
+        auto coeff = Transform3x3(GetSpectralTables().uplift, rgb);
+
+        // saturated colors may need slightly negative coefficients
+        return (basis_[0] * coeff[0] + basis_[1] * coeff[1] + basis_[2] * coeff[2]).ClampZero();
+    }
+
+    Spectrum SampledWavelengths::ToRGB(const SampledSpectrum& radiance) const noexcept
+    {
+        Vec3 xyz = {};
+        for (int i = 0; i < kChannelCount; ++i)
+        {
+            if (pdf_[i] != 0)
+            {
+                xyz += EvalMatchingXYZ(lambda_[i]) * (radiance[i] / pdf_[i]);
+            }
+        }
+
+        // out of gamut colors have negative channels, which average out over samples
+        return XYZToLinearSRGB(xyz / static_cast<float>(kChannelCount)) *
+               GetSpectralTables().rgb_scale;
+    }
+} // namespace akane
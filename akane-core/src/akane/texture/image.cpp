@@ -1,21 +1,145 @@
 #include "akane/texture/image.h"
-#include "akane/common/image.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define AKANE_TEXTURE_SSE
+#include <immintrin.h>
+#endif
 
 namespace akane
 {
+    namespace
+    {
+        /**
+         * Blend 2x2 texels starting at p, whose right and bottom neighbours are found at offset of
+         * 1 and stride texels
+         *
+         * Channels of a texel are decoded into a vector lane each, so the blend of all channels is
+         * done at once.
+         */
+        template <typename T>
+        inline Vec3 FilterBilinear(const T* p, size_t stride, float fx, float fy,
+                                   const float* lut) noexcept
+        {
+            auto p00 = p;
+            auto p01 = p + TiledImage::kChannelCount;
+            auto p10 = p + stride * TiledImage::kChannelCount;
+            auto p11 = p10 + TiledImage::kChannelCount;
+
+#ifdef AKANE_TEXTURE_SSE
+            auto load = [&](const T* q) {
+                return _mm_setr_ps(lut[q[0]], lut[q[1]], lut[q[2]], 0.f);
+            };
+
+            auto t00 = load(p00);
+            auto t01 = load(p01);
+            auto t10 = load(p10);
+            auto t11 = load(p11);
+
+            auto wx     = _mm_set1_ps(fx);
+            auto wy     = _mm_set1_ps(fy);
+            auto top    = _mm_add_ps(t00, _mm_mul_ps(wx, _mm_sub_ps(t01, t00)));
+            auto bottom = _mm_add_ps(t10, _mm_mul_ps(wx, _mm_sub_ps(t11, t10)));
+            auto result = _mm_add_ps(top, _mm_mul_ps(wy, _mm_sub_ps(bottom, top)));
+
+            alignas(16) float out[4];
+            _mm_store_ps(out, result);
+            return Vec3{out[0], out[1], out[2]};
+#else
+            Vec3 result;
+            for (int c = 0; c < 3; ++c)
+            {
+                auto top    = lut[p00[c]] + fx * (lut[p01[c]] - lut[p00[c]]);
+                auto bottom = lut[p10[c]] + fx * (lut[p11[c]] - lut[p10[c]]);
+                result[c]   = top + fy * (bottom - top);
+            }
+
+            return result;
+#endif
+        }
+    } // namespace
+
     ImageTexture::ImageTexture(const std::string& filename)
     {
-        int width;
-        int height;
-        auto image_data = LoadImage(filename.c_str(), width, height);
+        image_ = TiledImage::Open(filename);
+
+        decode_table_ = image_->Format() == TexelFormat::Srgb8 ? GetSrgb8DecodeTable()
+                                                               : GetSrgb16DecodeTable();
+    }
+
+    void ImageTexture::EvalBatch(size_t count, const Vec2* uv, const TextureFootprint* footprints,
+                                 Vec3* out) const noexcept
+    {
+        // NOTE lookups are done in order, so that coherent batches stay on the same tiles
+        if (footprints != nullptr)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                out[i] = SampleTrilinear(uv[i][0], uv[i][1], ComputeLod(footprints[i]));
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                out[i] = SampleBilinear(uv[i][0], uv[i][1], 0);
+            }
+        }
+    }
+
+    float ImageTexture::ComputeLod(const TextureFootprint& footprint) const noexcept
+    {
+        const auto& base = image_->GetLevel(0);
+
+        auto dx = Vec2{footprint.duvdx[0] * base.width, footprint.duvdx[1] * base.height};
+        auto dy = Vec2{footprint.duvdy[0] * base.width, footprint.duvdy[1] * base.height};
 
-        data_ = make_unique<float[]>(width * height * 3);
-        for (int i = 0; i < width * height * 3; ++i)
+        // NOTE written in this form so that NaN falls back to the finest level
+        auto width = max(dx.Length(), dy.Length());
+        if (!(width > 1.f))
         {
-            data_[i] = sRGB2Linear(static_cast<float>(image_data[i]) * (1.f / 255.f));
+            return 0.f;
         }
 
-        width_  = width;
-        height_ = height;
+        return min(std::log2(width), static_cast<float>(image_->LevelCount() - 1));
+    }
+
+    Vec3 ImageTexture::SampleBilinear(float u, float v, int level) const noexcept
+    {
+        constexpr int kTileSize = TiledImage::kTileSize;
+
+        const auto& lv = image_->GetLevel(level);
+
+        // texel centers are at half-integer coordinates
+        auto s = ResolveUV<>(u) * lv.width - .5f;
+        auto t = (1.f - ResolveUV<>(v)) * lv.height - .5f;
+
+        auto x  = static_cast<int>(floor(s));
+        auto y  = static_cast<int>(floor(t));
+        auto fx = s - x;
+        auto fy = t - y;
+
+        // taps before the first texel wrap around, and those after the last one are found in
+        // padding of the tile
+        x = x < 0 ? lv.width - 1 : min(x, lv.width - 1);
+        y = y < 0 ? lv.height - 1 : min(y, lv.height - 1);
+
+        auto tile  = FetchTile(level, x / kTileSize, y / kTileSize);
+        auto texel = (y % kTileSize) * TiledImage::kTileStride + x % kTileSize;
+        auto index = texel * TiledImage::kChannelCount;
+
+        if (image_->Format() == TexelFormat::Srgb8)
+        {
+            return FilterBilinear(tile + index, TiledImage::kTileStride, fx, fy, decode_table_);
+        }
+        else
+        {
+            auto p = reinterpret_cast<const uint16_t*>(tile) + index;
+            return FilterBilinear(p, TiledImage::kTileStride, fx, fy, decode_table_);
+        }
+    }
+
+    const uint8_t* ImageTexture::FetchTile(int level, int tile_x, int tile_y) const noexcept
+    {
+        return image_->GetTile(level, tile_x, tile_y);
     }
-} // namespace akane
\ No newline at end of file
+} // namespace akane
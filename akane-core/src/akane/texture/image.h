@@ -1,8 +1,16 @@
 #pragma once
 #include "akane/texture.h"
+#include "akane/texture/tiled_image.h"
 
 namespace akane
 {
+    /**
+     * Image texture backed by a tiled mip pyramid
+     *
+     * Tiles are read straight from the mapped .aktex file, so only pages of tiles actually looked
+     * up become resident, and the OS drops them under memory pressure as they're backed by the
+     * file. Texels stay in their compact sRGB form, and are decoded through a table at lookup.
+     */
     class ImageTexture : public Texture3D
     {
     public:
@@ -10,53 +18,45 @@ namespace akane
 
         Vec3 Eval(float u, float v) const noexcept override
         {
-            return SampleNearest(u, v);
+            return SampleBilinear(u, v, 0);
         }
 
-    private:
-        Vec3 GetPixel(size_t x, size_t y) const noexcept
+        Vec3 EvalFiltered(float u, float v,
+                          const TextureFootprint& footprint) const noexcept override
         {
-            auto index = y * width_ * 3 + x * 3;
-
-            return Vec3{ data_[index], data_[index + 1], data_[index + 2] };
+            return SampleTrilinear(u, v, ComputeLod(footprint));
         }
 
-        Vec3 SampleNearest(float u, float v) const noexcept
-        {
-            size_t x = ResolveUV<>(u) * (width_ - 1);
-            size_t y = (1.f - ResolveUV<>(v)) * (height_ - 1);
-
-            return GetPixel(x, y);
-        }
+        void EvalBatch(size_t count, const Vec2* uv, const TextureFootprint* footprints,
+                       Vec3* out) const noexcept override;
 
-        // TODO: store redundent texture to boost bilinear performance
-        Vec3 SampleBilinear(float u, float v) const noexcept
-        {
-            auto u_ = (u - floor(u)) * width_;
-            auto v_ = (ceil(v) - v) * height_;
-
-            auto x0 = static_cast<size_t>(u_);
-            auto y0 = static_cast<size_t>(v_);
-            auto x1 = min(x0 + 1, width_ - 1);
-            auto y1 = min(y0 + 1, height_ - 1);
+    private:
+        // continuous level whose texel is about as large as the footprint
+        float ComputeLod(const TextureFootprint& footprint) const noexcept;
 
-            auto kx = x0 == x1 ? 1.f : u_ - x0;
-            auto ky = y0 == y1 ? 1.f : v_ - y0;
+        // texels of a tile in the texel format, valid as long as the texture
+        const uint8_t* FetchTile(int level, int tile_x, int tile_y) const noexcept;
 
-            auto p00 = GetPixel(x0, y0);
-            auto p01 = GetPixel(x0, y1);
-            auto p10 = GetPixel(x1, y0);
-            auto p11 = GetPixel(x1, y1);
+        Vec3 SampleBilinear(float u, float v, int level) const noexcept;
 
-            auto py0 = kx * p00 + (1.f - kx) * p01;
-            auto py1 = kx * p10 + (1.f - kx) * p11;
-            return ky * py0 + (1.f - ky) * py1;
+        Vec3 SampleTrilinear(float u, float v, float lod) const noexcept
+        {
+            auto level = static_cast<int>(lod);
+            auto t     = lod - level;
+            if (t == 0.f)
+            {
+                return SampleBilinear(u, v, level);
+            }
+
+            auto c0 = SampleBilinear(u, v, level);
+            auto c1 = SampleBilinear(u, v, level + 1);
+            return c0 + t * (c1 - c0);
         }
 
     private:
-        size_t width_ = 0;
-        size_t height_ = 0;
+        TiledImage::SharedPtr image_ = nullptr;
 
-        std::unique_ptr<float[]> data_ = nullptr;
+        // linear value of each sRGB value in the texel format
+        const float* decode_table_ = nullptr;
     };
-}
\ No newline at end of file
+} // namespace akane
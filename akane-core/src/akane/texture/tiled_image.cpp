@@ -0,0 +1,353 @@
+#include "akane/texture/tiled_image.h"
+#include "akane/common/image.h"
+#include "akane/common/mapped_file.h"
+#include "akane/common/parallel.h"
+#include "akane/spectrum.h"
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+using namespace std;
+using namespace std::filesystem;
+
+namespace akane
+{
+    namespace
+    {
+        // file layout:
+        //   header
+        //   tiles of every level, from the finest to the coarsest, each in row-major order
+        constexpr char kTiledImageMagic[8]   = {'A', 'K', 'T', 'E', 'X', 0, 0, 0};
+        constexpr uint32_t kTiledImageVersion = 3;
+        constexpr int kMaxLevelCount          = 32;
+        constexpr size_t kTileAlignment       = 64;
+
+        struct TiledImageHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t tile_size;
+            uint32_t texel_format;
+            uint32_t reserved;
+
+            uint64_t source_size;
+            int64_t source_mtime;
+
+            uint32_t level_count;
+            uint32_t padding;
+            TiledImage::Level levels[kMaxLevelCount];
+        };
+
+        static_assert(std::is_trivially_copyable_v<TiledImageHeader>);
+
+        // a single level of the pyramid, in sRGB with T for each channel
+        template <typename T> struct LevelImage
+        {
+            int width;
+            int height;
+            vector<T> texels;
+
+            const T* GetTexel(int x, int y) const noexcept
+            {
+                x = min(x, width - 1);
+                y = min(y, height - 1);
+                return texels.data() + (static_cast<size_t>(y) * width + x) * 3;
+            }
+
+            const T* GetTexelWrapped(int x, int y) const noexcept
+            {
+                return GetTexel(x % width, y % height);
+            }
+        };
+
+        template <typename T> const float* GetDecodeTable() noexcept
+        {
+            if constexpr (std::is_same_v<T, uint8_t>)
+            {
+                return GetSrgb8DecodeTable();
+            }
+            else
+            {
+                return GetSrgb16DecodeTable();
+            }
+        }
+
+        template <typename T> inline T EncodeSrgb(float value) noexcept
+        {
+            constexpr auto max_value = static_cast<float>(numeric_limits<T>::max());
+            return static_cast<T>(Linear2sRGB(value) * max_value + .5f);
+        }
+
+        // 2x2 box filter in linear space, an odd texel at the edge is filtered with itself
+        template <typename T> LevelImage<T> Downsample(const LevelImage<T>& src)
+        {
+            auto lut = GetDecodeTable<T>();
+
+            LevelImage<T> result;
+            result.width  = max(1, (src.width + 1) / 2);
+            result.height = max(1, (src.height + 1) / 2);
+            result.texels.resize(static_cast<size_t>(result.width) * result.height * 3);
+
+            ParallelFor(result.height, 16, [&](size_t begin, size_t end) {
+                for (auto y = static_cast<int>(begin); y < static_cast<int>(end); ++y)
+                {
+                    auto dst = result.texels.data() + static_cast<size_t>(y) * result.width * 3;
+                    for (int x = 0; x < result.width; ++x)
+                    {
+                        auto p00 = src.GetTexel(2 * x, 2 * y);
+                        auto p01 = src.GetTexel(2 * x + 1, 2 * y);
+                        auto p10 = src.GetTexel(2 * x, 2 * y + 1);
+                        auto p11 = src.GetTexel(2 * x + 1, 2 * y + 1);
+
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            auto sum = lut[p00[c]] + lut[p01[c]] + lut[p10[c]] + lut[p11[c]];
+                            *(dst++) = EncodeSrgb<T>(.25f * sum);
+                        }
+                    }
+                }
+            });
+
+            return result;
+        }
+
+        template <typename T>
+        void WriteTiles(uint8_t* output, const LevelImage<T>& image, const TiledImage::Level& level)
+        {
+            constexpr auto tile_size   = TiledImage::kTileSize;
+            constexpr auto tile_stride = TiledImage::kTileStride;
+            constexpr auto texel_size  = 3 * sizeof(T);
+
+            auto tile_count = static_cast<size_t>(level.tile_count_x) * level.tile_count_y;
+            ParallelFor(tile_count, 4, [&](size_t begin, size_t end) {
+                for (auto i = begin; i < end; ++i)
+                {
+                    auto x0 = static_cast<int>(i % level.tile_count_x) * tile_size;
+                    auto y0 = static_cast<int>(i / level.tile_count_x) * tile_size;
+
+                    auto dst = output + level.offset + i * texel_size * TiledImage::kTileTexelCount;
+                    for (int y = 0; y < tile_stride; ++y)
+                    {
+                        for (int x = 0; x < tile_stride; ++x)
+                        {
+                            memcpy(dst, image.GetTexelWrapped(x0 + x, y0 + y), texel_size);
+                            dst += texel_size;
+                        }
+                    }
+                }
+            });
+        }
+
+        template <typename T>
+        vector<uint8_t> BuildTiledImage(LevelImage<T> image, TexelFormat format,
+                                        uint64_t source_size, int64_t source_mtime)
+        {
+            TiledImageHeader header{};
+            memcpy(header.magic, kTiledImageMagic, sizeof(header.magic));
+            header.version      = kTiledImageVersion;
+            header.tile_size    = TiledImage::kTileSize;
+            header.texel_format = static_cast<uint32_t>(format);
+            header.source_size  = source_size;
+            header.source_mtime = source_mtime;
+
+            // compute layout of all levels
+            auto tile_byte_size = TiledImage::kTileTexelCount * 3 * sizeof(T);
+
+            uint64_t offset = (sizeof(header) + kTileAlignment - 1) & ~(kTileAlignment - 1);
+            for (int w = image.width, h = image.height;; w = (w + 1) / 2, h = (h + 1) / 2)
+            {
+                AKANE_REQUIRE(header.level_count < kMaxLevelCount);
+
+                w = max(1, w);
+                h = max(1, h);
+
+                auto& level        = header.levels[header.level_count++];
+                level.width        = w;
+                level.height       = h;
+                level.tile_count_x = (w + TiledImage::kTileSize - 1) / TiledImage::kTileSize;
+                level.tile_count_y = (h + TiledImage::kTileSize - 1) / TiledImage::kTileSize;
+                level.offset       = offset;
+
+                offset += static_cast<uint64_t>(level.tile_count_x) * level.tile_count_y *
+                          tile_byte_size;
+
+                if (w == 1 && h == 1)
+                {
+                    break;
+                }
+            }
+
+            // NOTE SharedArray needs one more element of capacity to avoid reallocation
+            vector<uint8_t> result;
+            result.reserve(offset + 1);
+            result.resize(offset);
+            memcpy(result.data(), &header, sizeof(header));
+
+            for (uint32_t i = 0; i < header.level_count; ++i)
+            {
+                if (i > 0)
+                {
+                    image = Downsample(image);
+                }
+
+                WriteTiles(result.data(), image, header.levels[i]);
+            }
+
+            return result;
+        }
+
+        // texels are kept in 16 bits only if the source has that precision
+        vector<uint8_t> BuildTiledImage(const string& filename, uint64_t source_size,
+                                        int64_t source_mtime)
+        {
+            if (IsImage16(filename.c_str()))
+            {
+                LevelImage<uint16_t> image;
+
+                auto data = LoadImage16(filename.c_str(), image.width, image.height);
+                AKANE_REQUIRE(data != nullptr);
+
+                image.texels.assign(data.get(), data.get() + image.width * image.height * 3);
+                return BuildTiledImage(std::move(image), TexelFormat::Srgb16, source_size,
+                                       source_mtime);
+            }
+            else
+            {
+                LevelImage<uint8_t> image;
+
+                auto data = LoadImage(filename.c_str(), image.width, image.height);
+                AKANE_REQUIRE(data != nullptr);
+
+                image.texels.assign(data.get(), data.get() + image.width * image.height * 3);
+                return BuildTiledImage(std::move(image), TexelFormat::Srgb8, source_size,
+                                       source_mtime);
+            }
+        }
+
+        bool WriteTiledImage(const string& filename, const vector<uint8_t>& data)
+        {
+            auto temp_filename = MakeTemporaryFilename(filename);
+            auto written       = [&] {
+                ofstream stream{temp_filename, ios::binary | ios::trunc};
+                stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+                return static_cast<bool>(stream);
+            }();
+
+            return CommitTemporaryFile(temp_filename, filename, written);
+        }
+
+        bool ValidateTiledImage(const MappedFile& file, uint64_t source_size, int64_t source_mtime)
+        {
+            if (file.Size() < sizeof(TiledImageHeader))
+            {
+                return false;
+            }
+
+            TiledImageHeader header;
+            memcpy(&header, file.Data(), sizeof(header));
+            if (memcmp(header.magic, kTiledImageMagic, sizeof(header.magic)) != 0 ||
+                header.version != kTiledImageVersion || header.tile_size != TiledImage::kTileSize ||
+                header.level_count == 0 || header.level_count > kMaxLevelCount ||
+                header.texel_format > static_cast<uint32_t>(TexelFormat::Srgb16))
+            {
+                return false;
+            }
+
+            auto channel_size =
+                header.texel_format == static_cast<uint32_t>(TexelFormat::Srgb8) ? 1 : 2;
+            auto tile_byte_size = TiledImage::kTileTexelCount * 3 * channel_size;
+
+            // stale file
+            if (header.source_size != source_size || header.source_mtime != source_mtime)
+            {
+                return false;
+            }
+
+            for (uint32_t i = 0; i < header.level_count; ++i)
+            {
+                const auto& level = header.levels[i];
+                auto tile_count   = static_cast<uint64_t>(level.tile_count_x) * level.tile_count_y;
+                auto end          = level.offset + tile_count * tile_byte_size;
+                if (level.width <= 0 || level.height <= 0 || end > file.Size())
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    } // namespace
+
+    const float* GetSrgb8DecodeTable() noexcept
+    {
+        static const auto table = [] {
+            array<float, 256> result;
+            for (int i = 0; i < 256; ++i)
+            {
+                result[i] = sRGB2Linear(static_cast<float>(i) * (1.f / 255.f));
+            }
+
+            return result;
+        }();
+
+        return table.data();
+    }
+
+    const float* GetSrgb16DecodeTable() noexcept
+    {
+        static const auto table = [] {
+            vector<float> result(65536);
+            for (int i = 0; i < 65536; ++i)
+            {
+                result[i] = sRGB2Linear(static_cast<float>(i) * (1.f / 65535.f));
+            }
+
+            return result;
+        }();
+
+        return table.data();
+    }
+
+    TiledImage::SharedPtr TiledImage::Open(const string& filename)
+    {
+        path file        = filename;
+        auto source_size = static_cast<uint64_t>(file_size(file));
+        auto source_time = last_write_time(file).time_since_epoch().count();
+
+        auto tiled_filename = filename + kTiledImageSuffix;
+
+        SharedArray<uint8_t> data;
+        if (auto mapped = MappedFile::Open(tiled_filename);
+            mapped != nullptr && ValidateTiledImage(*mapped, source_size, source_time))
+        {
+            data = SharedArray<uint8_t>(mapped, mapped->Data(), mapped->Size());
+        }
+        else
+        {
+            mapped = nullptr;
+
+            auto built = BuildTiledImage(filename, source_size, source_time);
+            if (WriteTiledImage(tiled_filename, built) &&
+                (mapped = MappedFile::Open(tiled_filename)) != nullptr)
+            {
+                data = SharedArray<uint8_t>(mapped, mapped->Data(), mapped->Size());
+            }
+            else
+            {
+                Warn("failed to write tiled image {}\n", tiled_filename);
+                data = std::move(built);
+            }
+        }
+
+        TiledImageHeader header;
+        memcpy(&header, data.data(), sizeof(header));
+
+        auto result     = shared_ptr<TiledImage>(new TiledImage());
+        result->data_   = std::move(data);
+        result->format_ = static_cast<TexelFormat>(header.texel_format);
+        result->levels_.assign(header.levels, header.levels + header.level_count);
+        return result;
+    }
+} // namespace akane
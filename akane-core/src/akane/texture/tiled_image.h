@@ -0,0 +1,99 @@
+#pragma once
+#include "akane/common/basic.h"
+#include "akane/common/shared_array.h"
+#include <string>
+#include <vector>
+
+namespace akane
+{
+    // suffix appended to the image path for its tiled file
+    constexpr const char* kTiledImageSuffix = ".aktex";
+
+    // texels are kept in the precision of the source image, and decoded at lookup
+    enum class TexelFormat : uint32_t
+    {
+        Srgb8,
+        Srgb16,
+    };
+
+    // linear values of all 8-bit or 16-bit sRGB values
+    const float* GetSrgb8DecodeTable() noexcept;
+    const float* GetSrgb16DecodeTable() noexcept;
+
+    /**
+     * Mip pyramid of an 8-bit or 16-bit sRGB image stored as square tiles
+     *
+     * The pyramid is built on first use and written next to the image, later loads memory-map
+     * that file so that only tiles being accessed are paged in.
+     *
+     * Each tile covers kTileSize texels in both directions, and also stores one more column and
+     * row copied from its neighbours, so that all four taps of a bilinear lookup are found in a
+     * single tile. Texels out of the image, including those of partial tiles at right and bottom
+     * edges, are wrapped around as with repeat address mode.
+     */
+    class TiledImage : public Object
+    {
+    public:
+        using SharedPtr = shared_ptr<const TiledImage>;
+
+        static constexpr int kTileSize          = 64;
+        static constexpr int kTileStride        = kTileSize + 1; // texels in a row of a tile
+        static constexpr int kChannelCount      = 3;
+        static constexpr size_t kTileTexelCount = kTileStride * kTileStride;
+
+        struct Level
+        {
+            int width;
+            int height;
+            int tile_count_x;
+            int tile_count_y;
+
+            uint64_t offset; // offset of the first tile in bytes
+        };
+
+        static SharedPtr Open(const std::string& filename);
+
+        TexelFormat Format() const noexcept
+        {
+            return format_;
+        }
+
+        size_t TileByteSize() const noexcept
+        {
+            auto channel_size = format_ == TexelFormat::Srgb8 ? 1 : 2;
+            return kTileTexelCount * kChannelCount * channel_size;
+        }
+
+        int LevelCount() const noexcept
+        {
+            return static_cast<int>(levels_.size());
+        }
+
+        const Level& GetLevel(int level) const noexcept
+        {
+            AKANE_ASSERT(level >= 0 && level < LevelCount());
+            return levels_[level];
+        }
+
+        // texels of a tile in row-major order with kTileStride, each as [r, g, b] in the texel
+        // format
+        const uint8_t* GetTile(int level, int tile_x, int tile_y) const noexcept
+        {
+            const auto& lv = GetLevel(level);
+            AKANE_ASSERT(tile_x >= 0 && tile_x < lv.tile_count_x);
+            AKANE_ASSERT(tile_y >= 0 && tile_y < lv.tile_count_y);
+
+            auto tile_index = static_cast<size_t>(tile_y) * lv.tile_count_x + tile_x;
+            return data_.data() + lv.offset + tile_index * TileByteSize();
+        }
+
+    private:
+        TiledImage() = default;
+
+        TexelFormat format_ = TexelFormat::Srgb8;
+        std::vector<Level> levels_;
+
+        // either a mapped file or in-memory data if the file couldn't be written
+        SharedArray<uint8_t> data_;
+    };
+} // namespace akane
@@ -1,5 +1,6 @@
 #include "scene_edit.h"
 #include "akane/camera.h"
+#include "akane/medium.h"
 #include "akane/model.h"
 
 using namespace std;
@@ -21,24 +22,36 @@ namespace akane::gui
         // load scene
         auto scene_desc = LoadSceneDesc("d:/cbox.json");
 
-        auto scene = make_shared<EmbreeScene>();
+        auto scene = make_shared<EmbreeScene>(true);
+
+        shared_ptr<Medium> scene_medium;
+        if (scene_desc->medium != nullptr)
+        {
+            scene_medium = CreateMedium(*scene_desc->medium);
+            scene->SetCameraMedium(scene_medium);
+        }
+
         for (const auto& object : scene_desc->objects)
         {
-            auto transform = Transform::CreateScale(object.scale)
-                                 .RotateX(object.rotation[0])
-                                 .RotateY(object.rotation[1])
-                                 .RotateZ(object.rotation[2])
-                                 .Move(object.position);
+            auto handle = scene->AddMovingMesh(*object.mesh, ComputeKeyframeTransforms(object));
+            if (object.medium != nullptr)
+            {
+                scene->SetMeshMedium(handle, CreateMedium(*object.medium), scene_medium,
+                                     object.medium->surface_visible);
+            }
 
-            scene->AddMesh(*object.mesh, transform);
+            EditObjects.push_back(EditObject{object, handle});
         }
         scene->Commit();
 
+        EditScene                  = scene;
         CurrentState.ThisScene     = scene;
         CurrentState.CameraOrigin  = scene_desc->camera.origin;
         CurrentState.CameraForward = scene_desc->camera.forward;
         CurrentState.CameraUpward  = scene_desc->camera.upward;
         CurrentState.CameraFov     = scene_desc->camera.fov;
+        CurrentState.ShutterOpen   = scene_desc->camera.shutter_open;
+        CurrentState.ShutterClose  = scene_desc->camera.shutter_close;
 
         // create texture
         DisplayTex = AllocateTexture(CurrentState.Resolution[0], CurrentState.Resolution[1]);
@@ -54,13 +67,26 @@ namespace akane::gui
         UpdateRenderingEditor(state);
         UpdateCameraEditor(state);
         UpdateMaterialEditor(state);
+        UpdateObjectEditor(state);
         // UpdateLightEditor(state);
         UpdateCameraAction(state);
 
+        // scene edits invalidate the canvas as well
+        if (!PendingSceneEdits.empty())
+        {
+            state.Version += 1;
+        }
+
         if (state != CurrentState)
         {
             std::unique_lock<std::mutex> lock{SceneUpdatingLock};
             CurrentState = state;
+
+            for (auto& edit : PendingSceneEdits)
+            {
+                SubmittedSceneEdits.push_back(std::move(edit));
+            }
+            PendingSceneEdits.clear();
         }
 
         // update window
@@ -94,6 +120,8 @@ namespace akane::gui
                 return "Preview Path Tracing";
             case IntegrationMode::PathTracing:
                 return "Path Tracing";
+            case IntegrationMode::BidirectionalPathTracing:
+                return "Bidirectional Path Tracing";
             default:
                 return "";
             }
@@ -113,6 +141,10 @@ namespace akane::gui
             {
                 state.Mode = IntegrationMode::PathTracing;
             }
+            if (ImGui::Selectable("Bidirectional Path Tracing"))
+            {
+                state.Mode = IntegrationMode::BidirectionalPathTracing;
+            }
         }
     }
     void SceneEditWindow::UpdateCameraEditor(RenderingState& state)
@@ -137,50 +169,110 @@ namespace akane::gui
             state.CameraFov = clamp(state.CameraFov, 0.1f, 0.8f);
         }
 
+        // the other end follows so that the interval never becomes empty
+        if (ImGui::SliderFloat("Shutter Open", &state.ShutterOpen, 0.f, 1.f))
+        {
+            state.ShutterClose = max(state.ShutterClose, state.ShutterOpen);
+        }
+        if (ImGui::SliderFloat("Shutter Close", &state.ShutterClose, 0.f, 1.f))
+        {
+            state.ShutterOpen = min(state.ShutterOpen, state.ShutterClose);
+        }
+
         ImGui::SliderFloat("Move Rate", &CameraMoveRatePerSec, 0.f, 2.f);
         ImGui::SliderFloat("Rotate Rate", &CameraRotateRatePerSec, 0.f, 2.f);
     }
     void SceneEditWindow::UpdateMaterialEditor(RenderingState& state)
     {
-        /*
         ImScoped::Window window{"Material"};
 
-        bool scene_changed = false;
-        for (const auto& [name, material] : state.ThisScene->GetEditMaterials())
+        // values are copied so that the material is only modified by the rendering thread
+        for (auto material : EditScene->GetEditMaterials())
         {
-            if (ImGui::TreeNode(name.c_str()))
+            if (ImGui::TreeNode(material, "%s", material->name_.c_str()))
             {
-                if (ImGui::ColorEdit3("Kd", material->kd_.data.data()))
+                auto kd         = material->kd_;
+                auto ks         = material->ks_;
+                auto tr         = material->tr_;
+                auto roughness  = material->roughness_;
+                auto anisotropy = material->anisotropy_;
+                auto eta_in     = material->eta_in_;
+                auto abbe       = material->abbe_;
+
+                if (ImGui::ColorEdit3("Kd", kd.data.data()))
+                {
+                    PendingSceneEdits.push_back([=](EmbreeScene&) { material->kd_ = kd; });
+                }
+                if (ImGui::ColorEdit3("Ks", ks.data.data()))
                 {
-                    scene_changed = true;
+                    PendingSceneEdits.push_back([=](EmbreeScene&) { material->ks_ = ks; });
                 }
-                if (ImGui::ColorEdit3("Ks", material->ks_.data.data()))
+                if (ImGui::ColorEdit3("Tr", tr.data.data()))
                 {
-                    scene_changed = true;
+                    PendingSceneEdits.push_back([=](EmbreeScene&) { material->tr_ = tr; });
                 }
-                if (ImGui::ColorEdit3("Tr", material->tr_.data.data()))
+                if (ImGui::SliderFloat("roughness", &roughness, 0.f, 1.f))
                 {
-                    scene_changed = true;
+                    PendingSceneEdits.push_back(
+                        [=](EmbreeScene&) { material->roughness_ = roughness; });
                 }
-                if (ImGui::SliderFloat("roughness", &material->roughness_, 0.f, 1.f))
+                if (ImGui::SliderFloat("anisotropy", &anisotropy, 0.f, .99f))
                 {
-                    scene_changed = true;
+                    PendingSceneEdits.push_back(
+                        [=](EmbreeScene&) { material->anisotropy_ = anisotropy; });
                 }
-                if (ImGui::SliderFloat("eta", &material->eta_in_, 0.5f, 10.f))
+                if (ImGui::SliderFloat("eta", &eta_in, 0.5f, 10.f))
                 {
-                    scene_changed = true;
+                    PendingSceneEdits.push_back([=](EmbreeScene&) { material->eta_in_ = eta_in; });
+                }
+                if (ImGui::SliderFloat("abbe", &abbe, 0.f, 100.f))
+                {
+                    PendingSceneEdits.push_back([=](EmbreeScene&) { material->abbe_ = abbe; });
                 }
 
                 ImGui::TreePop();
                 ImGui::Separator();
             }
         }
+    }
+    void SceneEditWindow::UpdateObjectEditor(RenderingState& state)
+    {
+        ImScoped::Window window{"Object"};
 
-        if (scene_changed)
+        for (auto& object : EditObjects)
         {
-            state.Version += 1;
+            if (ImGui::TreeNode(&object, "%s", object.Desc.mesh->name.c_str()))
+            {
+                // only the first keyframe is edited for moving objects
+                bool transform_changed = false;
+                transform_changed |=
+                    ImGui::DragFloat3("Position", object.Desc.position.data.data(), .01f);
+                transform_changed |=
+                    ImGui::SliderFloat3("Rotation", object.Desc.rotation.data.data(), -kPi, kPi);
+                transform_changed |=
+                    ImGui::DragFloat("Scale", &object.Desc.scale, .01f, .01f, 100.f);
+
+                if (transform_changed)
+                {
+                    auto keyframes = ComputeKeyframeTransforms(object.Desc);
+                    PendingSceneEdits.push_back(
+                        [handle = object.Handle, keyframes](EmbreeScene& scene) {
+                            scene.UpdateMeshTransform(handle, keyframes);
+                        });
+                }
+
+                if (ImGui::Checkbox("Enabled", &object.Enabled))
+                {
+                    PendingSceneEdits.push_back(
+                        [handle = object.Handle, enabled = object.Enabled](EmbreeScene& scene) {
+                            scene.SetMeshEnabled(handle, enabled);
+                        });
+                }
+
+                ImGui::TreePop();
+                ImGui::Separator();
+            }
         }
-        */
     }
     void SceneEditWindow::UpdateLightEditor(RenderingState& state)
     {
@@ -396,7 +488,8 @@ namespace akane::gui
                 {
                     auto resolution = Point2i{canvas.Width(), canvas.Height()};
                     auto uv         = ComputeScreenSpaceUV({x, y}, resolution, sampler.Get2D());
-                    auto ray        = camera.SpawnRay(uv);
+                    auto duv        = Vec2{1.f / resolution[0], 1.f / resolution[1]};
+                    auto ray        = camera.SpawnRayDifferential(uv, duv, sampler.Get1D());
                     auto radiance   = integrator.Li(ctx, sampler, scene, ray);
 
                     acc += radiance;
@@ -432,9 +525,22 @@ namespace akane::gui
         {
             // fetch latest rendering parameters
             RenderingState state;
+            std::vector<SceneEdit> scene_edits;
             {
                 std::unique_lock<std::mutex> lock{SceneUpdatingLock};
                 state = CurrentState;
+                scene_edits.swap(SubmittedSceneEdits);
+            }
+
+            // apply scene edits, only affected geometries are refitted or rebuilt
+            if (!scene_edits.empty())
+            {
+                for (auto& edit : scene_edits)
+                {
+                    edit(*EditScene);
+                }
+
+                EditScene->Commit();
             }
 
             // detect if canvas has to be altered
@@ -455,11 +561,15 @@ namespace akane::gui
                 static_cast<float>(state.Resolution[1]) / static_cast<float>(state.Resolution[0]);
             auto camera      = CreatePinholeCamera(state.CameraOrigin, state.CameraForward,
                                               state.CameraUpward, state.CameraFov, aspect_ratio);
-            auto& integrator = state.Mode == IntegrationMode::NormalMapped
-                                   ? *NormalMappedIntegrator
-                                   : state.Mode == IntegrationMode::PreviewPathTracing
-                                         ? *PreviewPathTracingIntegrator
-                                         : *PathTracingIntegrator;
+            camera->SetShutter(state.ShutterOpen, state.ShutterClose);
+            auto& integrator =
+                state.Mode == IntegrationMode::NormalMapped
+                    ? *NormalMappedIntegrator
+                    : state.Mode == IntegrationMode::PreviewPathTracing
+                          ? *PreviewPathTracingIntegrator
+                          : state.Mode == IntegrationMode::PathTracing
+                                ? *PathTracingIntegrator
+                                : *BidirectionalPathTracingIntegrator;
 
             auto t0 = std::chrono::high_resolution_clock::now();
             if (spp == 0)
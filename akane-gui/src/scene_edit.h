@@ -1,9 +1,14 @@
 #pragma once
 #include "akane/render.h"
+#include "akane/integrator/bidirectional.h"
 #include "akane/integrator/normal_mapped.h"
 #include "akane/integrator/path_tracing.h"
 #include "akane/scene/embree.h"
+#include "akane/material/generic.h"
+#include "akane/model.h"
 #include "quick_imgui.h"
+#include <functional>
+#include <vector>
 
 namespace akane::gui
 {
@@ -20,6 +25,7 @@ namespace akane::gui
         NormalMapped,
         PreviewPathTracing,
         PathTracing,
+        BidirectionalPathTracing,
     };
 
     // state that would lead to invalidation of old render canvas
@@ -36,6 +42,10 @@ namespace akane::gui
         Vec3 CameraForward = kDefaultCameraForward;
         Vec3 CameraUpward  = kDefaultCameraUpward;
         float CameraFov    = kDefaultCameraFov;
+
+        // shutter interval in the frame, which blurs moving meshes
+        float ShutterOpen  = 0.f;
+        float ShutterClose = 1.f;
     };
 
     inline bool operator==(const RenderingState& lhs, const RenderingState& rhs)
@@ -43,13 +53,25 @@ namespace akane::gui
         return lhs.Version == rhs.Version && lhs.ThisScene == rhs.ThisScene &&
                lhs.Mode == rhs.Mode && lhs.Resolution == rhs.Resolution &&
                lhs.CameraOrigin == rhs.CameraOrigin && lhs.CameraForward == rhs.CameraForward &&
-               lhs.CameraUpward == rhs.CameraUpward && lhs.CameraFov == rhs.CameraFov;
+               lhs.CameraUpward == rhs.CameraUpward && lhs.CameraFov == rhs.CameraFov &&
+               lhs.ShutterOpen == rhs.ShutterOpen && lhs.ShutterClose == rhs.ShutterClose;
     }
     inline bool operator!=(const RenderingState& lhs, const RenderingState& rhs)
     {
         return !(lhs == rhs);
     }
 
+    // edit to the scene, which is applied by the rendering thread between frames
+    using SceneEdit = std::function<void(EmbreeScene&)>;
+
+    // object in the scene that could be edited
+    struct EditObject
+    {
+        PrimitiveDesc Desc;
+        EmbreeScene::MeshHandle Handle;
+        bool Enabled = true;
+    };
+
     class SceneEditWindow
     {
     public:
@@ -66,6 +88,7 @@ namespace akane::gui
         void UpdateRenderingEditor(RenderingState& state);
         void UpdateCameraEditor(RenderingState& state);
         void UpdateMaterialEditor(RenderingState& state);
+        void UpdateObjectEditor(RenderingState& state);
         void UpdateLightEditor(RenderingState& state);
         void UpdateCameraAction(RenderingState& state);
 
@@ -78,6 +101,12 @@ namespace akane::gui
         //
         RenderingState CurrentState;
 
+        shared_ptr<EmbreeScene> EditScene = nullptr;
+        std::vector<EditObject> EditObjects;
+
+        std::vector<SceneEdit> PendingSceneEdits;   // collected in this frame of ui
+        std::vector<SceneEdit> SubmittedSceneEdits; // guarded by SceneUpdatingLock
+
         Point2i ResolutionInput = CurrentState.Resolution;
         float DisplayScale      = 400.f / CurrentState.Resolution[0];
 
@@ -94,6 +123,8 @@ namespace akane::gui
             make_unique<akane::PathTracingIntegrator>(1, 1);
         unique_ptr<Integrator> PathTracingIntegrator =
             make_unique<akane::PathTracingIntegrator>(2, 6);
+        unique_ptr<Integrator> BidirectionalPathTracingIntegrator =
+            make_unique<akane::BidirectionalPathTracingIntegrator>(6);
 
         int CurrentSpp                   = 0;
         float AvgFrameTime               = 1.f; // millisec
@@ -2,8 +2,12 @@
 
 #include "akane/scene/integrated.h"
 #include "akane/scene/embree.h"
+#include "akane/integrator/bidirectional.h"
+#include "akane/integrator/light_tracing.h"
 #include "akane/integrator/normal_mapped.h"
+#include "akane/integrator/path_guiding.h"
 #include "akane/integrator/path_tracing.h"
+#include "akane/integrator/sppm.h"
 #include "akane/material/lambertian.h"
 #include "akane/material/test.h"
 #include "akane/texture.h"
@@ -13,11 +17,9 @@
 #include "akane/shape/rect.h"
 #include "akane/shape/sphere.h"
 
-#include "akane/bsdf/lambertian.h"
-#include "akane/bsdf/specular.h"
-#include "akane/bsdf/microfacet.h"
-#include "akane/bsdf/hybrid.h"
+#include "akane/bsdf.h"
 
+#include "akane/medium.h"
 #include "akane/model.h"
 
 #include <vector>
@@ -28,24 +30,59 @@ using namespace akane;
 constexpr int kSamplePerPixel = 1000;
 constexpr Point2i kResolution = {800, 800};
 
+enum class RenderMethod
+{
+    PathTracing,
+    GuidedPathTracing,
+    BidirectionalPathTracing,
+    LightTracing,
+    PhotonMapping,
+};
+
+constexpr RenderMethod kRenderMethod = RenderMethod::PathTracing;
+
+// photon mapping runs an iteration for each sample per pixel
+constexpr int kPhotonPerIteration = 1000000;
+constexpr float kInitialPhotonRadius = .05f;
+
+// guided path tracing trains with 1, 2, 4, ... samples per pixel before rendering
+constexpr int kGuideTrainingPasses = 5;
+
 unique_ptr<Camera> LoadEmbreeScene(const string& filename, EmbreeScene& scene)
 {
     auto scene_desc = LoadSceneDesc(filename.c_str());
-    for (const auto& object : scene_desc->objects)
+
+    // media bounded by objects are assumed not to nest, so they are all surrounded by the medium
+    // of the camera
+    shared_ptr<Medium> scene_medium;
+    if (scene_desc->medium != nullptr)
     {
-        auto transform = Transform::CreateScale(object.scale)
-                             .RotateX(object.rotation[0])
-                             .RotateY(object.rotation[1])
-                             .RotateZ(object.rotation[2])
-                             .Move(object.position);
+        scene_medium = CreateMedium(*scene_desc->medium);
+        scene.SetCameraMedium(scene_medium);
+    }
 
-        scene.AddMesh(*object.mesh, transform);
+    for (const auto& object : scene_desc->objects)
+    {
+        auto handle = scene.AddMovingMesh(*object.mesh, ComputeKeyframeTransforms(object));
+        if (object.medium != nullptr)
+        {
+            scene.SetMeshMedium(handle, CreateMedium(*object.medium), scene_medium,
+                                object.medium->surface_visible);
+        }
+    }
+    if (!scene_desc->environment.image_file.empty())
+    {
+        scene.AddEnvironmentMap(scene_desc->environment.image_file, scene_desc->environment.scale,
+                                {}, 10e5);
     }
     scene.Commit();
 
-    return CreatePinholeCamera(scene_desc->camera.origin, scene_desc->camera.forward,
-                               scene_desc->camera.upward, scene_desc->camera.fov,
-                               scene_desc->camera.aspect_ratio);
+    auto camera = CreatePinholeCamera(scene_desc->camera.origin, scene_desc->camera.forward,
+                                      scene_desc->camera.upward, scene_desc->camera.fov,
+                                      scene_desc->camera.aspect_ratio);
+    camera->SetShutter(scene_desc->camera.shutter_open, scene_desc->camera.shutter_close);
+
+    return camera;
 }
 
 int main()
@@ -58,8 +95,8 @@ int main()
 
     auto mat_ground = make_shared<LambertianMaterial>(Vec3{.7f, .7f, .7f});
 
-    auto mat_ground2 = make_shared<TestMaterial>(tex_cb, [](akane::Workspace& ws, Spectrum albedo) {
-        return ws.Construct<LambertianReflection>(albedo);
+    auto mat_ground2 = make_shared<TestMaterial>(tex_cb, [](Spectrum albedo) -> BsdfLobe {
+        return LambertianReflection{albedo};
     });
     auto mat_obj1    = make_shared<LambertianMaterial>(Vec3{.2f, .9f, .2f});
     scene->AddGeometricPrimitive(shape::Sphere{{0, 0, 0}, 1}, mat_obj1);
@@ -75,10 +112,47 @@ int main()
     auto scene  = make_unique<EmbreeScene>();
     auto camera = LoadEmbreeScene("d:/cbox.json", *scene);
 
-    auto integrator = make_unique<PathTracingIntegrator>();
+    RenderResult result;
+    if (kRenderMethod == RenderMethod::LightTracing)
+    {
+        auto integrator = LightTracingIntegrator{};
+
+        result = integrator.Execute(*scene, *camera, kResolution, kSamplePerPixel,
+                                    std::random_device{}());
+    }
+    else if (kRenderMethod == RenderMethod::PhotonMapping)
+    {
+        auto integrator = SppmIntegrator{kPhotonPerIteration, kInitialPhotonRadius};
 
-    auto result =
-        ExecuteRenderingMultiThread(*integrator, *scene, *camera, kResolution, kSamplePerPixel, 8);
+        result = integrator.Execute(*scene, *camera, kResolution, kSamplePerPixel,
+                                    std::random_device{}());
+    }
+    else
+    {
+        unique_ptr<Integrator> integrator;
+        if (kRenderMethod == RenderMethod::BidirectionalPathTracing)
+        {
+            integrator = make_unique<BidirectionalPathTracingIntegrator>();
+        }
+        else if (kRenderMethod == RenderMethod::GuidedPathTracing && !scene->Bound().Empty())
+        {
+            // a scene without geometry has nothing to guide, so it falls back to plain PT below
+            auto guided_integrator = make_unique<PathTracingIntegrator>();
+            auto guide             = make_shared<PathGuide>(scene->Bound());
+            guided_integrator->SetPathGuide(guide);
+
+            TrainPathGuide(*guided_integrator, *guide, *scene, *camera, kResolution,
+                           kGuideTrainingPasses, std::random_device{}());
+            integrator = std::move(guided_integrator);
+        }
+        else
+        {
+            integrator = make_unique<PathTracingIntegrator>();
+        }
+
+        result = ExecuteRenderingMultiThread(*integrator, *scene, *camera, kResolution,
+                                             kSamplePerPixel, 8);
+    }
 
     result.canvas->SaveImage("d:/test.png", 1.f / result.ssp);
     return 0;